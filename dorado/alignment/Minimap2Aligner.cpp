@@ -2,6 +2,7 @@
 
 #include "sam_utils.h"
 #include "utils/PostCondition.h"
+#include "utils/bam_pool.h"
 #include "utils/bam_utils.h"
 #include "utils/sequence_utils.h"
 
@@ -140,7 +141,7 @@ std::vector<BamPtr> Minimap2Aligner::align(bam1_t* irecord, mm_tbuf_t* buf) {
 
     // just return the input record
     if (hits == 0) {
-        results.push_back(BamPtr(bam_dup1(irecord)));
+        results.push_back(utils::duplicate_bam(irecord));
     }
 
     for (int j = 0; j < hits; j++) {
@@ -240,7 +241,7 @@ std::vector<BamPtr> Minimap2Aligner::align(bam1_t* irecord, mm_tbuf_t* buf) {
         }
 
         // new output record
-        bam1_t* record = bam_init1();
+        bam1_t* record = utils::acquire_bam().release();
 
         // Set properties of the BAM record.
         bam_set1(record, qname.size(), qname.data(), flag, tid, pos, mapq, n_cigar,
@@ -8,6 +8,7 @@
 #include "read_pipeline/PairingNode.h"
 #include "read_pipeline/ReadSplitNode.h"
 #include "read_pipeline/ScalerNode.h"
+#include "read_pipeline/SequencingSummaryNode.h"
 #include "read_pipeline/StereoDuplexEncoderNode.h"
 #include "splitter/DuplexReadSplitter.h"
 #include "splitter/RNAReadSplitter.h"
@@ -181,4 +182,17 @@ void create_stereo_duplex_pipeline(PipelineDescriptor& pipeline_desc,
     }
 }
 
+NodeHandle add_sequencing_summary_node(PipelineDescriptor& pipeline_desc,
+                                       const std::string& summary_filename,
+                                       const std::string& columns_filename,
+                                       int writer_threads,
+                                       NodeHandle sink_node_handle) {
+    std::vector<NodeHandle> sinks;
+    if (sink_node_handle != PipelineDescriptor::InvalidNodeHandle) {
+        sinks.push_back(sink_node_handle);
+    }
+    return pipeline_desc.add_node<SequencingSummaryNode>(sinks, summary_filename,
+                                                         columns_filename, writer_threads);
+}
+
 }  // namespace dorado::api
@@ -54,6 +54,16 @@ void create_stereo_duplex_pipeline(PipelineDescriptor& pipeline_desc,
                                    NodeHandle sink_node_handle,
                                    NodeHandle source_node_handle);
 
+/// Add a node writing a sequencing summary row for each read passing to sink_node_handle,
+/// usually the HtsWriter, and return it for use as the sink in its place.
+/// The text summary is written to summary_filename and the columnar one to columns_filename,
+/// either of which may be empty. The node's header must be set before reads are sent to it.
+NodeHandle add_sequencing_summary_node(PipelineDescriptor& pipeline_desc,
+                                       const std::string& summary_filename,
+                                       const std::string& columns_filename,
+                                       int writer_threads,
+                                       NodeHandle sink_node_handle);
+
 }  // namespace api
 
 }  // namespace dorado
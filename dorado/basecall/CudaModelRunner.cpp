@@ -3,6 +3,7 @@
 #include "CudaCaller.h"
 #include "decode/Decoder.h"
 #include "torch_utils/cuda_utils.h"
+#include "torch_utils/tensor_utils.h"
 #include "utils/math_utils.h"
 
 #include <c10/cuda/CUDAGuard.h>
@@ -17,8 +18,8 @@ CudaModelRunner::CudaModelRunner(std::shared_ptr<CudaCaller> caller, size_t batc
     std::tie(m_input, m_output) = m_caller->create_input_output_tensor(batch_dims_idx);
 }
 
-void CudaModelRunner::accept_chunk(int chunk_idx, const at::Tensor &chunk) {
-    m_input.index_put_({chunk_idx, torch::indexing::Ellipsis}, chunk);
+void CudaModelRunner::accept_chunk(int chunk_idx, const at::Tensor &signal, size_t offset) {
+    utils::copy_chunk_to_batch_row(m_input, chunk_idx, signal, offset);
 }
 
 std::vector<decode::DecodedChunk> CudaModelRunner::call_chunks(int num_chunks) {
@@ -5,6 +5,7 @@
 
 #include "CRFModelConfig.h"
 #include "MetalCaller.h"
+#include "torch_utils/tensor_utils.h"
 
 #include <ATen/TensorIndexing.h>
 #include <spdlog/spdlog.h>
@@ -14,14 +15,19 @@ namespace dorado::basecall {
 MetalModelRunner::MetalModelRunner(std::shared_ptr<MetalCaller> caller)
         : m_caller(std::move(caller)), m_input(m_caller->create_input_tensor()) {}
 
-void MetalModelRunner::accept_chunk(int chunk_idx, const at::Tensor &chunk_CT) {
-    assert(config().num_features == chunk_CT.size(0));
-    using at::indexing::Ellipsis;
-    // Tx model input accepts NCT while LSTM models have metal convolution kernels expecting NTC
-    if (config().is_lstm_model()) {
-        m_input.index_put_({chunk_idx, Ellipsis, Ellipsis}, chunk_CT.transpose(0, 1));
+void MetalModelRunner::accept_chunk(int chunk_idx, const at::Tensor &signal, size_t offset) {
+    // Tx model input accepts NCT while LSTM models have metal convolution kernels expecting NTC.
+    // With a single feature the two layouts are identical.
+    if (!config().is_lstm_model()) {
+        utils::copy_chunk_to_batch_row(m_input, chunk_idx, signal, offset);
+    } else if (config().num_features == 1) {
+        auto input_NCT = m_input.view({m_input.size(0), 1, m_input.size(1)});
+        utils::copy_chunk_to_batch_row(input_NCT, chunk_idx, signal, offset);
     } else {
-        m_input.index_put_({chunk_idx, Ellipsis, Ellipsis}, chunk_CT);
+        using at::indexing::Ellipsis;
+        auto chunk_1CT = at::empty({1, m_input.size(2), m_input.size(1)}, m_input.options());
+        utils::copy_chunk_to_batch_row(chunk_1CT, 0, signal, offset);
+        m_input.index_put_({chunk_idx, Ellipsis, Ellipsis}, chunk_1CT[0].transpose(0, 1));
     }
 }
 
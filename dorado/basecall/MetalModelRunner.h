@@ -18,7 +18,7 @@ class MetalCaller;
 class MetalModelRunner final : public ModelRunnerBase {
 public:
     explicit MetalModelRunner(std::shared_ptr<MetalCaller> caller);
-    void accept_chunk(int chunk_idx, const at::Tensor& chunk) final;
+    void accept_chunk(int chunk_idx, const at::Tensor& signal, size_t offset) final;
     std::vector<decode::DecodedChunk> call_chunks(int num_chunks) final;
     const CRFModelConfig& config() const final;
     size_t chunk_size() const final;
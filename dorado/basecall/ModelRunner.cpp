@@ -3,6 +3,9 @@
 #include "crf_utils.h"
 #include "decode/Decoder.h"
 #include "nn/CRFModel.h"
+#include "torch_utils/tensor_utils.h"
+
+#include <future>
 
 namespace dorado::basecall {
 
@@ -23,27 +26,47 @@ ModelRunner::ModelRunner(const CRFModelConfig &model_config, const std::string &
     const auto C = model_config.num_features;
     const auto T = model_config.basecaller.chunk_size();
 
-    m_input_NCT =
-            at::zeros({N, C, T}, at::TensorOptions().dtype(m_decoder->dtype()).device(at::kCPU));
+    for (auto &input_NCT : m_input_NCT) {
+        input_NCT = at::zeros({N, C, T},
+                              at::TensorOptions().dtype(m_decoder->dtype()).device(at::kCPU));
+    }
 }
 
 std::vector<decode::DecodedChunk> ModelRunner::call_chunks(int num_chunks) {
-    at::InferenceMode guard;
-    dorado::stats::Timer timer;
-    auto scores_TNC =
-            m_module->forward(m_input_NCT.to(m_options.device())).transpose(0, 1).contiguous();
-    const auto forward_ms = timer.GetElapsedMS();
-    auto decoded_chunks = m_decoder->beam_search_part_2(
-            m_decoder->beam_search_part_1({scores_TNC, num_chunks, m_decoder_options}));
-    const auto forward_plus_decode_ms = timer.GetElapsedMS();
-    ++m_num_batches_called;
-    m_model_ms += forward_ms;
-    m_decode_ms += forward_plus_decode_ms - forward_ms;
-    return decoded_chunks;
+    return call_chunks_async(num_chunks).get();
+}
+
+std::future<std::vector<decode::DecodedChunk>> ModelRunner::call_chunks_async(int num_chunks) {
+    const at::Tensor &input_NCT = m_input_NCT[m_input_idx];
+    // Stage the next batch in the other buffer while this one is being called.
+    m_input_idx ^= 1;
+    ++m_num_batches_in_flight;
+
+    return std::async(std::launch::async, [this, &input_NCT, num_chunks] {
+        at::InferenceMode guard;
+        at::Tensor scores_TNC;
+        {
+            std::lock_guard<std::mutex> forward_lock(m_forward_mutex);
+            dorado::stats::Timer timer;
+            scores_TNC = m_module->forward(input_NCT.to(m_options.device()))
+                                 .transpose(0, 1)
+                                 .contiguous();
+            m_model_ms += timer.GetElapsedMS();
+        }
+
+        // Decoding happens outside of the lock so that it overlaps with the next forward pass.
+        dorado::stats::Timer timer;
+        auto decoded_chunks = m_decoder->beam_search_part_2(
+                m_decoder->beam_search_part_1({scores_TNC, num_chunks, m_decoder_options}));
+        m_decode_ms += timer.GetElapsedMS();
+        ++m_num_batches_called;
+        --m_num_batches_in_flight;
+        return decoded_chunks;
+    });
 }
 
-void ModelRunner::accept_chunk(int chunk_idx, const at::Tensor &chunk_CT) {
-    m_input_NCT.index_put_({chunk_idx, at::indexing::Ellipsis}, chunk_CT);
+void ModelRunner::accept_chunk(int chunk_idx, const at::Tensor &signal, size_t offset) {
+    utils::copy_chunk_to_batch_row(m_input_NCT[m_input_idx], chunk_idx, signal, offset);
 }
 
 stats::NamedStats ModelRunner::sample_stats() const {
@@ -51,6 +74,7 @@ stats::NamedStats ModelRunner::sample_stats() const {
     stats["batches_called"] = double(m_num_batches_called);
     stats["model_ms"] = double(m_model_ms);
     stats["decode_ms"] = double(m_decode_ms);
+    stats["batches_in_flight"] = double(m_num_batches_in_flight);
     return stats;
 }
 
@@ -7,7 +7,9 @@
 
 #include <torch/nn.h>
 
+#include <array>
 #include <atomic>
+#include <mutex>
 #include <string>
 
 namespace dorado::basecall {
@@ -15,11 +17,14 @@ namespace dorado::basecall {
 class ModelRunner final : public ModelRunnerBase {
 public:
     ModelRunner(const CRFModelConfig &model_config, const std::string &device);
-    void accept_chunk(int chunk_idx, const at::Tensor &chunk) final;
+    void accept_chunk(int chunk_idx, const at::Tensor &signal, size_t offset) final;
     std::vector<decode::DecodedChunk> call_chunks(int num_chunks) final;
+    // The returned future must be waited on before the chunks of the batch after next are
+    // accepted, as that batch reuses this batch's input buffer.
+    std::future<std::vector<decode::DecodedChunk>> call_chunks_async(int num_chunks) final;
     const CRFModelConfig &config() const final { return m_config; };
-    size_t chunk_size() const final { return m_input_NCT.size(2); }
-    size_t batch_size() const final { return m_input_NCT.size(0); }
+    size_t chunk_size() const final { return m_input_NCT[0].size(2); }
+    size_t batch_size() const final { return m_input_NCT[0].size(0); }
     void terminate() final {}
     void restart() final {}
     std::string get_name() const final { return "ModelRunner"; }
@@ -31,12 +36,17 @@ private:
     at::TensorOptions m_options;
     decode::DecoderOptions m_decoder_options;
     torch::nn::ModuleHolder<torch::nn::AnyModule> m_module{nullptr};
-    at::Tensor m_input_NCT;
+    // Double-buffered input: one batch is staged while the other is being called.
+    std::array<at::Tensor, 2> m_input_NCT;
+    size_t m_input_idx = 0;
+    // Serialises forward passes so that consecutive batches overlap as forward/decode.
+    std::mutex m_forward_mutex;
 
     // Performance monitoring stats.
     std::atomic<int64_t> m_num_batches_called = 0;
     std::atomic<int64_t> m_model_ms = 0;
     std::atomic<int64_t> m_decode_ms = 0;
+    std::atomic<int64_t> m_num_batches_in_flight = 0;
 };
 
 }  // namespace dorado::basecall
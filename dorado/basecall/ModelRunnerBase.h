@@ -3,6 +3,7 @@
 #include "decode/Decoder.h"
 #include "utils/stats.h"
 
+#include <future>
 #include <string>
 #include <vector>
 
@@ -18,8 +19,18 @@ bool is_duplex_model(const CRFModelConfig &model_config);
 class ModelRunnerBase {
 public:
     virtual ~ModelRunnerBase() = default;
-    virtual void accept_chunk(int chunk_idx, const at::Tensor &chunk) = 0;
+    // Stages the chunk of `signal` (CT, or T for single feature models) starting at sample
+    // `offset` as entry `chunk_idx` of the batch, repeat-padding it if the signal ends first.
+    virtual void accept_chunk(int chunk_idx, const at::Tensor &signal, size_t offset) = 0;
     virtual std::vector<decode::DecodedChunk> call_chunks(int num_chunks) = 0;
+    // Submits the accepted chunks for calling and returns once the runner is ready to accept
+    // the next batch, so that batch assembly can overlap with the decoding of this one.
+    // Runners which can't pipeline their work call the chunks synchronously.
+    virtual std::future<std::vector<decode::DecodedChunk>> call_chunks_async(int num_chunks) {
+        std::promise<std::vector<decode::DecodedChunk>> decoded_chunks;
+        decoded_chunks.set_value(call_chunks(num_chunks));
+        return decoded_chunks.get_future();
+    }
     virtual const CRFModelConfig &config() const = 0;
     virtual size_t chunk_size() const = 0;
     virtual size_t batch_size() const = 0;
@@ -8,6 +8,8 @@
 #include <math.h>
 #include <spdlog/spdlog.h>
 
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -94,6 +96,29 @@ at::Tensor backward_scores(const at::Tensor& scores_TNC, const float fixed_stay_
 
 namespace dorado::basecall::decode {
 
+std::vector<BeamSearchWorkspacePtr> CPUDecoder::acquire_workspaces(size_t num_workspaces) const {
+    std::vector<BeamSearchWorkspacePtr> workspaces;
+    workspaces.reserve(num_workspaces);
+    {
+        std::lock_guard<std::mutex> lock(m_workspaces_mutex);
+        while (workspaces.size() < num_workspaces && !m_workspaces.empty()) {
+            workspaces.push_back(std::move(m_workspaces.back()));
+            m_workspaces.pop_back();
+        }
+    }
+    while (workspaces.size() < num_workspaces) {
+        workspaces.push_back(create_beam_search_workspace());
+    }
+    return workspaces;
+}
+
+void CPUDecoder::release_workspaces(std::vector<BeamSearchWorkspacePtr> workspaces) const {
+    std::lock_guard<std::mutex> lock(m_workspaces_mutex);
+    for (auto& workspace : workspaces) {
+        m_workspaces.push_back(std::move(workspace));
+    }
+}
+
 DecodeData CPUDecoder::beam_search_part_1(DecodeData data) const { return data; }
 
 std::vector<DecodedChunk> CPUDecoder::beam_search_part_2(DecodeData data) const {
@@ -106,6 +131,7 @@ std::vector<DecodedChunk> CPUDecoder::beam_search_part_2(DecodeData data) const
     int num_threads_with_one_more_chunk = num_chunks % num_threads;
 
     std::vector<DecodedChunk> chunk_results(num_chunks);
+    auto workspaces = acquire_workspaces(num_threads);
 
     std::vector<std::thread> threads;
     threads.reserve(num_threads);
@@ -134,15 +160,10 @@ std::vector<DecodedChunk> CPUDecoder::beam_search_part_2(DecodeData data) const
 
             // Iter over n in nTC, passing TC tensors to beam_search_decode
             for (int chunk_idx = 0; chunk_idx < t_num_chunks; chunk_idx++) {
-                auto decode_result = beam_search_decode(t_scores[chunk_idx], bwd[chunk_idx],
-                                                        posts[chunk_idx], options.beam_width,
-                                                        options.beam_cut, options.blank_score,
-                                                        options.q_shift, options.q_scale, 1.0f);
-                chunk_results[t_first_chunk + chunk_idx] = DecodedChunk{
-                        std::get<0>(decode_result),
-                        std::get<1>(decode_result),
-                        std::get<2>(decode_result),
-                };
+                beam_search_decode(t_scores[chunk_idx], bwd[chunk_idx], posts[chunk_idx],
+                                   options.beam_width, options.beam_cut, options.blank_score,
+                                   options.q_shift, options.q_scale, 1.0f, *workspaces[i],
+                                   chunk_results[t_first_chunk + chunk_idx]);
             }
         });
     }
@@ -150,6 +171,7 @@ std::vector<DecodedChunk> CPUDecoder::beam_search_part_2(DecodeData data) const
     for (auto& thread : threads) {
         thread.join();
     }
+    release_workspaces(std::move(workspaces));
 
     return chunk_results;
 }
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "Decoder.h"
+#include "beam_search.h"
 
 #include <ATen/core/TensorBody.h>
 
+#include <mutex>
+#include <vector>
+
 namespace dorado::basecall::decode {
 
 namespace inner {
@@ -19,6 +23,15 @@ public:
     std::vector<DecodedChunk> beam_search_part_2(DecodeData data) const;
 
     at::ScalarType dtype() const { return at::ScalarType::Float; };
+
+private:
+    // Workspaces for the decoding threads, kept between batches. Each thread takes one while it
+    // runs, so batches decoded at the same time don't share them.
+    mutable std::mutex m_workspaces_mutex;
+    mutable std::vector<BeamSearchWorkspacePtr> m_workspaces;
+
+    std::vector<BeamSearchWorkspacePtr> acquire_workspaces(size_t num_workspaces) const;
+    void release_workspaces(std::vector<BeamSearchWorkspacePtr> workspaces) const;
 };
 
 }  // namespace dorado::basecall::decode
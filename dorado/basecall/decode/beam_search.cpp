@@ -1,5 +1,7 @@
 #include "beam_search.h"
 
+#include "Decoder.h"
+#include "beam_search_kernels.h"
 #include "utils/simd.h"
 
 #include <c10/core/ScalarType.h>
@@ -10,10 +12,10 @@
 #include <algorithm>
 #include <array>
 #include <bitset>
-#include <cstring>
 #include <iostream>
 #include <limits>
 #include <numeric>
+#include <utility>
 
 namespace {
 
@@ -39,6 +41,42 @@ struct BeamFrontElement {
     bool stay;
 };
 
+}  // anonymous namespace
+
+namespace dorado::basecall::decode {
+
+struct BeamSearchWorkspace {
+    std::vector<BeamElement> beam_vector;
+    std::vector<BeamFrontElement> current_beam_front;
+    std::vector<BeamFrontElement> prev_beam_front;
+    std::vector<float> current_scores;
+    std::vector<float> prev_scores;
+    std::vector<float> sorted_back_guides;
+    std::vector<int32_t> states;
+    std::vector<float> qual_data;
+    std::vector<float> base_probs;
+    std::vector<float> total_probs;
+    bool use_avx2_kernels = false;
+};
+
+void BeamSearchWorkspaceDeleter::operator()(BeamSearchWorkspace* workspace) const {
+    delete workspace;
+}
+
+BeamSearchWorkspacePtr create_beam_search_workspace([[maybe_unused]] bool use_simd_kernels) {
+    BeamSearchWorkspacePtr workspace(new BeamSearchWorkspace);
+#if ENABLE_AVX2_IMPL
+    workspace->use_avx2_kernels = use_simd_kernels && utils::cpu_supports_avx2();
+#endif
+    return workspace;
+}
+
+}  // namespace dorado::basecall::decode
+
+namespace {
+
+using dorado::basecall::decode::BeamSearchWorkspace;
+
 float log_sum_exp(float x, float y) {
     float abs_diff = std::abs(x - y);
     return std::max(x, y) + ((abs_diff < 17.0f) ? (std::log1p(std::exp(-abs_diff))) : 0.0f);
@@ -51,19 +89,26 @@ int get_num_states(size_t num_trans_states) {
     return int(num_trans_states / NUM_BASES);
 }
 
-std::tuple<std::string, std::string> generate_sequence(const std::vector<uint8_t>& moves,
-                                                       const std::vector<int32_t>& states,
-                                                       const std::vector<float>& qual_data,
-                                                       float shift,
-                                                       float scale) {
+// Writes the sequence and qstring into |sequence| and |qstring|, reusing their capacity.
+void generate_sequence(const std::vector<uint8_t>& moves,
+                       BeamSearchWorkspace& workspace,
+                       float shift,
+                       float scale,
+                       std::string& sequence,
+                       std::string& qstring) {
+    const auto& states = workspace.states;
+    const auto& qual_data = workspace.qual_data;
     size_t seqPos = 0;
     size_t num_blocks = moves.size();
     size_t seqLen = accumulate(moves.begin(), moves.end(), 0);
 
-    std::string sequence(seqLen, 'N');
-    std::string qstring(seqLen, '!');
+    sequence.assign(seqLen, 'N');
+    qstring.assign(seqLen, '!');
     std::array<char, 4> alphabet = {'A', 'C', 'G', 'T'};
-    std::vector<float> baseProbs(seqLen), totalProbs(seqLen);
+    auto& baseProbs = workspace.base_probs;
+    auto& totalProbs = workspace.total_probs;
+    baseProbs.assign(seqLen, 0.0f);
+    totalProbs.assign(seqLen, 0.0f);
 
     for (size_t blk = 0; blk < num_blocks; ++blk) {
         int state = states[blk];
@@ -97,32 +142,13 @@ std::tuple<std::string, std::string> generate_sequence(const std::vector<uint8_t
         qscore = std::clamp(qscore, 1.0f, 50.0f);
         qstring[i] = static_cast<char>(33.5f + qscore);
     }
-
-    return make_tuple(std::move(sequence), std::move(qstring));
-}
-
-// Incorporates NUM_NEW_BITS into a Castagnoli CRC32, aka CRC32C
-// (not the same polynomial as CRC32 as used in zip/ethernet).
-template <int NUM_NEW_BITS>
-uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
-    // Note that this is the reversed polynomial.
-    constexpr uint32_t POLYNOMIAL = 0x82f63b78u;
-    for (int i = 0; i < NUM_NEW_BITS; ++i) {
-        auto b = (new_bits ^ crc) & 1;
-        crc >>= 1;
-        if (b) {
-            crc ^= POLYNOMIAL;
-        }
-        new_bits >>= 1;
-    }
-    return crc;
 }
 
 }  // anonymous namespace
 
 namespace dorado::basecall::decode {
 
-template <typename T, typename U>
+template <typename T, typename U, typename Kernels>
 float beam_search(const T* const scores,
                   size_t scores_block_stride,
                   const float* const back_guide,
@@ -132,9 +158,8 @@ float beam_search(const T* const scores,
                   size_t max_beam_width,
                   float beam_cut,
                   float fixed_stay_score,
-                  std::vector<int32_t>& states,
+                  BeamSearchWorkspace& workspace,
                   std::vector<uint8_t>& moves,
-                  std::vector<float>& qual_data,
                   float score_scale,
                   float posts_scale) {
     const size_t num_states = 1ull << num_state_bits;
@@ -150,29 +175,34 @@ float beam_search(const T* const scores,
             (beam_cut > 0.0f) ? logf(beam_cut) : std::numeric_limits<float>::max();
 
     // Create the beam.  We need to keep beam_width elements for each block, plus the initial state
-    std::vector<BeamElement> beam_vector(max_beam_width * (num_blocks + 1));
+    auto& beam_vector = workspace.beam_vector;
+    beam_vector.assign(max_beam_width * (num_blocks + 1), {});
 
     // Create the previous and current beam fronts
     // Each existing element can be extended by one of NUM_BASES, or be a stay.
     size_t max_beam_candidates = (NUM_BASES + 1) * max_beam_width;
 
-    std::vector<BeamFrontElement> current_beam_front(max_beam_candidates);
-    std::vector<BeamFrontElement> prev_beam_front(max_beam_candidates);
+    auto& current_beam_front = workspace.current_beam_front;
+    auto& prev_beam_front = workspace.prev_beam_front;
+    current_beam_front.assign(max_beam_candidates, {});
+    prev_beam_front.assign(max_beam_candidates, {});
 
-    std::vector<float> current_scores(max_beam_candidates);
-    std::vector<float> prev_scores(max_beam_candidates);
+    auto& current_scores = workspace.current_scores;
+    auto& prev_scores = workspace.prev_scores;
+    current_scores.assign(max_beam_candidates, 0.0f);
+    prev_scores.assign(max_beam_candidates, 0.0f);
 
     // Find the score an initial element needs in order to make it into the beam
-    T beam_init_threshold = std::numeric_limits<T>::lowest();
+    float beam_init_threshold = std::numeric_limits<float>::lowest();
     if (max_beam_width < num_states) {
         // Copy the first set of back guides and sort to extract max_beam_width highest elements
-        std::vector<T> sorted_back_guides(num_states);
-        std::memcpy(sorted_back_guides.data(), back_guide, num_states * sizeof(T));
+        auto& sorted_back_guides = workspace.sorted_back_guides;
+        sorted_back_guides.assign(back_guide, back_guide + num_states);
 
         // Note we don't need a full sort here to get the max_beam_width highest values
         std::nth_element(sorted_back_guides.begin(),
                          sorted_back_guides.begin() + max_beam_width - 1, sorted_back_guides.end(),
-                         std::greater<T>());
+                         std::greater<float>());
         beam_init_threshold = sorted_back_guides[max_beam_width - 1];
     }
 
@@ -181,7 +211,7 @@ float beam_search(const T* const scores,
          state++) {
         if (back_guide[state] >= beam_init_threshold) {
             // Note that this first element has a prev_element_index of 0
-            prev_beam_front[beam_element] = {crc32c<32>(CRC_SEED, uint32_t(state)),
+            prev_beam_front[beam_element] = {Kernels::hash_state(CRC_SEED, uint32_t(state)),
                                              static_cast<state_t>(state), 0, false};
             prev_scores[beam_element] = 0.0f;
             ++beam_element;
@@ -246,7 +276,7 @@ float beam_search(const T* const scores,
                         (((previous_element.state << NUM_BASE_BITS) >> num_state_bits)));
                 float new_score = prev_scores[prev_elem_idx] + fetch_block_score(move_idx) +
                                   static_cast<float>(block_back_scores[new_state]);
-                uint32_t new_hash = crc32c<NUM_BASE_BITS>(previous_element.hash, new_base);
+                uint32_t new_hash = Kernels::hash_base(previous_element.hash, new_base);
 
                 step_hash_present[new_hash & HASH_PRESENT_MASK] = true;
 
@@ -312,46 +342,8 @@ float beam_search(const T* const scores,
 
         auto get_elem_count = [new_elem_count, &beam_cutoff_score, &current_scores]() {
             // Count the elements which meet the beam cutoff.
-            size_t elem_count = 0;
-            const float* score_ptr = current_scores.data();
-#if !ENABLE_NEON_IMPL
-            for (int i = int(new_elem_count); i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#else
-            uint32x4_t counts_x4_a = vdupq_n_u32(0u);
-            uint32x4_t counts_x4_b = vdupq_n_u32(0u);
-            const float32x4_t cutoff_x4 = vdupq_n_f32(beam_cutoff_score);
-
-            // 8 fold unrolled version has the small upside that both loads
-            // can be done with a single ldp instruction.
-            const int kUnroll = 8;
-            for (int i = int(new_elem_count) / kUnroll; i; --i) {
-                // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
-                // which we subtract to increment our counts.
-                float32x4_t scores_x4_a = vld1q_f32(score_ptr);
-                uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
-                counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
-
-                float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
-                uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
-                counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
-
-                score_ptr += 8;
-            }
-            // Add together the result of 2 horizontal adds.
-            elem_count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
-            for (int i = new_elem_count % kUnroll; i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#endif
-            return elem_count;
+            return Kernels::count_at_least(current_scores.data(), new_elem_count,
+                                           beam_cutoff_score);
         };
 
         // Count the elements which meet the min score
@@ -395,18 +387,9 @@ float beam_search(const T* const scores,
             elem_count = std::min(elem_count, max_beam_width);
         }
 
-        size_t write_idx = 0;
-        for (size_t read_idx = 0; read_idx < new_elem_count; ++read_idx) {
-            if (current_scores[read_idx] >= beam_cutoff_score) {
-                if (write_idx < max_beam_width) {
-                    prev_beam_front[write_idx] = current_beam_front[read_idx];
-                    prev_scores[write_idx] = current_scores[read_idx];
-                    ++write_idx;
-                } else {
-                    break;
-                }
-            }
-        }
+        Kernels::select_at_least(current_beam_front.data(), current_scores.data(),
+                                 new_elem_count, beam_cutoff_score, max_beam_width,
+                                 prev_beam_front.data(), prev_scores.data());
 
         // At the last timestep, we need to ensure the best path corresponds to element 0.
         // The other elements don't matter.
@@ -441,6 +424,7 @@ float beam_search(const T* const scores,
     const float final_score = prev_scores[0];
 
     // Write out sequence bases and move table
+    auto& states = workspace.states;
     moves.resize(num_blocks);
     states.resize(num_blocks);
 
@@ -455,6 +439,8 @@ float beam_search(const T* const scores,
     moves[0] = 1;  // Always step in the first event
 
     int shifted_states[2 * NUM_BASES];
+    auto& qual_data = workspace.qual_data;
+    qual_data.resize(num_blocks * NUM_BASES);
 
     // Compute per-base qual data
     for (size_t block_idx = 0; block_idx < num_blocks; ++block_idx) {
@@ -519,16 +505,38 @@ float beam_search(const T* const scores,
     return final_score;
 }
 
-std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
-        const at::Tensor& scores_t,
-        const at::Tensor& back_guides_t,
-        const at::Tensor& posts_t,
-        size_t max_beam_width,
-        float beam_cut,
-        float fixed_stay_score,
-        float q_shift,
-        float q_scale,
-        float byte_score_scale) {
+#if ENABLE_AVX2_IMPL
+// A copy of the beam search compiled for AVX2.  Flattening inlines the AVX2 kernels, which
+// can't be inlined into code compiled for the default target.
+template <typename T, typename U, typename... Args>
+__attribute__((target("avx2,sse4.2"), flatten)) float beam_search_avx2(Args&&... args) {
+    return beam_search<T, U, beam_search_kernels::Avx2Kernels>(std::forward<Args>(args)...);
+}
+#endif
+
+template <typename T, typename U, typename... Args>
+float run_beam_search(bool use_avx2_kernels, Args&&... args) {
+#if ENABLE_AVX2_IMPL
+    if (use_avx2_kernels) {
+        return beam_search_avx2<T, U>(std::forward<Args>(args)...);
+    }
+#else
+    (void)use_avx2_kernels;
+#endif
+    return beam_search<T, U, beam_search_kernels::DefaultKernels>(std::forward<Args>(args)...);
+}
+
+void beam_search_decode(const at::Tensor& scores_t,
+                        const at::Tensor& back_guides_t,
+                        const at::Tensor& posts_t,
+                        size_t max_beam_width,
+                        float beam_cut,
+                        float fixed_stay_score,
+                        float q_shift,
+                        float q_scale,
+                        float byte_score_scale,
+                        BeamSearchWorkspace& workspace,
+                        DecodedChunk& result) {
     const int num_blocks = int(scores_t.size(0));
     const int num_states = get_num_states(scores_t.size(1));
     const int num_state_bits = static_cast<int>(std::log2(num_states));
@@ -547,9 +555,7 @@ std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
     // scores_t may come from a tensor with chunks interleaved, but make sure the last dimension is contiguous
     auto scores_block_contig = (scores_t.stride(1) == 1) ? scores_t : scores_t.contiguous();
 
-    std::vector<int32_t> states(num_blocks);
-    std::vector<uint8_t> moves(num_blocks);
-    std::vector<float> qual_data(num_blocks * NUM_BASES);
+    auto& moves = result.moves;
 
     const size_t scores_block_stride = scores_block_contig.stride(0);
     if (scores_t.dtype() == at::ScalarType::Float) {
@@ -563,9 +569,10 @@ std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
         const auto back_guides = back_guides_contig->data_ptr<float>();
         const auto posts = posts_contig->data_ptr<float>();
 
-        beam_search<float, float>(scores, scores_block_stride, back_guides, posts, num_state_bits,
-                                  num_blocks, max_beam_width, beam_cut, fixed_stay_score, states,
-                                  moves, qual_data, 1.0f, 1.0f);
+        run_beam_search<float, float>(workspace.use_avx2_kernels, scores, scores_block_stride,
+                                      back_guides, posts, num_state_bits, num_blocks,
+                                      max_beam_width, beam_cut, fixed_stay_score, workspace, moves,
+                                      1.0f, 1.0f);
     } else if (scores_t.dtype() == at::kChar) {
         // If the scores are 8 bit, the posterior probabilities must be 16 bit (Apple path).
         if (posts_t.dtype() != at::ScalarType::Short) {
@@ -577,10 +584,10 @@ std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
         const auto back_guides = back_guides_contig->data_ptr<float>();
         const auto posts = posts_contig->data_ptr<int16_t>();
         const float posts_scale = static_cast<float>(1.0 / 32767.0);
-        beam_search<int8_t, int16_t>(scores, scores_block_stride, back_guides, posts,
-                                     num_state_bits, num_blocks, max_beam_width, beam_cut,
-                                     fixed_stay_score, states, moves, qual_data, byte_score_scale,
-                                     posts_scale);
+        run_beam_search<int8_t, int16_t>(workspace.use_avx2_kernels, scores, scores_block_stride,
+                                         back_guides, posts, num_state_bits, num_blocks,
+                                         max_beam_width, beam_cut, fixed_stay_score, workspace,
+                                         moves, byte_score_scale, posts_scale);
 
     } else if (scores_t.dtype() == at::kHalf) {
         if (posts_t.dtype() != at::ScalarType::Float) {
@@ -591,18 +598,34 @@ std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
         const auto scores = scores_block_contig.data_ptr<c10::Half>();
         const auto back_guides = back_guides_contig->data_ptr<float>();
         const auto posts = posts_contig->data_ptr<float>();
-        beam_search<c10::Half, float>(scores, scores_block_stride, back_guides, posts,
-                                      num_state_bits, num_blocks, max_beam_width, beam_cut,
-                                      fixed_stay_score, states, moves, qual_data, 1.0f, 1.0f);
+        run_beam_search<c10::Half, float>(workspace.use_avx2_kernels, scores, scores_block_stride,
+                                          back_guides, posts, num_state_bits, num_blocks,
+                                          max_beam_width, beam_cut, fixed_stay_score, workspace,
+                                          moves, 1.0f, 1.0f);
 
     } else {
         throw std::runtime_error(std::string("beam_search_decode: unsupported tensor type ") +
                                  std::string(scores_t.dtype().name()));
     }
 
-    auto [sequence, qstring] = generate_sequence(moves, states, qual_data, q_shift, q_scale);
+    generate_sequence(moves, workspace, q_shift, q_scale, result.sequence, result.qstring);
+}
 
-    return {std::move(sequence), std::move(qstring), std::move(moves)};
+std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
+        const at::Tensor& scores_t,
+        const at::Tensor& back_guides_t,
+        const at::Tensor& posts_t,
+        size_t max_beam_width,
+        float beam_cut,
+        float fixed_stay_score,
+        float q_shift,
+        float q_scale,
+        float byte_score_scale) {
+    thread_local auto workspace = create_beam_search_workspace();
+    DecodedChunk result;
+    beam_search_decode(scores_t, back_guides_t, posts_t, max_beam_width, beam_cut,
+                       fixed_stay_score, q_shift, q_scale, byte_score_scale, *workspace, result);
+    return {std::move(result.sequence), std::move(result.qstring), std::move(result.moves)};
 }
 
 }  // namespace dorado::basecall::decode
@@ -4,11 +4,41 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
 
 namespace dorado::basecall::decode {
+
+struct DecodedChunk;
+
+// The beam and other working buffers of a decode. They keep their capacity between chunks, so
+// they only grow when a chunk is bigger than any decoded with them before. A workspace must only
+// be used by one thread at a time.
+// The workspace also picks the kernels: the SIMD ones where the CPU supports them, unless
+// |use_simd_kernels| is false, which tests use to compare them with the portable kernels.
+struct BeamSearchWorkspace;
+struct BeamSearchWorkspaceDeleter {
+    void operator()(BeamSearchWorkspace* workspace) const;
+};
+using BeamSearchWorkspacePtr = std::unique_ptr<BeamSearchWorkspace, BeamSearchWorkspaceDeleter>;
+BeamSearchWorkspacePtr create_beam_search_workspace(bool use_simd_kernels = true);
+
+// Decodes a chunk into |result|, reusing the capacity of its sequence, qstring and moves.
+void beam_search_decode(const at::Tensor& scores_t,
+                        const at::Tensor& back_guides_t,
+                        const at::Tensor& posts_t,
+                        size_t max_beam_width,
+                        float beam_cut,
+                        float fixed_stay_score,
+                        float q_shift,
+                        float q_scale,
+                        float byte_score_scale,
+                        BeamSearchWorkspace& workspace,
+                        DecodedChunk& result);
+
+// As above, with a workspace kept between calls on the same thread.
 std::tuple<std::string, std::string, std::vector<uint8_t>> beam_search_decode(
         const at::Tensor& scores_t,
         const at::Tensor& back_guides_t,
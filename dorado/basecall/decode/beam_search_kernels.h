@@ -0,0 +1,175 @@
+#pragma once
+
+#include "utils/simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// The inner loops of the beam search.  DefaultKernels are the portable implementations, and
+// Avx2Kernels the x86 ones, which must give bit-identical results.
+namespace dorado::basecall::decode::beam_search_kernels {
+
+// Incorporates NUM_NEW_BITS into a Castagnoli CRC32, aka CRC32C
+// (not the same polynomial as CRC32 as used in zip/ethernet).
+template <int NUM_NEW_BITS>
+uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
+    // Note that this is the reversed polynomial.
+    constexpr uint32_t POLYNOMIAL = 0x82f63b78u;
+    for (int i = 0; i < NUM_NEW_BITS; ++i) {
+        auto b = (new_bits ^ crc) & 1;
+        crc >>= 1;
+        if (b) {
+            crc ^= POLYNOMIAL;
+        }
+        new_bits >>= 1;
+    }
+    return crc;
+}
+
+struct DefaultKernels {
+    // Hash of the initial state of a beam element.
+    static uint32_t hash_state(uint32_t crc, uint32_t state) { return crc32c<32>(crc, state); }
+
+    // Hash of a beam element extended by |base|, which must be less than 4.
+    static uint32_t hash_base(uint32_t crc, uint32_t base) { return crc32c<2>(crc, base); }
+
+    // Counts the scores which are at least |cutoff|.
+    static size_t count_at_least(const float* scores, size_t num_scores, float cutoff) {
+        size_t count = 0;
+        const float* score_ptr = scores;
+#if !ENABLE_NEON_IMPL
+        for (size_t i = num_scores; i; --i) {
+            if (*score_ptr >= cutoff) {
+                ++count;
+            }
+            ++score_ptr;
+        }
+#else
+        uint32x4_t counts_x4_a = vdupq_n_u32(0u);
+        uint32x4_t counts_x4_b = vdupq_n_u32(0u);
+        const float32x4_t cutoff_x4 = vdupq_n_f32(cutoff);
+
+        // 8 fold unrolled version has the small upside that both loads
+        // can be done with a single ldp instruction.
+        const size_t kUnroll = 8;
+        for (size_t i = num_scores / kUnroll; i; --i) {
+            // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
+            // which we subtract to increment our counts.
+            float32x4_t scores_x4_a = vld1q_f32(score_ptr);
+            uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
+            counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
+
+            float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
+            uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
+            counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
+
+            score_ptr += 8;
+        }
+        // Add together the result of 2 horizontal adds.
+        count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
+        for (size_t i = num_scores % kUnroll; i; --i) {
+            if (*score_ptr >= cutoff) {
+                ++count;
+            }
+            ++score_ptr;
+        }
+#endif
+        return count;
+    }
+
+    // Copies, in order, up to |max_selected| elements whose scores are at least |cutoff|, along
+    // with their scores.  Returns the number copied.
+    template <typename Element>
+    static size_t select_at_least(const Element* elements,
+                                  const float* scores,
+                                  size_t num_scores,
+                                  float cutoff,
+                                  size_t max_selected,
+                                  Element* selected,
+                                  float* selected_scores) {
+        size_t num_selected = 0;
+        for (size_t i = 0; i < num_scores && num_selected < max_selected; ++i) {
+            if (scores[i] >= cutoff) {
+                selected[num_selected] = elements[i];
+                selected_scores[num_selected] = scores[i];
+                ++num_selected;
+            }
+        }
+        return num_selected;
+    }
+};
+
+#if ENABLE_AVX2_IMPL
+// The beam search copy which uses these is compiled for AVX2 as a whole, so the kernels are
+// inlined into it.
+struct Avx2Kernels {
+    __attribute__((target("avx2,sse4.2"))) static uint32_t hash_state(uint32_t crc,
+                                                                      uint32_t state) {
+        return _mm_crc32_u32(crc, state);
+    }
+
+    // The CRC instruction takes at least 8 bits, so the base is put in the top 2 bits of a byte
+    // hashed from a zero CRC: the 6 zero bits before it leave the CRC unchanged.
+    __attribute__((target("avx2,sse4.2"))) static uint32_t hash_base(uint32_t crc,
+                                                                     uint32_t base) {
+        crc ^= base;
+        return (crc >> 2) ^ _mm_crc32_u8(0, static_cast<uint8_t>((crc & 3) << 6));
+    }
+
+    __attribute__((target("avx2,sse4.2"))) static size_t count_at_least(const float* scores,
+                                                                        size_t num_scores,
+                                                                        float cutoff) {
+        const __m256 cutoff_x8 = _mm256_set1_ps(cutoff);
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 8 <= num_scores; i += 8) {
+            // Ordered comparisons are false for NaN, as with the scalar comparison.
+            const __m256 comparisons =
+                    _mm256_cmp_ps(_mm256_loadu_ps(scores + i), cutoff_x8, _CMP_GE_OQ);
+            count += __builtin_popcount(_mm256_movemask_ps(comparisons));
+        }
+        for (; i < num_scores; ++i) {
+            if (scores[i] >= cutoff) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    template <typename Element>
+    __attribute__((target("avx2,sse4.2"))) static size_t select_at_least(const Element* elements,
+                                                                         const float* scores,
+                                                                         size_t num_scores,
+                                                                         float cutoff,
+                                                                         size_t max_selected,
+                                                                         Element* selected,
+                                                                         float* selected_scores) {
+        const __m256 cutoff_x8 = _mm256_set1_ps(cutoff);
+        size_t num_selected = 0;
+        size_t i = 0;
+        // Compare 8 scores at a time, and copy the elements for the set bits of the mask.
+        for (; i + 8 <= num_scores && num_selected < max_selected; i += 8) {
+            const __m256 comparisons =
+                    _mm256_cmp_ps(_mm256_loadu_ps(scores + i), cutoff_x8, _CMP_GE_OQ);
+            auto mask = static_cast<uint32_t>(_mm256_movemask_ps(comparisons));
+            while (mask != 0 && num_selected < max_selected) {
+                const size_t idx = i + __builtin_ctz(mask);
+                selected[num_selected] = elements[idx];
+                selected_scores[num_selected] = scores[idx];
+                ++num_selected;
+                mask &= mask - 1;
+            }
+        }
+        for (; i < num_scores && num_selected < max_selected; ++i) {
+            if (scores[i] >= cutoff) {
+                selected[num_selected] = elements[i];
+                selected_scores[num_selected] = scores[i];
+                ++num_selected;
+            }
+        }
+        return num_selected;
+    }
+};
+#endif
+
+}  // namespace dorado::basecall::decode::beam_search_kernels
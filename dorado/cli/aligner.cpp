@@ -17,15 +17,20 @@
 #include "utils/log_utils.h"
 #include "utils/stats.h"
 #include "utils/tty_utils.h"
+#include "utils/types.h"
 
+#include <htslib/thread_pool.h>
 #include <minimap.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_set>
@@ -40,6 +45,8 @@ using namespace std::chrono_literals;
 namespace {
 
 constexpr size_t BAM_BUFFER_SIZE = 1000000000;  // 1 GB
+// Bound on the number of input files being read, aligned and written at once.
+constexpr size_t MAX_FILES_IN_FLIGHT = 4;
 
 std::shared_ptr<dorado::alignment::IndexFileAccess> load_index(
         const std::string& filename,
@@ -248,20 +255,75 @@ int aligner(int argc, char* argv[]) {
 
     ReadOutputProgressStats progress_stats(
             std::chrono::seconds{progress_stats_frequency}, all_files.size(),
-            ReadOutputProgressStats::StatsCollectionMode::collector_per_input_file);
+            ReadOutputProgressStats::StatsCollectionMode::single_collector);
     progress_stats.set_post_processing_percentage(0.5f);
     progress_stats.start();
 
-    auto client_info = std::make_shared<DefaultClientInfo>();
-    client_info->contexts().register_context<const alignment::AlignmentInfo>(align_info);
+    // One pipeline is shared by all the input files, rather than one being built and drained
+    // per file. Each file's records are routed to its own output by the HtsWriter.
+    PipelineDescriptor pipeline_desc;
+    auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, "");
+    auto aligner = pipeline_desc.add_node<AlignerNode>(
+            {hts_writer}, index_file_access, bed_file_access, align_info->reference_file,
+            align_info->bed_file, align_info->minimap_options, aligner_threads);
+
+    // Create the Pipeline from our description.
+    std::vector<dorado::stats::StatsReporter> stats_reporters;
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+    if (pipeline == nullptr) {
+        spdlog::error("Failed to create pipeline");
+        return EXIT_FAILURE;
+    }
+
+    // At present, header output file header writing relies on direct node method calls
+    // rather than the pipeline framework.
+    const auto& aligner_ref = dynamic_cast<AlignerNode&>(pipeline->get_node_ref(aligner));
+    const auto sequence_records = aligner_ref.get_sequence_records_for_header();
+
+    // All progress reporting is in the post-processing part.
+    ProgressTracker tracker(0, false, 1.f);
+    if (progress_stats_frequency > 0) {
+        tracker.disable_progress_reporting();
+    }
+    tracker.set_description("Aligning");
+
+    // Files are finalised concurrently, so updates to the tracker are serialised.
+    std::mutex progress_mutex;
+    size_t num_files_finalised = 0;
+
+    // Set up stats counting
+    std::vector<dorado::stats::StatsCallable> stats_callables;
+    stats_callables.push_back([&tracker, &progress_mutex](const stats::NamedStats& stats) {
+        std::lock_guard lock(progress_mutex);
+        tracker.update_progress_bar(stats);
+    });
+    stats_callables.push_back([&progress_stats](const stats::NamedStats& stats) {
+        progress_stats.update_stats(stats);
+    });
+    constexpr auto kStatsPeriod = 100ms;
+    auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
+            kStatsPeriod, stats_reporters, stats_callables, static_cast<size_t>(0));
+
+    // All the output files compress using one pool of threads.
+    HtsTpoolPtr output_thread_pool(hts_tpool_init(std::max(writer_threads, 1)));
+    if (!output_thread_pool) {
+        spdlog::error("Could not create thread pool for BAM output.");
+        return EXIT_FAILURE;
+    }
 
-    for (const auto& file_info : all_files) {
+    // The sort buffers of the files in flight share the memory a single file would have used.
+    const size_t num_files_in_flight = std::min(all_files.size(), MAX_FILES_IN_FLIGHT);
+    const size_t bam_buffer_size = BAM_BUFFER_SIZE / num_files_in_flight;
+
+    // Reads a file into the pipeline, waits for all of its records to be written, then
+    // finalises its output. Returns false if the file couldn't be processed.
+    auto align_file = [&](const alignment::AlignmentProcessingInfo& file_info) {
         spdlog::info("processing {} -> {}", file_info.input, file_info.output);
         auto reader = std::make_unique<HtsReader>(file_info.input, std::nullopt);
-        reader->set_client_info(client_info);
+        reader->set_num_threads(writer_threads);
         if (file_info.output != "-" &&
             !create_output_folder(std::filesystem::path(file_info.output).parent_path())) {
-            return EXIT_FAILURE;
+            return false;
         }
 
         spdlog::debug("> input fmt: {} aligned: {}", reader->format(), reader->is_aligned);
@@ -269,82 +331,91 @@ int aligner(int argc, char* argv[]) {
         utils::add_hd_header_line(header.get());
         add_pg_hdr(header.get());
         dorado::utils::strip_alignment_data_from_header(header.get());
+        utils::add_sq_hdr(header.get(), sequence_records);
 
         const bool sort_bam = (file_info.output_mode == utils::HtsFile::OutputMode::BAM &&
                                file_info.output != "-");
-        utils::HtsFile hts_file(file_info.output, file_info.output_mode, writer_threads, sort_bam);
+        auto hts_file = std::make_unique<utils::HtsFile>(file_info.output, file_info.output_mode,
+                                                         0, sort_bam);
+        hts_file->set_thread_pool(output_thread_pool.get());
         if (sort_bam) {
-            hts_file.set_buffer_size(BAM_BUFFER_SIZE);
+            hts_file->set_buffer_size(bam_buffer_size);
         }
-        PipelineDescriptor pipeline_desc;
-        auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, hts_file, "");
-        auto aligner = pipeline_desc.add_node<AlignerNode>(
-                {hts_writer}, index_file_access, bed_file_access, align_info->reference_file,
-                align_info->bed_file, align_info->minimap_options, aligner_threads);
-
-        // Create the Pipeline from our description.
-        std::vector<dorado::stats::StatsReporter> stats_reporters;
-        auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
-        if (pipeline == nullptr) {
-            spdlog::error("Failed to create pipeline");
-            return EXIT_FAILURE;
+        hts_file->set_header(header.get());
+
+        // The file gets a client of its own, which routes its records to its output. Each
+        // record is counted as pending as it's pushed, so the file is known to be complete
+        // once the reader has finished and the count has dropped to 0.
+        auto counts = std::make_shared<HtsWriterOutput>(*hts_file);
+        auto client_info = std::make_shared<DefaultClientInfo>();
+        client_info->contexts().register_context<const alignment::AlignmentInfo>(align_info);
+        client_info->contexts().register_context<HtsWriterOutput>(counts);
+        reader->set_client_info(std::move(client_info));
+        reader->set_record_mutator([&counts](BamPtr&) { counts->add_pending(1); });
+        {
+            // Records already pushed are still written to the file if reading fails.
+            auto wait_until_written = utils::PostCondition([&] { counts->wait_until_written(); });
+            auto num_reads_in_file = reader->read(*pipeline, max_reads);
+            progress_stats.update_reads_per_file_estimate(num_reads_in_file);
         }
 
-        // At present, header output file header writing relies on direct node method calls
-        // rather than the pipeline framework.
-        const auto& aligner_ref = dynamic_cast<AlignerNode&>(pipeline->get_node_ref(aligner));
-        utils::add_sq_hdr(header.get(), aligner_ref.get_sequence_records_for_header());
-        auto& hts_writer_ref = dynamic_cast<HtsWriter&>(pipeline->get_node_ref(hts_writer));
-        hts_file.set_header(header.get());
-
-        // All progress reporting is in the post-processing part.
-        ProgressTracker tracker(0, false, 1.f);
-        if (progress_stats_frequency > 0) {
-            tracker.disable_progress_reporting();
+        if (!hts_file->finalise_is_noop()) {
+            spdlog::info("> merging temporary BAM files for {}", file_info.output);
         }
-        tracker.set_description("Aligning");
-
-        // Set up stats counting
-        std::vector<dorado::stats::StatsCallable> stats_callables;
-        stats_callables.push_back(
-                [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
-        stats_callables.push_back([&progress_stats](const stats::NamedStats& stats) {
-            progress_stats.update_stats(stats);
-        });
-        constexpr auto kStatsPeriod = 100ms;
-        auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
-                kStatsPeriod, stats_reporters, stats_callables, static_cast<size_t>(0));
-
-        spdlog::info("> starting alignment");
-        auto num_reads_in_file = reader->read(*pipeline, max_reads);
-
-        // Wait for the pipeline to complete.  When it does, we collect
-        // final stats to allow accurate summarisation.
-        auto final_stats = pipeline->terminate(DefaultFlushOptions());
-
-        // Stop the stats sampler thread before tearing down any pipeline objects.
-        stats_sampler->terminate();
-        tracker.update_progress_bar(final_stats);
-        progress_stats.update_reads_per_file_estimate(num_reads_in_file);
-        progress_stats.notify_stats_collector_completed(final_stats);
-
-        spdlog::info("> finished alignment");
-
-        // Report progress during output file finalisation.
-        if (!hts_file.finalise_is_noop()) {
-            spdlog::info("> merging temporary BAM files");
+        hts_file->finalise([](size_t) { /* progress is reported per file */ });
+        {
+            std::lock_guard lock(progress_mutex);
+            ++num_files_finalised;
+            const float progress = 100.f * num_files_finalised / all_files.size();
+            tracker.update_post_processing_progress(progress);
+            progress_stats.update_post_processing_progress(progress);
         }
-        tracker.set_description("Merging temporary BAM files");
-        hts_file.finalise([&](size_t progress) {
-            tracker.update_post_processing_progress(static_cast<float>(progress));
-            progress_stats.update_post_processing_progress(static_cast<float>(progress));
-        });
-
-        progress_stats.notify_post_processing_completed();
-        tracker.summarize();
+        spdlog::info("> {} total/primary/unmapped {}/{}/{}", file_info.output, counts->total,
+                     counts->primary, counts->unmapped);
+        return true;
+    };
+
+    // The pipeline runs for the whole of the alignment. Each of up to MAX_FILES_IN_FLIGHT
+    // workers takes the next file as soon as its previous one is finalised, so files are read,
+    // aligned and finalised at the same time, with at most that many sort buffers alive.
+    spdlog::info("> starting alignment");
+    std::atomic<size_t> next_file{0};
+    std::atomic<bool> failed{false};
+    auto file_worker = [&] {
+        for (size_t i = next_file++; i < all_files.size() && !failed; i = next_file++) {
+            try {
+                if (!align_file(all_files[i])) {
+                    failed = true;
+                }
+            } catch (...) {
+                failed = true;
+                throw;
+            }
+        }
+    };
+    std::vector<std::future<void>> file_workers;
+    for (size_t i = 0; i < num_files_in_flight; ++i) {
+        file_workers.push_back(std::async(std::launch::async, file_worker));
+    }
+    // Every worker has waited for its files' records before any error is rethrown, so
+    // nothing is still writing to a file when it's destroyed.
+    for (auto& worker : file_workers) {
+        worker.wait();
+    }
+    auto final_stats = pipeline->terminate(DefaultFlushOptions());
+    for (auto& worker : file_workers) {
+        // Rethrows any error from processing a file.
+        worker.get();
+    }
 
-        spdlog::info("> total/primary/unmapped {}/{}/{}", hts_writer_ref.get_total(),
-                     hts_writer_ref.get_primary(), hts_writer_ref.get_unmapped());
+    // Stop the stats sampler thread before tearing down any pipeline objects.
+    stats_sampler->terminate();
+    tracker.update_progress_bar(final_stats);
+    progress_stats.notify_stats_collector_completed(final_stats);
+    tracker.summarize();
+    spdlog::info("> finished alignment");
+    if (failed) {
+        return EXIT_FAILURE;
     }
 
     progress_stats.report_final_stats();
@@ -352,6 +423,7 @@ int aligner(int argc, char* argv[]) {
     if (emit_summary) {
         spdlog::info("> generating summary file");
         SummaryData summary(SummaryData::ALIGNMENT_FIELDS);
+        summary.set_num_threads(threads);
         auto summary_file = std::filesystem::path(output_folder) / "alignment_summary.txt";
         std::ofstream summary_out(summary_file.string());
         summary.process_tree(output_folder, summary_out);
@@ -26,13 +26,16 @@
 #include "read_pipeline/ReadFilterNode.h"
 #include "read_pipeline/ReadToBamTypeNode.h"
 #include "read_pipeline/ResumeLoader.h"
+#include "read_pipeline/SequencingSummaryNode.h"
 #include "read_pipeline/TrimmerNode.h"
 #include "torch_utils/auto_detect_device.h"
 #include "utils/SampleSheet.h"
 #include "utils/arg_parse_ext.h"
+#include "utils/bam_pool.h"
 #include "utils/bam_utils.h"
 #include "utils/barcode_kits.h"
 #include "utils/basecaller_utils.h"
+#include "utils/read_id_set.h"
 #include "utils/string_utils.h"
 
 #include <argparse.hpp>
@@ -186,6 +189,13 @@ void set_dorado_basecaller_args(utils::arg_parse::ArgParser& parser, int& verbos
                 .help("Write the move table to the 'mv' tag.")
                 .default_value(false)
                 .implicit_value(true);
+        parser.visible.add_argument("--emit-summary")
+                .help("Also write a sequencing summary to this file as reads are basecalled.")
+                .default_value(std::string(""));
+        parser.visible.add_argument("--emit-summary-columns")
+                .help("Also write a sequencing summary to this file, in a compressed columnar "
+                      "binary format, as reads are basecalled.")
+                .default_value(std::string(""));
         cli::add_basecaller_output_arguments(parser);
     }
     {
@@ -304,6 +314,8 @@ void setup(const std::vector<std::string>& args,
            float methylation_threshold_pct,
            std::unique_ptr<utils::HtsFile> hts_file,
            bool emit_moves,
+           const std::string& summary_file,
+           const std::string& summary_columns_file,
            size_t max_reads,
            size_t min_qscore,
            const std::string& read_list_file_path,
@@ -476,6 +488,14 @@ void setup(const std::vector<std::string>& args,
     auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, *hts_file, gpu_names);
     auto aligner = PipelineDescriptor::InvalidNodeHandle;
     auto current_sink_node = hts_writer;
+    auto summary_node = PipelineDescriptor::InvalidNodeHandle;
+    if (!summary_file.empty() || !summary_columns_file.empty()) {
+        summary_node = api::add_sequencing_summary_node(pipeline_desc, summary_file,
+                                                        summary_columns_file,
+                                                        thread_allocations.writer_threads,
+                                                        current_sink_node);
+        current_sink_node = summary_node;
+    }
     if (enable_aligner) {
         auto index_file_access = std::make_shared<alignment::IndexFileAccess>();
         auto bed_file_access = std::make_shared<alignment::BedFileAccess>();
@@ -537,7 +557,8 @@ void setup(const std::vector<std::string>& args,
             current_sink_node, PipelineDescriptor::InvalidNodeHandle);
 
     // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters{dorado::stats::sys_stats_report};
+    std::vector<dorado::stats::StatsReporter> stats_reporters{dorado::stats::sys_stats_report,
+                                                              utils::bam_pool_stats_report};
     auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
     if (pipeline == nullptr) {
         spdlog::error("Failed to create pipeline");
@@ -552,8 +573,14 @@ void setup(const std::vector<std::string>& args,
         utils::add_sq_hdr(hdr.get(), aligner_ref.get_sequence_records_for_header());
     }
     hts_file->set_header(hdr.get());
+    SequencingSummaryNode* summary_node_ptr = nullptr;
+    if (summary_node != PipelineDescriptor::InvalidNodeHandle) {
+        summary_node_ptr =
+                &dynamic_cast<SequencingSummaryNode&>(pipeline->get_node_ref(summary_node));
+        summary_node_ptr->set_header(hdr.get());
+    }
 
-    std::unordered_set<std::string> reads_already_processed;
+    utils::ReadIdSet reads_already_processed;
     if (!resume_from_file.empty()) {
         spdlog::info("> Inspecting resume file...");
         // Turn off warning logging as header info is fetched.
@@ -593,9 +620,11 @@ void setup(const std::vector<std::string>& args,
         }
 
         // Resume functionality injects reads directly into the writer node.
+        // Basecalling hasn't started yet, so the loader threads decompress the resume file.
         ResumeLoader resume_loader(hts_writer_ref, resume_from_file);
+        resume_loader.set_num_threads(thread_allocations.loader_threads);
         resume_loader.copy_completed_reads();
-        reads_already_processed = resume_loader.get_processed_read_ids();
+        reads_already_processed = resume_loader.take_processed_read_ids();
     }
 
     // If we're doing alignment, post-processing takes longer due to bam file sorting.
@@ -613,7 +642,7 @@ void setup(const std::vector<std::string>& args,
             kStatsPeriod, stats_reporters, stats_callables, max_stats_records);
 
     DataLoader loader(*pipeline, "cpu", thread_allocations.loader_threads, max_reads, read_list,
-                      reads_already_processed, slow5_threads, slow5_batchsize);
+                      std::move(reads_already_processed), slow5_threads, slow5_batchsize);
 
     auto func = [client_info](ReadCommon& read) { read.client_info = client_info; };
     loader.add_read_initialiser(func);
@@ -646,6 +675,11 @@ void setup(const std::vector<std::string>& args,
                                           ? std::nullopt
                                           : std::optional<std::regex>(dump_stats_filter));
     }
+
+    // The summary is reported last, so a failure to write it doesn't cost the BAM output.
+    if (summary_node_ptr && summary_node_ptr->write_failed()) {
+        throw std::runtime_error("Failed to write the sequencing summary.");
+    }
 }
 
 int basecaller(int argc, char* argv[]) {
@@ -842,6 +876,8 @@ int basecaller(int argc, char* argv[]) {
               parser.visible.get<std::string>("--bed-file"), default_parameters.num_runners,
               default_parameters.remora_batchsize, default_parameters.remora_threads,
               methylation_threshold, std::move(hts_file), parser.visible.get<bool>("--emit-moves"),
+              parser.visible.get<std::string>("--emit-summary"),
+              parser.visible.get<std::string>("--emit-summary-columns"),
               parser.visible.get<int>("--max-reads"), parser.visible.get<int>("--min-qscore"),
               "", parser.visible.get<int32_t>("--slow5_threads"), parser.visible.get<int64_t>("--slow5_batchsize"), recursive, *minimap_options,
               parser.hidden.get<bool>("--skip-model-compatibility-check"),
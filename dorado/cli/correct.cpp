@@ -44,6 +44,8 @@ namespace {
 using OutputMode = dorado::utils::HtsFile::OutputMode;
 using ParserPtr = std::unique_ptr<utils::arg_parse::ArgParser>;
 
+constexpr uint64_t MIN_ALIGNMENT_MEMORY = 64'000'000;
+
 /// \brief All options for the Dorado Correct tool.
 struct Options {
     std::vector<std::string> in_reads_fns;
@@ -53,10 +55,12 @@ struct Options {
     std::string device;
     int batch_size = 0;
     uint64_t index_size = 0;
+    uint64_t alignment_memory = 0;
     bool to_paf = false;
     std::string in_paf_fn;
     std::string model_path;
     std::string resume_path_fn;
+    std::filesystem::path temp_dir;
 };
 
 /// \brief Define the CLI options.
@@ -123,6 +127,18 @@ ParserPtr create_cli(int& verbosity) {
                 .help("Size of index for mapping and alignment. Default 8G. Decrease index size to "
                       "lower memory footprint.")
                 .default_value(std::string{"8G"});
+        parser->visible.add_argument("--alignment-memory")
+                .help("Memory for the alignments waiting to be corrected, split between the index "
+                      "chunk being aligned and the one being corrected. Alignments beyond this are "
+                      "spilled to a temporary file until they're corrected. This counts the "
+                      "encoded alignments only, and buffer overheads can take memory use to "
+                      "about twice this. Default 16G, minimum 64M.")
+                .default_value(std::string{"16G"});
+        parser->visible.add_argument("--temp-dir")
+                .help("Folder for the temporary files of the read store, which need about 1.25 "
+                      "bytes per input base, and of the spilled alignments. Default is the "
+                      "working directory.")
+                .default_value(std::string{});
     }
 
     return parser;
@@ -151,11 +167,18 @@ Options set_options(const utils::arg_parse::ArgParser& parser, const int verbosi
     opt.batch_size = parser.visible.get<int>("batch-size");
     opt.index_size = std::max<int64_t>(0, utils::arg_parse::parse_string_to_size<int64_t>(
                                                   parser.visible.get<std::string>("index-size")));
+    opt.alignment_memory = std::max<int64_t>(
+            0, utils::arg_parse::parse_string_to_size<int64_t>(
+                       parser.visible.get<std::string>("alignment-memory")));
     opt.to_paf = parser.visible.get<bool>("to-paf");
     opt.in_paf_fn = (parser.visible.is_used("--from-paf"))
                             ? parser.visible.get<std::string>("from-paf")
                             : "";
     opt.resume_path_fn = parser.visible.get<std::string>("resume-from");
+    opt.temp_dir = parser.visible.get<std::string>("temp-dir");
+    if (opt.temp_dir.empty()) {
+        opt.temp_dir = std::filesystem::current_path();
+    }
     opt.model_path = (parser.visible.is_used("--model-path"))
                              ? parser.visible.get<std::string>("model-path")
                              : "";
@@ -343,6 +366,15 @@ void validate_options(const Options& opt) {
         spdlog::error("Input resume index file {} does not exist!", opt.resume_path_fn);
         std::exit(EXIT_FAILURE);
     }
+    if (!std::filesystem::is_directory(opt.temp_dir)) {
+        spdlog::error("Temporary file folder {} does not exist!", opt.temp_dir.string());
+        std::exit(EXIT_FAILURE);
+    }
+    if (opt.alignment_memory < MIN_ALIGNMENT_MEMORY) {
+        // A tiny budget would spill on nearly every alignment, and each spill scans every target.
+        spdlog::error("--alignment-memory must be at least 64M.");
+        std::exit(EXIT_FAILURE);
+    }
 }
 
 }  // namespace
@@ -380,8 +412,10 @@ int correct(int argc, char* argv[]) {
     const int aligner_threads = opt.threads;
     const int correct_threads = std::max(4, static_cast<int>(opt.threads / 4));
     const int correct_writer_threads = 1;
-    spdlog::debug("Aligner threads {}, corrector threads {}, writer threads {}", aligner_threads,
-                  correct_threads, correct_writer_threads);
+    // Only decompresses the input for the aligner threads, so a few are enough.
+    const int reader_threads = std::min(4, opt.threads);
+    spdlog::debug("Aligner threads {}, corrector threads {}, writer threads {}, reader threads {}",
+                  aligner_threads, correct_threads, correct_writer_threads, reader_threads);
 
     // If model dir is not specified, download the model.
     const auto [model_dir, remove_tmp_dir] = [&opt]() {
@@ -435,7 +469,7 @@ int correct(int argc, char* argv[]) {
             // 2. Window generation, encoding + inference and decoding to generate final reads.
             pipeline_desc.add_node<CorrectionInferenceNode>(
                     {hts_writer}, in_reads_fn, correct_threads, opt.device, opt.infer_threads,
-                    opt.batch_size, model_dir);
+                    opt.batch_size, model_dir, opt.temp_dir);
         } else {
             pipeline_desc.add_node<CorrectionPafWriterNode>({});
         }
@@ -456,9 +490,9 @@ int correct(int argc, char* argv[]) {
             aligner = std::make_unique<CorrectionPafReaderNode>(opt.in_paf_fn, std::move(skip_set));
         } else {
             // 1. Alignment node that generates alignments per read to be corrected.
-            aligner = std::make_unique<CorrectionMapperNode>(in_reads_fn, aligner_threads,
-                                                             opt.index_size, furthest_skip_header,
-                                                             std::move(skip_set));
+            aligner = std::make_unique<CorrectionMapperNode>(
+                    in_reads_fn, aligner_threads, reader_threads, opt.index_size,
+                    opt.alignment_memory, opt.temp_dir, furthest_skip_header, std::move(skip_set));
         }
 
         // Set up stats counting.
@@ -229,6 +229,7 @@ int demuxer(int argc, char* argv[]) {
     auto read_list = utils::load_read_list(parser.visible.get<std::string>("--read-ids"));
 
     HtsReader reader(all_files[0].input, read_list);
+    reader.set_num_threads(demux_writer_threads);
     utils::MergeHeaders hdr_merger(strip_alignment);
     hdr_merger.add_header(reader.header(), all_files[0].input);
 
@@ -323,6 +324,7 @@ int demuxer(int argc, char* argv[]) {
     // Barcode all the other files passed in
     for (size_t input_idx = 1; input_idx < all_files.size(); input_idx++) {
         HtsReader input_reader(all_files[input_idx].input, read_list);
+        input_reader.set_num_threads(demux_writer_threads);
         input_reader.set_client_info(client_info);
         if (!strip_alignment) {
             input_reader.set_record_mutator([&sq_mapping, input_idx](BamPtr& record) {
@@ -355,6 +357,7 @@ int demuxer(int argc, char* argv[]) {
     if (emit_summary) {
         spdlog::info("> generating summary file");
         SummaryData summary(SummaryData::BARCODING_FIELDS);
+        summary.set_num_threads(threads);
         auto summary_file = std::filesystem::path(output_dir) / "barcoding_summary.txt";
         std::ofstream summary_out(summary_file.string());
         summary.process_tree(output_dir, summary_out);
@@ -22,6 +22,7 @@
 #include "torch_utils/auto_detect_device.h"
 #include "utils/SampleSheet.h"
 #include "utils/arg_parse_ext.h"
+#include "utils/bam_pool.h"
 #include "utils/bam_utils.h"
 #include "utils/basecaller_utils.h"
 #if DORADO_CUDA_BUILD
@@ -538,7 +539,8 @@ int duplex(int argc, char* argv[]) {
                 [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
         stats::NamedStats final_stats;
         std::unique_ptr<dorado::stats::StatsSampler> stats_sampler;
-        std::vector<dorado::stats::StatsReporter> stats_reporters{dorado::stats::sys_stats_report};
+        std::vector<dorado::stats::StatsReporter> stats_reporters{
+                dorado::stats::sys_stats_report, utils::bam_pool_stats_report};
 
         constexpr auto kStatsPeriod = 100ms;
 
@@ -109,6 +109,7 @@ int trim(int argc, char* argv[]) {
     }
 
     HtsReader reader(reads[0], read_list);
+    reader.set_num_threads(trim_writer_threads);
     auto header = SamHdrPtr(sam_hdr_dup(reader.header()));
     cli::add_pg_hdr(header.get(), "trim", args, "cpu");
     // Always remove alignment information from input header
@@ -0,0 +1,242 @@
+#include "alignment_spool.h"
+
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t get_varint(const uint8_t*& in) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+int get_int(const uint8_t*& in) { return static_cast<int>(static_cast<uint32_t>(get_varint(in))); }
+
+uint64_t as_unsigned(int value) { return static_cast<uint32_t>(value); }
+
+// Spilled records are gathered into writes of about this size.
+constexpr size_t SPILL_WRITE_SIZE = 16 * 1024 * 1024;
+
+}  // namespace
+
+namespace dorado::correction {
+
+// An unnamed temporary file which spilled records are appended to. On Windows nothing is
+// spilled, and the records stay in memory.
+class AlignmentSpool::SpillFile {
+public:
+    explicit SpillFile([[maybe_unused]] const std::filesystem::path& dir) {
+#ifndef _WIN32
+        auto path = (dir / "dorado_alignments_XXXXXX").string();
+        m_fd = mkstemp(path.data());
+        if (m_fd < 0) {
+            throw std::runtime_error("Could not create alignment spool file " + path);
+        }
+        // The file is removed once it's closed.
+        unlink(path.c_str());
+#endif
+    }
+
+    ~SpillFile() {
+#ifndef _WIN32
+        close(m_fd);
+#endif
+    }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    static constexpr bool enabled() {
+#ifndef _WIN32
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    uint64_t size() const { return m_size; }
+
+    void append([[maybe_unused]] const std::vector<uint8_t>& data) {
+#ifndef _WIN32
+        size_t written = 0;
+        while (written < data.size()) {
+            const auto result = ::write(m_fd, data.data() + written, data.size() - written);
+            if (result < 0) {
+                throw std::runtime_error("Could not write to the alignment spool.");
+            }
+            written += static_cast<size_t>(result);
+        }
+#endif
+        m_size += data.size();
+    }
+
+    void read([[maybe_unused]] uint64_t offset, [[maybe_unused]] std::vector<uint8_t>& data) {
+#ifndef _WIN32
+        size_t done = 0;
+        while (done < data.size()) {
+            const auto result = ::pread(m_fd, data.data() + done, data.size() - done,
+                                        static_cast<off_t>(offset + done));
+            if (result <= 0) {
+                throw std::runtime_error("Could not read from the alignment spool.");
+            }
+            done += static_cast<size_t>(result);
+        }
+#endif
+    }
+
+private:
+    int m_fd{-1};
+    uint64_t m_size{0};
+};
+
+AlignmentSpool::AlignmentSpool(std::vector<std::string> target_names,
+                               size_t memory_budget,
+                               std::filesystem::path spill_dir)
+        : m_target_names(std::move(target_names)),
+          m_targets(m_target_names.size()),
+          m_memory_budget(memory_budget),
+          m_spill_dir(std::move(spill_dir)) {}
+
+AlignmentSpool::~AlignmentSpool() = default;
+
+void AlignmentSpool::add(size_t target,
+                         std::string_view qname,
+                         const utils::Overlap& overlap,
+                         const std::vector<CigarOp>& cigar) {
+    size_t added = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_locks[target % NUM_LOCKS]);
+        auto& records = m_targets[target].records;
+        const size_t old_size = records.size();
+        put_varint(records, qname.size());
+        records.insert(records.end(), qname.begin(), qname.end());
+        put_varint(records, as_unsigned(overlap.qstart));
+        put_varint(records, as_unsigned(overlap.qend));
+        put_varint(records, as_unsigned(overlap.qlen));
+        put_varint(records, as_unsigned(overlap.tstart));
+        put_varint(records, as_unsigned(overlap.tend));
+        put_varint(records, as_unsigned(overlap.tlen));
+        records.push_back(overlap.fwd ? 1 : 0);
+        put_varint(records, cigar.size());
+        for (const auto& op : cigar) {
+            put_varint(records, (uint64_t{op.len} << 4) | static_cast<uint8_t>(op.op));
+        }
+        m_targets[target].num_alignments++;
+        added = records.size() - old_size;
+    }
+
+    if (m_memory_size.fetch_add(added) + added > m_memory_budget && SpillFile::enabled()) {
+        // Only one thread spills at a time, and the others carry on adding alignments.
+        std::unique_lock<std::mutex> spill_lock(m_spill_mutex, std::try_to_lock);
+        if (spill_lock.owns_lock() && m_memory_size.load() > m_memory_budget) {
+            spill();
+        }
+    }
+}
+
+void AlignmentSpool::spill() {
+    if (!m_spill_file) {
+        m_spill_file = std::make_unique<SpillFile>(m_spill_dir);
+    }
+    size_t total_spilled = 0;
+    std::vector<uint8_t> buffer;
+    auto write_buffer = [&] {
+        m_spill_file->append(buffer);
+        m_memory_size -= buffer.size();
+        total_spilled += buffer.size();
+        buffer.clear();
+    };
+    // The targets are written in order, with one run of records each, so that reading them back
+    // in order goes through the file from start to end.
+    for (size_t target = 0; target < m_targets.size(); ++target) {
+        {
+            std::lock_guard<std::mutex> lock(m_locks[target % NUM_LOCKS]);
+            auto& records = m_targets[target].records;
+            if (records.empty()) {
+                continue;
+            }
+            m_targets[target].spilled.emplace_back(m_spill_file->size() + buffer.size(),
+                                                   records.size());
+            buffer.insert(buffer.end(), records.begin(), records.end());
+            // Release the capacity too, as most targets won't be added to again for a while.
+            std::vector<uint8_t>().swap(records);
+        }
+        if (buffer.size() >= SPILL_WRITE_SIZE) {
+            write_buffer();
+        }
+    }
+    write_buffer();
+    m_spilled_size += total_spilled;
+    spdlog::debug("Spilled {} MB of alignments, {} MB spilled in total.",
+                  total_spilled / (1024 * 1024), m_spilled_size.load() / (1024 * 1024));
+}
+
+void AlignmentSpool::take(size_t target,
+                          std::vector<std::string>& qnames,
+                          std::vector<std::vector<CigarOp>>& cigars,
+                          std::vector<utils::Overlap>& overlaps) {
+    auto& entry = m_targets[target];
+    qnames.reserve(qnames.size() + entry.num_alignments);
+    cigars.reserve(cigars.size() + entry.num_alignments);
+    overlaps.reserve(overlaps.size() + entry.num_alignments);
+
+    auto decode = [&](const std::vector<uint8_t>& records) {
+        const uint8_t* in = records.data();
+        const uint8_t* const end = in + records.size();
+        while (in < end) {
+            const auto name_length = get_varint(in);
+            qnames.emplace_back(reinterpret_cast<const char*>(in), name_length);
+            in += name_length;
+
+            utils::Overlap overlap;
+            overlap.qstart = get_int(in);
+            overlap.qend = get_int(in);
+            overlap.qlen = get_int(in);
+            overlap.tstart = get_int(in);
+            overlap.tend = get_int(in);
+            overlap.tlen = get_int(in);
+            overlap.fwd = *in++ != 0;
+            overlaps.push_back(overlap);
+
+            auto& cigar = cigars.emplace_back(get_varint(in));
+            for (auto& op : cigar) {
+                const auto value = get_varint(in);
+                op.op = static_cast<CigarOpType>(value & 0xf);
+                op.len = static_cast<uint32_t>(value >> 4);
+            }
+        }
+    };
+
+    std::vector<uint8_t> spilled_records;
+    for (const auto& [offset, size] : entry.spilled) {
+        spilled_records.resize(size);
+        m_spill_file->read(offset, spilled_records);
+        decode(spilled_records);
+    }
+    decode(entry.records);
+
+    m_memory_size -= entry.records.size();
+    entry = {};
+}
+
+}  // namespace dorado::correction
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "utils/cigar.h"
+#include "utils/overlap.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dorado::correction {
+
+// Holds the alignments to the target reads of an index chunk until they're sent for inference.
+// Each alignment is kept as a compact record of varints, with the query name, the overlap and
+// the CIGAR operations, rather than as separate heap allocations. Once the records pass the
+// memory budget they're spilled to a temporary file in |spill_dir|, and they're read back a target
+// at a time. The budget counts the encoded records, not the spare capacity of their buffers or
+// the spilled records' offsets, so the memory used can be up to about twice the budget.
+class AlignmentSpool {
+public:
+    AlignmentSpool(std::vector<std::string> target_names,
+                   size_t memory_budget,
+                   std::filesystem::path spill_dir);
+    ~AlignmentSpool();
+
+    AlignmentSpool(const AlignmentSpool&) = delete;
+    AlignmentSpool& operator=(const AlignmentSpool&) = delete;
+
+    // Can be called from several threads at once.
+    void add(size_t target,
+             std::string_view qname,
+             const utils::Overlap& overlap,
+             const std::vector<CigarOp>& cigar);
+
+    size_t num_targets() const { return m_targets.size(); }
+    const std::string& target_name(size_t target) const { return m_target_names[target]; }
+    size_t num_alignments(size_t target) const { return m_targets[target].num_alignments; }
+
+    // Appends the alignments to a target in the order they were added, and releases them.
+    // Must not be called while alignments are being added.
+    void take(size_t target,
+              std::vector<std::string>& qnames,
+              std::vector<std::vector<CigarOp>>& cigars,
+              std::vector<utils::Overlap>& overlaps);
+
+    // Bytes of records held in memory, and written to the spill file.
+    size_t memory_size() const { return m_memory_size.load(); }
+    uint64_t spilled_size() const { return m_spilled_size.load(); }
+
+private:
+    struct Target {
+        std::vector<uint8_t> records;
+        // Offsets and sizes of the records which have been spilled, in the order they were added.
+        // Each spill writes the targets in order, so take() reads through the file in order.
+        std::vector<std::pair<uint64_t, uint64_t>> spilled;
+        uint32_t num_alignments{0};
+    };
+
+    class SpillFile;
+
+    // Targets share locks, as a mutex for each read would take more memory than its alignments.
+    static constexpr size_t NUM_LOCKS = 256;
+
+    std::vector<std::string> m_target_names;
+    std::vector<Target> m_targets;
+    std::array<std::mutex, NUM_LOCKS> m_locks;
+
+    const size_t m_memory_budget;
+    const std::filesystem::path m_spill_dir;
+    std::mutex m_spill_mutex;
+    std::unique_ptr<SpillFile> m_spill_file;
+    std::atomic<size_t> m_memory_size{0};
+    std::atomic<uint64_t> m_spilled_size{0};
+
+    void spill();
+};
+
+}  // namespace dorado::correction
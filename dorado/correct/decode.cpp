@@ -75,7 +75,7 @@ std::string decode_window(const WindowFeatures& wf) {
     auto& bases = wf.bases;
     int tpos = -1, ins = 0;
     int length = (int)bases.sizes()[1];
-    int* bases_tensor = bases.data_ptr<int>();
+    const uint8_t* bases_tensor = bases.data_ptr<uint8_t>();
     for (int c = 0; c < length; c++) {
         const auto tbase = bases_tensor[c];
         if (base_decoding[tbase] == '*') {
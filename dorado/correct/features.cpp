@@ -138,6 +138,7 @@ std::vector<int> get_max_ins_for_window(const std::vector<OverlapWindow>& overla
 std::tuple<at::Tensor, at::Tensor> get_features_for_window(
         const std::vector<OverlapWindow>& overlaps,
         const CorrectionAlignments& alignments,
+        const OverlapReads& reads,
         int win_len,
         int tstart,
         const std::vector<int>& max_ins) {
@@ -145,30 +146,32 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
 #ifndef NDEBUG
     static auto base_decoding = gen_base_decoding();
 #endif
-    auto bases_options = at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU);
-    auto quals_options = at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU);
+    // Features are kept compact until they're batched for inference: bases as their encoding
+    // and quals as their FASTQ characters.
+    auto bases_options = at::TensorOptions().dtype(torch::kUInt8).device(torch::kCPU);
+    auto quals_options = at::TensorOptions().dtype(torch::kUInt8).device(torch::kCPU);
 
     const int length = std::accumulate(max_ins.begin(), max_ins.end(), 0) + (int)max_ins.size();
     const int reads = 1 + TOP_K;
 
     auto bases = at::empty({reads, length}, bases_options);
-    std::fill(bases.data_ptr<int>(), bases.data_ptr<int>() + bases.numel(), base_encoding['.']);
+    std::fill(bases.data_ptr<uint8_t>(), bases.data_ptr<uint8_t>() + bases.numel(),
+              base_encoding['.']);
     auto quals = at::empty({reads, length}, quals_options);
-    std::fill(quals.data_ptr<float>(), quals.data_ptr<float>() + quals.numel(),
-              normalize_quals((float)'!'));
+    std::fill(quals.data_ptr<uint8_t>(), quals.data_ptr<uint8_t>() + quals.numel(), '!');
 
     // Write bases/qual for target read
-    const std::string& tseq = alignments.read_seq;
-    const std::vector<uint8_t>& tqual = alignments.read_qual;
+    const auto& tread = reads.target;
+    const uint8_t* tqual = tread.quals();
 
     int tpos = 0;
-    int* target_bases_tensor = bases.data_ptr<int>();
+    uint8_t* target_bases_tensor = bases.data_ptr<uint8_t>();
     std::fill(target_bases_tensor, target_bases_tensor + length, base_encoding['*']);
-    float* target_quals_tensor = quals.data_ptr<float>();
+    uint8_t* target_quals_tensor = quals.data_ptr<uint8_t>();
     // PyTorch stores data in column major format.
     for (int i = 0; i < win_len; i++) {
-        target_bases_tensor[tpos] = base_encoding[tseq[i + tstart]];
-        target_quals_tensor[tpos] = normalize_quals(float(tqual[i + tstart] + 33));
+        target_bases_tensor[tpos] = base_encoding[tread.base(i + tstart)];
+        target_quals_tensor[tpos] = uint8_t(tqual[i + tstart] + 33);
 
         LOG_TRACE("tpos {} base {} qual {}", tpos, base_decoding[target_bases_tensor[tpos]],
                   target_quals_tensor[tpos]);
@@ -178,8 +181,8 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
     // Write bases for each overlap in the window
     for (int w = 0; w < (int)overlaps.size(); w++) {
         LOG_TRACE("get_features_for_ol_window for window {}", w);
-        int* query_bases_tensor = &target_bases_tensor[length * (w + 1)];
-        float* query_quals_tensor = &target_quals_tensor[length * (w + 1)];
+        uint8_t* query_bases_tensor = &target_bases_tensor[length * (w + 1)];
+        uint8_t* query_quals_tensor = &target_quals_tensor[length * (w + 1)];
         const auto& overlap = overlaps[w];
         const auto& cigar = alignments.cigars[overlap.overlap_idx];
         int offset = overlap.tstart - tstart;
@@ -202,9 +205,9 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
         LOG_TRACE("qstart {} qend {} aln qstart {} aln qend {} overlap qstart {} overlap qend {}",
                   qstart, qend, oqstart, oqend, overlap.qstart, overlap.qend);
         int query_iter = 0;
-        std::string qseq = alignments.seqs[overlap.overlap_idx].substr(qstart, qlen);
-        std::vector<uint8_t> qqual(alignments.quals[overlap.overlap_idx].begin() + qstart,
-                                   alignments.quals[overlap.overlap_idx].begin() + qend);
+        const auto& qread = reads.queries[overlap.overlap_idx];
+        std::string qseq = qread.bases(qstart, qlen);
+        std::vector<uint8_t> qqual(qread.quals() + qstart, qread.quals() + qend);
         if (!fwd) {
             qseq = utils::reverse_complement(qseq);
             std::reverse(qqual.begin(), qqual.end());
@@ -251,7 +254,7 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
                     auto qual = qqual[query_iter];
 
                     query_bases_tensor[idx] = base;
-                    query_quals_tensor[idx] = normalize_quals((float)(qual + 33));
+                    query_quals_tensor[idx] = uint8_t(qual + 33);
 
                     LOG_TRACE("idx {} base {}, qual {}", idx,
                               base_decoding[query_bases_tensor[idx]], query_quals_tensor[idx]);
@@ -276,7 +279,7 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
                     auto qual = qqual[query_iter];
 
                     query_bases_tensor[(idx + i)] = base;
-                    query_quals_tensor[(idx + i)] = normalize_quals((float)(qual + 33));
+                    query_quals_tensor[(idx + i)] = uint8_t(qual + 33);
 
                     LOG_TRACE("idx + i {} base {}, qual {}", idx + i,
                               base_decoding[query_bases_tensor[(idx + i)]],
@@ -324,7 +327,7 @@ std::vector<std::pair<int, int>> get_supported(at::Tensor& bases) {
     const int reads = static_cast<int>(bases.sizes()[0]);
     const int length = static_cast<int>(bases.sizes()[1]);
 
-    auto bases_ptr = bases.data_ptr<int>();
+    auto bases_ptr = bases.data_ptr<uint8_t>();
 
     int tpos = -1, ins = 0;
     std::array<int, 128> counter;
@@ -362,7 +365,7 @@ std::vector<std::pair<int, int>> get_supported(at::Tensor& bases) {
 // column in the tensor.
 at::Tensor get_indices(const at::Tensor& bases, const std::vector<std::pair<int, int>>& supported) {
     static auto base_encoding = gen_base_encoding();
-    auto tbase_tensor = bases.data_ptr<int>();
+    auto tbase_tensor = bases.data_ptr<uint8_t>();
     std::vector<int> indices;
     for (int i = 0; i < bases.sizes()[1]; i++) {
         if (tbase_tensor[i] != base_encoding['*']) {
@@ -383,8 +386,15 @@ at::Tensor get_indices(const at::Tensor& bases, const std::vector<std::pair<int,
 
 std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>& windows,
                                         const CorrectionAlignments& alignments) {
+    return filter_features(windows, alignments, 0, windows.size());
+}
+
+std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>& windows,
+                                        const CorrectionAlignments& alignments,
+                                        size_t begin,
+                                        size_t end) {
     std::unordered_set<int> overlap_idxs;
-    for (int w = 0; w < (int)windows.size(); w++) {
+    for (int w = (int)begin; w < (int)end; w++) {
         auto& overlap_windows = windows[w];
 
         // Filter overlaps with very large indels
@@ -439,12 +449,22 @@ std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>&
 // given the overlaps for a target read.
 std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWindow>>& windows,
                                              const CorrectionAlignments& alignments,
+                                             const OverlapReads& reads,
                                              int window_size) {
-    const std::string& tseq = alignments.read_seq;
-    int tlen = (int)tseq.length();
+    return extract_features(windows, alignments, reads, window_size, 0, windows.size());
+}
+
+std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWindow>>& windows,
+                                             const CorrectionAlignments& alignments,
+                                             const OverlapReads& reads,
+                                             int window_size,
+                                             size_t begin,
+                                             size_t end) {
+    int tlen = reads.target.length();
 
     std::vector<WindowFeatures> wfs;
-    for (int w = 0; w < (int)windows.size(); w++) {
+    wfs.reserve(end - begin);
+    for (int w = (int)begin; w < (int)end; w++) {
         int win_len = (w == (int)windows.size() - 1) ? tlen - window_size * w : window_size;
         LOG_TRACE("win idx {}: win len {}", w, win_len);
         auto& overlap_windows = windows[w];
@@ -459,8 +479,8 @@ std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWind
                     get_max_ins_for_window(overlap_windows, alignments, w * window_size, win_len);
 
             // Create tensors
-            auto [bases, quals] = get_features_for_window(overlap_windows, alignments, win_len,
-                                                          w * window_size, max_ins);
+            auto [bases, quals] = get_features_for_window(overlap_windows, alignments, reads,
+                                                          win_len, w * window_size, max_ins);
             auto supported = get_supported(bases);
             wf.bases = std::move(bases);
             wf.quals = std::move(quals);
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "read_store.h"
 #include "types.h"
 
+#include <cstddef>
 #include <unordered_set>
+#include <vector>
 
 namespace dorado {
 struct CorrectionAlignments;
@@ -13,9 +16,22 @@ namespace dorado::correction {
 // Filter window features to TOP_K best. Returns collection of useful overlap indices
 std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>& windows,
                                         const CorrectionAlignments& alignments);
+// Only filters windows [begin, end), so separate ranges of windows can be filtered in parallel.
+std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>& windows,
+                                        const CorrectionAlignments& alignments,
+                                        size_t begin,
+                                        size_t end);
 
 std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWindow>>& windows,
                                              const CorrectionAlignments& alignments,
+                                             const OverlapReads& reads,
                                              int window_size);
+// Only extracts the features of windows [begin, end), which can be done in parallel.
+std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWindow>>& windows,
+                                             const CorrectionAlignments& alignments,
+                                             const OverlapReads& reads,
+                                             int window_size,
+                                             size_t begin,
+                                             size_t end);
 
 }  // namespace dorado::correction
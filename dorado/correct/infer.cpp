@@ -1,5 +1,6 @@
 #include "infer.h"
 
+#include "conversions.h"
 #include "types.h"
 #include "utils/memory_utils.h"
 #if DORADO_METAL_BUILD
@@ -15,8 +16,70 @@
 #include <toml/value.hpp>
 #include <torch/types.h>
 
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// Padding the model expects beyond the end of a window and below its last read.
+constexpr int PAD_BASE = 11;
+constexpr float PAD_QUAL = 0.f;
+
+}  // namespace
+
 namespace dorado::correction {
 
+std::pair<at::Tensor, at::Tensor> FeatureBatch::collate(const std::vector<WindowFeatures>& wfs) {
+    dorado::utils::ScopedProfileRange spr("collate", 1);
+    // The normalised value of each quality character, which matches normalize_quals exactly.
+    static const auto qual_values = [] {
+        std::array<float, 256> values{};
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = normalize_quals(static_cast<float>(i));
+        }
+        return values;
+    }();
+
+    int64_t max_length = 0;
+    int64_t max_reads = 0;
+    for (const auto& wf : wfs) {
+        max_reads = std::max(max_reads, wf.bases.size(0));
+        max_length = std::max(max_length, wf.bases.size(1));
+    }
+    const auto num_windows = static_cast<int64_t>(wfs.size());
+    const int64_t numel = num_windows * max_length * max_reads;
+    if (!m_bases.defined() || m_bases.numel() < numel) {
+        auto options = at::TensorOptions().device(torch::kCPU).pinned_memory(m_pin_memory);
+        m_bases = at::empty({numel}, options.dtype(torch::kInt32));
+        m_quals = at::empty({numel}, options.dtype(torch::kFloat32));
+    }
+    auto bases = m_bases.narrow(0, 0, numel).view({num_windows, max_length, max_reads});
+    auto quals = m_quals.narrow(0, 0, numel).view({num_windows, max_length, max_reads});
+    int* bases_ptr = bases.data_ptr<int>();
+    float* quals_ptr = quals.data_ptr<float>();
+    std::fill(bases_ptr, bases_ptr + numel, PAD_BASE);
+    std::fill(quals_ptr, quals_ptr + numel, PAD_QUAL);
+
+    // Window features are [reads, length], and are transposed into the batch.
+    for (int64_t w = 0; w < num_windows; ++w) {
+        const auto& wf = wfs[w];
+        const int64_t reads = wf.bases.size(0);
+        const int64_t length = wf.bases.size(1);
+        const uint8_t* wf_bases = wf.bases.data_ptr<uint8_t>();
+        const uint8_t* wf_quals = wf.quals.data_ptr<uint8_t>();
+        int* window_bases = bases_ptr + w * max_length * max_reads;
+        float* window_quals = quals_ptr + w * max_length * max_reads;
+        for (int64_t r = 0; r < reads; ++r) {
+            for (int64_t c = 0; c < length; ++c) {
+                window_bases[c * max_reads + r] = wf_bases[r * length + c];
+                window_quals[c * max_reads + r] = qual_values[wf_quals[r * length + c]];
+            }
+        }
+    }
+    LOG_TRACE("size {}x{}x{} numelem {}", num_windows, max_length, max_reads, numel);
+    return {std::move(bases), std::move(quals)};
+}
+
 int calculate_batch_size(const std::string& device, float memory_fraction) {
     // These sizes are currently hard coded for version 1 model.
     const float model_mem = 1.f;       // GB
@@ -7,6 +7,8 @@
 #include <torch/torch.h>
 
 #include <filesystem>
+#include <utility>
+#include <vector>
 
 #ifdef NDEBUG
 #define LOG_TRACE(...)
@@ -16,35 +18,24 @@
 
 namespace dorado::correction {
 
-// Custom collate function. Replacement for torch::utils::rnn::pad_sequence
-// because that was running much slower than this version.
-template <typename T>
-torch::Tensor collate(std::vector<torch::Tensor>& tensors, T fill_val, torch::ScalarType type) {
-    dorado::utils::ScopedProfileRange spr("collate", 1);
-    auto max_length = std::max_element(tensors.begin(), tensors.end(),
-                                       [](const torch::Tensor& a, const torch::Tensor& b) {
-                                           return a.sizes()[0] < b.sizes()[0];
-                                       })
-                              ->sizes()[0];
-    auto max_reads = std::max_element(tensors.begin(), tensors.end(),
-                                      [](const torch::Tensor& a, const torch::Tensor& b) {
-                                          return a.sizes()[1] < b.sizes()[1];
-                                      })
-                             ->sizes()[1];
-    auto options = torch::TensorOptions().dtype(type).device(torch::kCPU);
-    torch::Tensor batch = torch::empty({(int)tensors.size(), max_length, max_reads}, options);
-    T* ptr = batch.data_ptr<T>();
-    std::fill(ptr, ptr + batch.numel(), fill_val);
-    // Copy over data for each tensor
-    for (size_t i = 0; i < tensors.size(); i++) {
-        torch::Tensor slice = batch.index({(int)i, torch::indexing::Slice(0, tensors[i].sizes()[0]),
-                                           torch::indexing::Slice(0, tensors[i].sizes()[1])});
-        slice.copy_(tensors[i]);
-    }
-    LOG_TRACE("size {}x{}x{} numelem {} sum {}", tensors.size(), max_length, max_reads,
-              batch.numel(), batch.sum().item<T>());
-    return batch;
-}
+// Buffers for the model inputs of a batch of windows, which are reused between batches and
+// only reallocated when a batch needs more room. Pinned buffers can be copied to the GPU
+// without staging.
+class FeatureBatch {
+public:
+    explicit FeatureBatch(bool pin_memory) : m_pin_memory(pin_memory) {}
+
+    // Copies the compact features of the windows into the buffers, widening them to the types
+    // the model takes: int32 bases and normalised float32 quals. Returns views of the buffers
+    // shaped [windows, max length, max reads], padded as the model expects. The views are only
+    // valid until the next call.
+    std::pair<at::Tensor, at::Tensor> collate(const std::vector<WindowFeatures>& wfs);
+
+private:
+    const bool m_pin_memory;
+    at::Tensor m_bases;
+    at::Tensor m_quals;
+};
 
 int calculate_batch_size(const std::string& device, float memory_fraction);
 
@@ -0,0 +1,320 @@
+#include "read_store.h"
+
+#include "utils/types.h"
+
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+// Average number of reads per hash bucket. Larger buckets mean fewer seeds to store, but
+// more attempts to find a seed which places the whole bucket.
+constexpr size_t READS_PER_BUCKET = 4;
+constexpr uint32_t MAX_SEED = 1 << 24;
+
+// 2 bit codes of the htslib 4 bit base codes, or -1 for bases other than ACGT.
+constexpr std::array<int8_t, 16> NT16_TO_2BIT = {-1, 0, 1,  -1, 2,  -1, -1, -1,
+                                                 3,  -1, -1, -1, -1, -1, -1, -1};
+
+uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t hash_name(std::string_view name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+    }
+    return mix(hash);
+}
+
+size_t slot_of(uint64_t hash, uint32_t seed, size_t num_slots) {
+    return mix(hash ^ (seed * 0x9e3779b97f4a7c15ULL)) % num_slots;
+}
+
+}  // namespace
+
+namespace dorado::correction {
+
+std::string ReadView::bases(int start, int len) const {
+    std::string seq(len, '\0');
+    for (int i = 0; i < len; ++i) {
+        seq[i] = base(start + i);
+    }
+    return seq;
+}
+
+// The store's data, which is appended to while the store is built and then mapped read-only.
+class ReadStore::Storage {
+public:
+    explicit Storage([[maybe_unused]] const std::filesystem::path& dir) {
+#ifndef _WIN32
+        m_dir = dir.string();
+        auto path = (dir / "dorado_read_store_XXXXXX").string();
+        m_fd = mkstemp(path.data());
+        if (m_fd < 0) {
+            throw std::runtime_error("Could not create read store file " + path + ": " +
+                                     std::strerror(errno));
+        }
+        // The file is removed once it's closed.
+        unlink(path.c_str());
+#endif
+    }
+
+    ~Storage() {
+#ifndef _WIN32
+        if (m_mapping) {
+            munmap(m_mapping, m_size);
+        }
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+#endif
+    }
+
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    // Returns the offset of the appended data.
+    uint64_t append(const void* data, size_t size) {
+        const uint64_t offset = m_size;
+        auto bytes = static_cast<const uint8_t*>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+        m_size += size;
+#ifndef _WIN32
+        if (m_buffer.size() >= WRITE_SIZE) {
+            write_buffer();
+        }
+#endif
+        return offset;
+    }
+
+    void finish() {
+#ifndef _WIN32
+        write_buffer();
+        m_buffer = {};
+        if (m_size > 0) {
+            void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+            if (mapping == MAP_FAILED) {
+                throw std::runtime_error("Could not map the read store.");
+            }
+            m_mapping = static_cast<uint8_t*>(mapping);
+        }
+        close(std::exchange(m_fd, -1));
+#endif
+    }
+
+    const uint8_t* data() const {
+#ifndef _WIN32
+        return m_mapping;
+#else
+        return m_buffer.data();
+#endif
+    }
+
+private:
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_size{0};
+
+#ifndef _WIN32
+    static constexpr size_t WRITE_SIZE = 4 << 20;
+
+    std::string m_dir;
+    int m_fd{-1};
+    uint8_t* m_mapping{nullptr};
+
+    void write_buffer() {
+        size_t written = 0;
+        while (written < m_buffer.size()) {
+            const auto result =
+                    ::write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result < 0 && (errno == ENOSPC || errno == EDQUOT)) {
+                throw std::runtime_error("Ran out of disk space for the read store in " + m_dir +
+                                         ". It needs about 1.25 bytes per input base.");
+            }
+            if (result < 0) {
+                throw std::runtime_error("Could not write to the read store in " + m_dir + ": " +
+                                         std::strerror(errno));
+            }
+            written += static_cast<size_t>(result);
+        }
+        m_buffer.clear();
+    }
+#endif
+};
+
+ReadStore::ReadStore(const std::string& fastq_path,
+                     int threads,
+                     const std::filesystem::path& storage_dir)
+        : m_storage(std::make_unique<Storage>(storage_dir)) {
+    HtsFilePtr file(hts_open(fastq_path.c_str(), "r"));
+    if (!file) {
+        throw std::runtime_error("Could not open " + fastq_path);
+    }
+    if (threads > 1 && hts_set_threads(file.get(), threads) < 0) {
+        throw std::runtime_error("Could not enable multi threading for reading " + fastq_path);
+    }
+    SamHdrPtr header(sam_hdr_read(file.get()));
+    if (!header) {
+        throw std::runtime_error("Could not read the header of " + fastq_path);
+    }
+
+    BamPtr record(bam_init1());
+    std::vector<uint64_t> hashes;
+    std::vector<uint8_t> bases;
+    while (sam_read1(file.get(), header.get(), record.get()) >= 0) {
+        if (m_records.size() == EMPTY_SLOT) {
+            throw std::runtime_error("Too many reads for the read store in " + fastq_path);
+        }
+        const std::string_view read_name = bam_get_qname(record.get());
+        const auto length = static_cast<uint32_t>(record->core.l_qseq);
+        const uint8_t* seq = bam_get_seq(record.get());
+
+        bool packed = true;
+        for (uint32_t i = 0; i < length && packed; ++i) {
+            packed = NT16_TO_2BIT[bam_seqi(seq, i)] >= 0;
+        }
+        if (packed) {
+            bases.assign((length + 3) / 4, 0);
+            for (uint32_t i = 0; i < length; ++i) {
+                const auto code = NT16_TO_2BIT[bam_seqi(seq, i)];
+                bases[i / 4] |= static_cast<uint8_t>(code << ((i % 4) * 2));
+            }
+        } else {
+            bases.resize(length);
+            for (uint32_t i = 0; i < length; ++i) {
+                bases[i] = static_cast<uint8_t>(seq_nt16_str[bam_seqi(seq, i)]);
+            }
+        }
+
+        const auto offset = m_storage->append(read_name.data(), read_name.size());
+        m_storage->append(bases.data(), bases.size());
+        m_storage->append(bam_get_qual(record.get()), length);
+        m_records.push_back({offset, static_cast<uint32_t>(read_name.size()), length, packed});
+        hashes.push_back(hash_name(read_name));
+    }
+    m_storage->finish();
+    build_index(hashes);
+    spdlog::debug("Loaded {} reads into the read store.", m_records.size());
+}
+
+ReadStore::~ReadStore() = default;
+
+std::string_view ReadStore::name(const Record& record) const {
+    return {reinterpret_cast<const char*>(m_storage->data() + record.offset), record.name_length};
+}
+
+void ReadStore::build_index(const std::vector<uint64_t>& hashes) {
+    const size_t num_reads = m_records.size();
+    if (num_reads == 0) {
+        return;
+    }
+    // A little slack in the number of slots keeps the search for the last seeds short.
+    const size_t num_slots = num_reads + num_reads / 8 + 1;
+    const size_t num_buckets = (num_reads + READS_PER_BUCKET - 1) / READS_PER_BUCKET;
+
+    std::vector<std::vector<uint32_t>> buckets(num_buckets);
+    for (uint32_t i = 0; i < num_reads; ++i) {
+        auto& bucket = buckets[hashes[i] % num_buckets];
+        // Reads with the same name hash the same, so duplicates are in the same bucket. Keep
+        // the first, as the FASTQ index does.
+        const bool is_duplicate = std::any_of(bucket.begin(), bucket.end(), [&](uint32_t j) {
+            return hashes[j] == hashes[i] && name(m_records[j]) == name(m_records[i]);
+        });
+        if (is_duplicate) {
+            spdlog::warn("Ignoring duplicate read {}", name(m_records[i]));
+            continue;
+        }
+        bucket.push_back(i);
+    }
+
+    // Place the largest buckets first, while there are the most free slots.
+    std::vector<uint32_t> order(num_buckets);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    m_bucket_seeds.assign(num_buckets, 0);
+    m_slots.assign(num_slots, EMPTY_SLOT);
+    std::vector<size_t> bucket_slots;
+    for (const auto b : order) {
+        const auto& bucket = buckets[b];
+        if (bucket.empty()) {
+            break;
+        }
+        uint32_t seed = 0;
+        for (;; ++seed) {
+            if (seed == MAX_SEED) {
+                throw std::runtime_error("Could not build the read store index.");
+            }
+            bucket_slots.clear();
+            bool placed = true;
+            for (const auto i : bucket) {
+                const auto slot = slot_of(hashes[i], seed, num_slots);
+                if (m_slots[slot] != EMPTY_SLOT ||
+                    std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                            bucket_slots.end()) {
+                    placed = false;
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (placed) {
+                break;
+            }
+        }
+        m_bucket_seeds[b] = seed;
+        for (size_t k = 0; k < bucket.size(); ++k) {
+            m_slots[bucket_slots[k]] = bucket[k];
+        }
+    }
+}
+
+std::optional<ReadView> ReadStore::find(std::string_view read_name) const {
+    if (m_slots.empty()) {
+        return std::nullopt;
+    }
+    const auto hash = hash_name(read_name);
+    const auto seed = m_bucket_seeds[hash % m_bucket_seeds.size()];
+    const auto index = m_slots[slot_of(hash, seed, m_slots.size())];
+    if (index == EMPTY_SLOT || name(m_records[index]) != read_name) {
+        return std::nullopt;
+    }
+
+    const auto& record = m_records[index];
+    ReadView read;
+    read.m_bases = m_storage->data() + record.offset + record.name_length;
+    read.m_quals = read.m_bases + (record.packed ? (record.length + 3) / 4 : record.length);
+    read.m_length = static_cast<int>(record.length);
+    read.m_packed = record.packed;
+    return read;
+}
+
+}  // namespace dorado::correction
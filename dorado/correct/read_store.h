@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dorado::correction {
+
+// The bases and qualities of a read in a ReadStore. It's only valid while the store is alive.
+class ReadView {
+public:
+    ReadView() = default;
+
+    int length() const { return m_length; }
+    bool empty() const { return m_length == 0; }
+
+    char base(int pos) const {
+        if (!m_packed) {
+            return static_cast<char>(m_bases[pos]);
+        }
+        return "ACGT"[(m_bases[pos >> 2] >> ((pos & 3) * 2)) & 3];
+    }
+    // Copies out the bases [start, start + len).
+    std::string bases(int start, int len) const;
+
+    // Phred quality scores, without the FASTQ offset.
+    const uint8_t* quals() const { return m_quals; }
+
+private:
+    friend class ReadStore;
+
+    // Either 4 bases per byte, with the first base in the lowest bits, or a character per base
+    // if the read has bases other than ACGT.
+    const uint8_t* m_bases{nullptr};
+    const uint8_t* m_quals{nullptr};
+    int m_length{0};
+    bool m_packed{false};
+};
+
+// Views of a target read and of the reads overlapping it, indexed like its overlaps.
+struct OverlapReads {
+    ReadView target;
+    std::vector<ReadView> queries;
+};
+
+// A read-only store of the reads in a FASTQ file, built once and shared by all the correction
+// threads, so reads which overlap many targets aren't fetched and copied for each of them.
+// Bases are packed 2 bits per base, and qualities are kept a byte per base. The data is written
+// to a temporary file which is memory mapped, so it can be paged out under memory pressure.
+// Reads are found by name through a perfect hash, checked against the stored name.
+class ReadStore {
+public:
+    // The temporary file is made in storage_dir, which needs room for about 1.25 bytes per
+    // base, and is removed when the store is destroyed.
+    ReadStore(const std::string& fastq_path,
+              int threads,
+              const std::filesystem::path& storage_dir);
+    ~ReadStore();
+
+    ReadStore(const ReadStore&) = delete;
+    ReadStore& operator=(const ReadStore&) = delete;
+
+    // Returns nullopt if there's no read with that name.
+    std::optional<ReadView> find(std::string_view read_name) const;
+
+    size_t num_reads() const { return m_records.size(); }
+
+private:
+    struct Record {
+        uint64_t offset;
+        uint32_t name_length;
+        uint32_t length;
+        bool packed;
+    };
+
+    class Storage;
+
+    std::unique_ptr<Storage> m_storage;
+    std::vector<Record> m_records;
+    // A seed per hash bucket, chosen so each read in the bucket lands on a free slot.
+    std::vector<uint32_t> m_bucket_seeds;
+    // The record index of the read in each slot.
+    std::vector<uint32_t> m_slots;
+
+    std::string_view name(const Record& record) const;
+    void build_index(const std::vector<uint64_t>& hashes);
+};
+
+}  // namespace dorado::correction
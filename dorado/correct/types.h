@@ -21,6 +21,9 @@ struct OverlapWindow {
 };
 
 struct WindowFeatures {
+    // [reads, length] uint8 tensors of the base encodings and the FASTQ quality characters,
+    // which are only widened to the model's int32 and float32 input types when they're batched.
+    // A byte per value is a quarter of the memory of the widened values.
     at::Tensor bases;
     at::Tensor quals;
     at::Tensor indices;
@@ -375,7 +375,7 @@ SimplexReadPtr process_pod5_thread_fn(
 bool can_process_pod5_row(Pod5ReadRecordBatch_t* batch,
                           int row,
                           const std::optional<std::unordered_set<std::string>>& allowed_read_ids,
-                          const std::unordered_set<std::string>& ignored_read_ids) {
+                          const utils::ReadIdSet& ignored_read_ids) {
     uint16_t read_table_version = 0;
     ReadBatchRowInfo_t read_data;
     if (pod5_get_read_batch_row_info_data(batch, row, READ_BATCH_ROW_INFO_VERSION, &read_data,
@@ -384,19 +384,19 @@ bool can_process_pod5_row(Pod5ReadRecordBatch_t* batch,
         return false;
     }
 
+    // The ignore list holds binary read IDs, so it's checked without formatting the read ID.
+    if (ignored_read_ids.contains(read_data.read_id)) {
+        return false;
+    }
+    if (!allowed_read_ids) {
+        return true;
+    }
+
     char read_id_tmp[POD5_READ_ID_LEN];
     if (pod5_format_read_id(read_data.read_id, read_id_tmp) != POD5_OK) {
         spdlog::error("Failed to format read id");
     }
-
-    std::string read_id_str(read_id_tmp);
-    bool read_in_ignore_list = ignored_read_ids.find(read_id_str) != ignored_read_ids.end();
-    bool read_in_read_list =
-            !allowed_read_ids || (allowed_read_ids->find(read_id_str) != allowed_read_ids->end());
-    if (!read_in_ignore_list && read_in_read_list) {
-        return true;
-    }
-    return false;
+    return allowed_read_ids->find(read_id_tmp) != allowed_read_ids->end();
 }
 
 }  // namespace
@@ -543,7 +543,7 @@ void DataLoader::load_reads(const std::filesystem::path& path,
 
 int DataLoader::get_num_reads(const std::filesystem::path& data_path,
                               std::optional<std::unordered_set<std::string>> read_list,
-                              const std::unordered_set<std::string>& ignore_read_list,
+                              const utils::ReadIdSet& ignore_read_list,
                               bool recursive_file_loading) {
     if(read_list){
         spdlog::debug("> args to get_num_reads: {}", data_path.string());
@@ -1208,13 +1208,18 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
             }
         }
 
+        // Push the whole batch as a group so the source node's queue is locked per run
+        // of free space rather than per read.
+        std::vector<Message> reads;
+        reads.reserve(futures.size());
         for (auto& v : futures) {
             auto read = v.get();
             initialise_read(read->read_common);
             check_read(read);
-            m_pipeline.push_message(std::move(read));
+            reads.emplace_back(std::move(read));
             m_loaded_read_count++;
         }
+        m_pipeline.push_messages(std::move(reads));
 
         if (pod5_free_read_batch(batch) != POD5_OK) {
             spdlog::error("Failed to release batch");
@@ -1268,13 +1273,18 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
             }
         }
 
+        // Push the whole batch as a group so the source node's queue is locked per run
+        // of free space rather than per read.
+        std::vector<Message> reads;
+        reads.reserve(futures.size());
         for (auto& v : futures) {
             auto read = v.get();
             initialise_read(read->read_common);
             check_read(read);
-            m_pipeline.push_message(std::move(read));
+            reads.emplace_back(std::move(read));
             m_loaded_read_count++;
         }
+        m_pipeline.push_messages(std::move(reads));
 
         if (pod5_free_read_batch(batch) != POD5_OK) {
             spdlog::error("Failed to release batch");
@@ -1379,8 +1389,9 @@ void DataLoader::load_fast5_reads_from_file(const std::string& path) {
         new_read->read_common.experiment_id = group_protocol_id;
         new_read->read_common.is_duplex = false;
 
-        if (!m_allowed_read_ids || (m_allowed_read_ids->find(new_read->read_common.read_id) !=
-                                    m_allowed_read_ids->end())) {
+        if (!m_ignored_read_ids.contains(new_read->read_common.read_id) &&
+            (!m_allowed_read_ids || (m_allowed_read_ids->find(new_read->read_common.read_id) !=
+                                     m_allowed_read_ids->end()))) {
             initialise_read(new_read->read_common);
             m_pipeline.push_message(std::move(new_read));
             m_loaded_read_count++;
@@ -1659,15 +1670,20 @@ void DataLoader::load_slow5_reads_from_file(const std::string &path) {
         db.read_data_ptrs = std::vector<dorado::SimplexReadPtr>(record_count);
         work_db(&core, &db, create_read_data);
 
+        std::vector<Message> reads;
+        reads.reserve(record_count);
         for (int64_t i = 0; i < record_count; i++) {
-            if (!m_allowed_read_ids ||
-                (m_allowed_read_ids->find(db.read_data_ptrs[i]->read_common.read_id) != m_allowed_read_ids->end())) {
+            const auto& read_id = db.read_data_ptrs[i]->read_common.read_id;
+            if (!m_ignored_read_ids.contains(read_id) &&
+                (!m_allowed_read_ids ||
+                 (m_allowed_read_ids->find(read_id) != m_allowed_read_ids->end()))) {
                 initialise_read(db.read_data_ptrs[i]->read_common);
                 check_read(db.read_data_ptrs[i]);
-                m_pipeline.push_message(std::move(db.read_data_ptrs[i]));
+                reads.emplace_back(std::move(db.read_data_ptrs[i]));
                 m_loaded_read_count++;
             }
         }
+        m_pipeline.push_messages(std::move(reads));
         // Free everything
         free(db.mem_bytes);
         free(db.mem_records);
@@ -1701,18 +1717,21 @@ void DataLoader::load_slow5_reads_from_file_by_read_ids(slow5_file_t *sp, const
         }
         ret = slow5_get_batch_lazy(&rec, sp, rid, local_batch_size, slow5_threads);
         assert(ret==local_batch_size);
+        std::vector<Message> reads;
+        reads.reserve(ret);
         for(int i=0;i<ret;i++){
-            if (!m_allowed_read_ids ||
-                (m_allowed_read_ids->find(std::string(rec[i]->read_id)) != m_allowed_read_ids->end())) {
+            if (!m_ignored_read_ids.contains(std::string_view(rec[i]->read_id)) &&
+                (!m_allowed_read_ids ||
+                 (m_allowed_read_ids->find(std::string(rec[i]->read_id)) != m_allowed_read_ids->end()))) {
                 auto new_read = create_read(sp, rec[i], m_device, std::cref(m_reads_by_channel), std::cref(m_read_id_to_index));
                 spdlog::debug("read_id queued: {}",rec[i]->read_id);
-                // m_pipeline.push_message(new_read);
                 initialise_read(new_read->read_common);
                 check_read(new_read);
-                m_pipeline.push_message(std::move(new_read));
+                reads.emplace_back(std::move(new_read));
                 m_loaded_read_count++;
             }
         }
+        m_pipeline.push_messages(std::move(reads));
         slow5_free_batch_lazy(&rec,ret);
         for(int i=0; i<local_batch_size; i++){
             free(rid[i]);
@@ -1732,7 +1751,7 @@ DataLoader::DataLoader(Pipeline& pipeline,
                        size_t num_worker_threads,
                        size_t max_reads,
                        std::optional<std::unordered_set<std::string>> read_list,
-                       std::unordered_set<std::string> read_ignore_list,
+                       utils::ReadIdSet read_ignore_list,
                     int32_t slow5_threads_,
                     int64_t slow5_batchsize_)
         : m_pipeline(pipeline),
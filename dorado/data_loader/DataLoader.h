@@ -1,6 +1,7 @@
 #pragma once
 
 #include "models/kits.h"
+#include "utils/read_id_set.h"
 #include "utils/stats.h"
 #include "utils/types.h"
 
@@ -42,7 +43,7 @@ public:
                size_t num_worker_threads,
                size_t max_reads,
                std::optional<std::unordered_set<std::string>> read_list,
-               std::unordered_set<std::string> read_ignore_list,
+               utils::ReadIdSet read_ignore_list,
                int32_t slow5_threads = 8,
                int64_t slow5_batchsize = 4000);
     ~DataLoader() = default;
@@ -59,7 +60,7 @@ public:
 
     static int get_num_reads(const std::filesystem::path& data_path,
                              std::optional<std::unordered_set<std::string>> read_list,
-                             const std::unordered_set<std::string>& ignore_read_list,
+                             const utils::ReadIdSet& ignore_read_list,
                              bool recursive_file_loading);
 
     static bool is_read_data_present(const std::filesystem::path& data_path,
@@ -108,7 +109,7 @@ private:
     size_t m_num_worker_threads{1};
     size_t m_max_reads{0};
     std::optional<std::unordered_set<std::string>> m_allowed_read_ids;
-    std::unordered_set<std::string> m_ignored_read_ids;
+    utils::ReadIdSet m_ignored_read_ids;
 
     std::unordered_map<std::string, channel_to_read_id_t> m_file_channel_read_order_map;
     std::unordered_map<int, std::vector<ReadSortInfo>> m_reads_by_channel;
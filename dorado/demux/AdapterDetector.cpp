@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -50,47 +51,74 @@ dorado::SingleEndResult copy_results(const EdlibAlignResult& source,
     return dest;
 }
 
-void align(std::string_view q,
-           std::string_view t,
-           const std::string& name,
-           std::vector<dorado::SingleEndResult>& results,
-           const int rear_start,
-           const EdlibAlignConfig& config) {
+// A query to look for in one of the windows of the read. Its score comes from the edit
+// distance found by the MultiQueryMatcher, and it's only aligned if its position is needed.
+struct Candidate {
+    std::string_view query;
+    std::string_view window;
+    std::string name;
+    int rear_start;
+    float score;
+    std::optional<dorado::SingleEndResult> result;
+};
+
+void add_candidate(std::vector<Candidate>& candidates,
+                   std::string_view query,
+                   std::string_view window,
+                   std::string name,
+                   const int rear_start,
+                   const int edit_distance) {
+    const float score = 1.0f - float(edit_distance) / query.length();
+    candidates.push_back({query, window, std::move(name), rear_start, score, std::nullopt});
+}
+
+const dorado::SingleEndResult& align(Candidate& candidate, const EdlibAlignConfig& config) {
+    if (candidate.result) {
+        return *candidate.result;
+    }
+    const auto q = candidate.query;
+    const auto t = candidate.window;
     auto result = edlibAlign(q.data(), int(q.length()), t.data(), int(t.length()), config);
-    results.emplace_back(copy_results(result, name, q.length()));
+    candidate.result = copy_results(result, candidate.name, q.length());
 
-    if (rear_start >= 0) {
-        results.back().position.first += rear_start;
-        results.back().position.second += rear_start;
+    if (candidate.rear_start >= 0) {
+        candidate.result->position.first += candidate.rear_start;
+        candidate.result->position.second += candidate.rear_start;
     }
 
     edlibFreeAlignResult(result);
+    return *candidate.result;
 }
 
-dorado::SingleEndResult get_best_result(const std::vector<dorado::SingleEndResult>& results) {
+dorado::SingleEndResult get_best_result(std::vector<Candidate>& candidates,
+                                        const EdlibAlignConfig& config) {
+    auto span = [&](int i) {
+        const auto& result = align(candidates[i], config);
+        return result.position.second - result.position.first;
+    };
+
     int best = -1;
     float best_score = -1.0f;
     constexpr float EPSILON = 0.1f;
-    for (size_t i = 0; i < results.size(); ++i) {
-        int old_span =
-                (best == -1) ? 0 : results[best].position.second - results[best].position.first;
-        int new_span = results[i].position.second - results[i].position.first;
-        if (results[i].score > best_score + EPSILON) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidates[i].score > best_score + EPSILON) {
             // The current match is clearly better than the previously seen best match.
-            best_score = results[i].score;
+            best_score = candidates[i].score;
             best = int(i);
         }
-        if (std::abs(results[i].score - best_score) <= EPSILON) {
+        if (best != int(i) && std::abs(candidates[i].score - best_score) <= EPSILON) {
             // The current match and previously seen best match have nearly equal scores. Pick the longer one.
-            if (new_span > old_span) {
-                best_score = results[i].score;
+            // Only these comparisons need the positions of the matches.
+            const int old_span = (best == -1) ? 0 : span(best);
+            if (span(int(i)) > old_span) {
+                best_score = candidates[i].score;
                 best = int(i);
             }
         }
     }
 
     if (best != -1) {
-        return results[best];
+        return align(candidates[best], config);
     }
 
     return {};
@@ -149,6 +177,19 @@ AdapterDetector::AdapterDetector(const std::optional<std::string>& custom_primer
             m_primer_sequences[i].sequence_rev = utils::reverse_complement(primers[i].sequence);
         }
     }
+    m_adapter_matcher = create_matcher(m_adapter_sequences);
+    m_primer_matcher = create_matcher(m_primer_sequences);
+}
+
+MultiQueryMatcher AdapterDetector::create_matcher(const std::vector<Query>& queries) {
+    // The forward and reverse sequences of query i are matcher queries 2i and 2i + 1.
+    std::vector<std::string> sequences;
+    sequences.reserve(2 * queries.size());
+    for (const auto& query : queries) {
+        sequences.push_back(query.sequence);
+        sequences.push_back(query.sequence_rev);
+    }
+    return MultiQueryMatcher(sequences);
 }
 
 AdapterDetector::~AdapterDetector() = default;
@@ -166,11 +207,11 @@ void AdapterDetector::parse_custom_sequence_file(const std::string& filename) {
 }
 
 AdapterScoreResult AdapterDetector::find_adapters(const std::string& seq) const {
-    return detect(seq, m_adapter_sequences, ADAPTER);
+    return detect(seq, m_adapter_sequences, m_adapter_matcher, ADAPTER);
 }
 
 AdapterScoreResult AdapterDetector::find_primers(const std::string& seq) const {
-    return detect(seq, m_primer_sequences, PRIMER);
+    return detect(seq, m_primer_sequences, m_primer_matcher, PRIMER);
 }
 
 const std::vector<AdapterDetector::Query>& AdapterDetector::get_adapter_sequences() const {
@@ -183,6 +224,7 @@ const std::vector<AdapterDetector::Query>& AdapterDetector::get_primer_sequences
 
 AdapterScoreResult AdapterDetector::detect(const std::string& seq,
                                            const std::vector<Query>& queries,
+                                           const MultiQueryMatcher& matcher,
                                            AdapterDetector::QueryType query_type) const {
     const std::string_view seq_view(seq);
     const auto TRIM_LENGTH = (query_type == ADAPTER ? ADAPTER_TRIM_LENGTH : PRIMER_TRIM_LENGTH);
@@ -190,10 +232,12 @@ AdapterScoreResult AdapterDetector::detect(const std::string& seq,
     int rear_start = std::max(0, int(seq.length()) - TRIM_LENGTH);
     const std::string_view read_rear = seq_view.substr(rear_start, TRIM_LENGTH);
 
-    // Try to find the location of the queries in the front and rear windows.
-    EdlibAlignConfig placement_config = init_edlib_config_for_adapters();
+    // Score every query in the front and rear windows, with a single pass over each window.
+    std::vector<int> front_distances, rear_distances;
+    matcher.edit_distances(read_front, front_distances);
+    matcher.edit_distances(read_rear, rear_distances);
 
-    std::vector<SingleEndResult> front_results, rear_results;
+    std::vector<Candidate> front_candidates, rear_candidates;
     constexpr int IS_FRONT = -1;
     for (size_t i = 0; i < queries.size(); i++) {
         const auto& name = queries[i].name;
@@ -202,27 +246,31 @@ AdapterScoreResult AdapterDetector::detect(const std::string& seq,
         spdlog::trace("Checking adapter/primer {}", name);
 
         if (!query_seq.empty()) {
-            align(query_seq, read_front, name + "_FWD", front_results, IS_FRONT, placement_config);
+            add_candidate(front_candidates, query_seq, read_front, name + "_FWD", IS_FRONT,
+                          front_distances[2 * i]);
         }
         if (!query_seq_rev.empty()) {
-            align(query_seq_rev, read_rear, name + "_REV", rear_results, rear_start,
-                  placement_config);
+            add_candidate(rear_candidates, query_seq_rev, read_rear, name + "_REV", rear_start,
+                          rear_distances[2 * i + 1]);
         }
 
         if (query_type == PRIMER) {
             // For primers we look for both the forward and reverse sequence at both ends.
             if (!query_seq_rev.empty()) {
-                align(query_seq_rev, read_front, name + "_REV", front_results, IS_FRONT,
-                      placement_config);
+                add_candidate(front_candidates, query_seq_rev, read_front, name + "_REV",
+                              IS_FRONT, front_distances[2 * i + 1]);
             }
             if (!query_seq.empty()) {
-                align(query_seq, read_rear, name + "_FWD", rear_results, rear_start,
-                      placement_config);
+                add_candidate(rear_candidates, query_seq, read_rear, name + "_FWD", rear_start,
+                              rear_distances[2 * i]);
             }
         }
     }
 
-    return {get_best_result(front_results), get_best_result(rear_results)};
+    // Find the location of the best matches in the front and rear windows.
+    EdlibAlignConfig placement_config = init_edlib_config_for_adapters();
+    return {get_best_result(front_candidates, placement_config),
+            get_best_result(rear_candidates, placement_config)};
 }
 
 }  // namespace demux
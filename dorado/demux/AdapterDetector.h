@@ -1,4 +1,5 @@
 #pragma once
+#include "MultiQueryMatcher.h"
 #include "read_pipeline/messages.h"
 #include "utils/stats.h"
 #include "utils/types.h"
@@ -35,8 +36,12 @@ private:
 
     std::vector<Query> m_adapter_sequences;
     std::vector<Query> m_primer_sequences;
+    MultiQueryMatcher m_adapter_matcher;
+    MultiQueryMatcher m_primer_matcher;
+    static MultiQueryMatcher create_matcher(const std::vector<Query>& queries);
     AdapterScoreResult detect(const std::string& seq,
                               const std::vector<Query>& queries,
+                              const MultiQueryMatcher& matcher,
                               QueryType query_type) const;
     void parse_custom_sequence_file(const std::string& custom_sequence_file);
 };
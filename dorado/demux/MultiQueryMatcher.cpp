@@ -0,0 +1,93 @@
+#include "MultiQueryMatcher.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int WORD_BITS = 64;
+
+bool is_acgt(uint8_t c) { return c == 'A' || c == 'C' || c == 'G' || c == 'T'; }
+
+// The equalities the adapter detector gives edlib, which apply both ways round.
+bool is_equal(uint8_t a, uint8_t b) {
+    return a == b || (a == 'N' && is_acgt(b)) || (b == 'N' && is_acgt(a));
+}
+
+}  // namespace
+
+namespace dorado::demux {
+
+MultiQueryMatcher::MultiQueryMatcher(const std::vector<std::string>& queries) {
+    m_queries.reserve(queries.size());
+    for (const auto& query : queries) {
+        const size_t num_words = (query.size() + WORD_BITS - 1) / WORD_BITS;
+        m_queries.push_back({m_num_words, num_words, static_cast<int>(query.size())});
+        m_num_words += num_words;
+    }
+
+    m_peq.assign(256 * m_num_words, 0);
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const auto& query = queries[q];
+        for (int c = 0; c < 256; ++c) {
+            uint64_t* peq = &m_peq[c * m_num_words + m_queries[q].first_word];
+            for (size_t i = 0; i < query.size(); ++i) {
+                if (is_equal(static_cast<uint8_t>(c), static_cast<uint8_t>(query[i]))) {
+                    peq[i / WORD_BITS] |= uint64_t{1} << (i % WORD_BITS);
+                }
+            }
+        }
+    }
+}
+
+void MultiQueryMatcher::edit_distances(std::string_view seq, std::vector<int>& distances) const {
+    // The first column of the edit distance matrix is 0, 1, 2, ..., so every vertical delta
+    // starts positive.
+    std::vector<uint64_t> pv(m_num_words, ~uint64_t{0});
+    std::vector<uint64_t> mv(m_num_words, 0);
+    std::vector<int> scores(m_queries.size());
+    distances.resize(m_queries.size());
+    for (size_t q = 0; q < m_queries.size(); ++q) {
+        scores[q] = distances[q] = m_queries[q].length;
+    }
+
+    for (const char c : seq) {
+        const uint64_t* peq = &m_peq[static_cast<uint8_t>(c) * m_num_words];
+        for (size_t q = 0; q < m_queries.size(); ++q) {
+            const auto& query = m_queries[q];
+            if (query.num_words == 0) {
+                continue;
+            }
+            const size_t last_word = query.first_word + query.num_words - 1;
+            // Matches can start anywhere in the sequence, so the top row is all 0.
+            int hin = 0;
+            for (size_t w = query.first_word; w <= last_word; ++w) {
+                // One block of Myers' algorithm, as in edlib. Bits above the query's length
+                // in its last word never affect the bits below them.
+                uint64_t eq = peq[w];
+                const uint64_t xv = eq | mv[w];
+                if (hin < 0) {
+                    eq |= 1;
+                }
+                const uint64_t xh = (((eq & pv[w]) + pv[w]) ^ pv[w]) | eq;
+                uint64_t ph = mv[w] | ~(xh | pv[w]);
+                uint64_t mh = pv[w] & xh;
+                const int top_bit = w == last_word ? (query.length - 1) % WORD_BITS : WORD_BITS - 1;
+                const int hout = int((ph >> top_bit) & 1) - int((mh >> top_bit) & 1);
+                ph <<= 1;
+                mh <<= 1;
+                if (hin < 0) {
+                    mh |= 1;
+                } else if (hin > 0) {
+                    ph |= 1;
+                }
+                pv[w] = mh | ~(xv | ph);
+                mv[w] = ph & xv;
+                hin = hout;
+            }
+            scores[q] += hin;
+            distances[q] = std::min(distances[q], scores[q]);
+        }
+    }
+}
+
+}  // namespace dorado::demux
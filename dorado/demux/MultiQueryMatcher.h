@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dorado::demux {
+
+// Finds the edit distance of each of a set of queries to its best matching substring of a
+// sequence, as edlib does in EDLIB_MODE_HW, with N equal to each of ACGT. The queries are
+// compiled once into bit vectors for Myers' bit-parallel algorithm, and the sequence is scanned
+// once for all of them. Only the distances are found, so the alignment of any query of interest
+// still needs to be found with edlib.
+class MultiQueryMatcher {
+public:
+    MultiQueryMatcher() = default;
+    explicit MultiQueryMatcher(const std::vector<std::string>& queries);
+
+    size_t num_queries() const { return m_queries.size(); }
+
+    // Fills distances with the edit distance of each query. Empty queries have a distance of 0.
+    void edit_distances(std::string_view seq, std::vector<int>& distances) const;
+
+private:
+    struct Query {
+        // The query's bit vectors are m_peq[c * m_num_words + first_word + i], for i < num_words.
+        size_t first_word;
+        size_t num_words;
+        int length;
+    };
+
+    std::vector<Query> m_queries;
+    size_t m_num_words{0};
+    // For each character, the bit vectors of the query positions it's equal to.
+    std::vector<uint64_t> m_peq;
+};
+
+}  // namespace dorado::demux
@@ -1,12 +1,24 @@
 #include "Trimmer.h"
 
 #include "torch_utils/trim.h"
+#include "utils/bam_pool.h"
 #include "utils/bam_utils.h"
 #include "utils/sequence_utils.h"
 
 #include <ATen/TensorIndexing.h>
+#include <htslib/hts.h>
 #include <htslib/sam.h>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
 using Slice = at::indexing::Slice;
 
 namespace {
@@ -38,6 +50,131 @@ std::pair<int, int> reverse_complement_interval(const std::pair<int, int>& inter
     return {seqlen - interval.second, seqlen - interval.first};
 }
 
+// Complements of the htslib 4 bit base codes, including the ambiguity codes.
+constexpr std::array<uint8_t, 16> NT16_COMPLEMENT = {0, 8, 4, 12, 2, 10, 6, 14,
+                                                     1, 9, 5, 13, 3, 11, 7, 15};
+
+// Copies the bases of the trim interval, which is in the forward orientation of the read,
+// from one packed sequence to another, without converting them to text.
+void copy_trimmed_bases(const uint8_t* seq,
+                        int seqlen,
+                        bool is_seq_reversed,
+                        std::pair<int, int> trim_interval,
+                        uint8_t* out_seq) {
+    const int trimmed_len = trim_interval.second - trim_interval.first;
+    if (!is_seq_reversed && trim_interval.first % 2 == 0) {
+        // The bases are already aligned to bytes.
+        std::memcpy(out_seq, seq + trim_interval.first / 2, (trimmed_len + 1) / 2);
+        if (trimmed_len % 2) {
+            out_seq[trimmed_len / 2] &= 0xf0;
+        }
+        return;
+    }
+    std::memset(out_seq, 0, (trimmed_len + 1) / 2);
+    for (int i = 0; i < trimmed_len; ++i) {
+        const uint8_t base =
+                is_seq_reversed
+                        ? NT16_COMPLEMENT[bam_seqi(seq, seqlen - 1 - trim_interval.first - i)]
+                        : uint8_t(bam_seqi(seq, trim_interval.first + i));
+        out_seq[i / 2] |= base << ((~i & 1) << 2);
+    }
+}
+
+// The move table of a record. Move tables are written as int8 arrays, which are read in place
+// from the mv tag, and any other array type is converted.
+struct MoveTable {
+    int stride = 0;
+    const uint8_t* values = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> converted;
+
+    explicit MoveTable(bam1_t* record) {
+        const uint8_t* tag_data = bam_aux_get(record, "mv");
+        if (!tag_data) {
+            return;
+        }
+        // First element for move table array is the stride.
+        stride = int(bam_auxB2i(tag_data, 0));
+        size = bam_auxB_len(tag_data) - 1;
+        if (tag_data[1] == 'c' || tag_data[1] == 'C') {
+            values = tag_data + 6 + 1;
+        } else {
+            converted.resize(size);
+            for (size_t i = 0; i < size; ++i) {
+                converted[i] = uint8_t(bam_auxB2i(tag_data, uint32_t(1 + i)));
+            }
+            values = converted.data();
+        }
+    }
+
+    MoveTable(const MoveTable&) = delete;
+    MoveTable& operator=(const MoveTable&) = delete;
+};
+
+void append_tag(std::vector<uint8_t>& aux,
+                const char* tag,
+                char type,
+                const void* value,
+                size_t value_size) {
+    aux.push_back(uint8_t(tag[0]));
+    aux.push_back(uint8_t(tag[1]));
+    aux.push_back(uint8_t(type));
+    const auto* bytes = static_cast<const uint8_t*>(value);
+    aux.insert(aux.end(), bytes, bytes + value_size);
+}
+
+// Writes an integer tag with the smallest type that holds the value, as bam_aux_update_int does.
+void append_int_tag(std::vector<uint8_t>& aux, const char* tag, int64_t value) {
+    if (value < 0) {
+        if (value >= INT8_MIN) {
+            const auto v = int8_t(value);
+            append_tag(aux, tag, 'c', &v, sizeof(v));
+        } else if (value >= INT16_MIN) {
+            const auto v = int16_t(value);
+            append_tag(aux, tag, 's', &v, sizeof(v));
+        } else {
+            const auto v = int32_t(value);
+            append_tag(aux, tag, 'i', &v, sizeof(v));
+        }
+    } else {
+        if (value <= UINT8_MAX) {
+            const auto v = uint8_t(value);
+            append_tag(aux, tag, 'C', &v, sizeof(v));
+        } else if (value <= UINT16_MAX) {
+            const auto v = uint16_t(value);
+            append_tag(aux, tag, 'S', &v, sizeof(v));
+        } else {
+            const auto v = uint32_t(value);
+            append_tag(aux, tag, 'I', &v, sizeof(v));
+        }
+    }
+}
+
+// Writes the header of a B array tag of one byte values, followed by the values.
+void append_array_tag(std::vector<uint8_t>& aux,
+                      const char* tag,
+                      char subtype,
+                      const uint8_t* values,
+                      uint32_t count) {
+    append_tag(aux, tag, 'B', &subtype, 1);
+    aux.insert(aux.end(), reinterpret_cast<const uint8_t*>(&count),
+               reinterpret_cast<const uint8_t*>(&count) + sizeof(count));
+    aux.insert(aux.end(), values, values + count);
+}
+
+void append_move_tag(std::vector<uint8_t>& aux,
+                     const MoveTable& moves,
+                     const dorado::utils::TrimmedMoves& trimmed_moves) {
+    // Move table format is stride followed by moves.
+    const auto count = uint32_t(trimmed_moves.size + 1);
+    append_tag(aux, "mv", 'B', "c", 1);
+    aux.insert(aux.end(), reinterpret_cast<const uint8_t*>(&count),
+               reinterpret_cast<const uint8_t*>(&count) + sizeof(count));
+    aux.push_back(uint8_t(moves.stride));
+    const uint8_t* first = moves.values + trimmed_moves.first;
+    aux.insert(aux.end(), first, first + trimmed_moves.size);
+}
+
 }  // namespace
 
 namespace dorado {
@@ -125,33 +262,29 @@ std::pair<int, int> Trimmer::determine_trim_interval(const AdapterScoreResult& r
 }
 
 BamPtr Trimmer::trim_sequence(bam1_t* input_record, std::pair<int, int> trim_interval) {
-    bool is_seq_reversed = input_record->core.flag & BAM_FREVERSE;
+    const bool is_seq_reversed = input_record->core.flag & BAM_FREVERSE;
+    const int seqlen = input_record->core.l_qseq;
+    if (trim_interval.first >= seqlen || trim_interval.second > seqlen ||
+        trim_interval.second < trim_interval.first) {
+        throw std::invalid_argument("Trim interval " + std::to_string(trim_interval.first) + "-" +
+                                    std::to_string(trim_interval.second) +
+                                    " is invalid for sequence " +
+                                    utils::extract_sequence(input_record));
+    }
+    const int trimmed_len = trim_interval.second - trim_interval.first;
 
-    // Fetch components that need to be trimmed.
-    std::string seq = utils::extract_sequence(input_record);
-    std::vector<uint8_t> qual = utils::extract_quality(input_record);
-    auto [stride, move_vals] = utils::extract_move_table(input_record);
+    // Any barcode/primer/adapter detection was done against the fwd sequence, so ensure we trim
+    // in that orientation too. The moves are always in the basecalled orientation.
+    const MoveTable moves(input_record);
+    const auto trimmed_moves = utils::find_trimmed_moves(moves.values, moves.size, trim_interval);
     int ts = bam_aux_get(input_record, "ts") ? int(bam_aux2i(bam_aux_get(input_record, "ts"))) : -1;
     int ns = bam_aux_get(input_record, "ns") ? int(bam_aux2i(bam_aux_get(input_record, "ns"))) : -1;
-    auto [modbase_str, modbase_probs] = utils::extract_modbase_info(input_record);
-
-    // Any barcode/primer/adapter detection was done against the fwd sequence, so ensure we trim in that orientation too
-    if (is_seq_reversed) {
-        seq = utils::reverse_complement(seq);
-        std::reverse(std::begin(qual), std::end(qual));
-    }
-
-    // Actually trim components.
-    auto trimmed_seq = utils::trim_sequence(seq, trim_interval);
-    auto trimmed_qual = utils::trim_quality(qual, trim_interval);
-    auto [positions_trimmed, trimmed_moves] = utils::trim_move_table(move_vals, trim_interval);
-
-    if (move_vals.empty()) {
+    if (moves.size == 0) {
         ns = -1;
         ts = -1;
     } else {
         if (ts >= 0) {
-            ts += positions_trimmed * stride;
+            ts += trimmed_moves.positions_trimmed * moves.stride;
         }
         if (ns >= 0) {
             // After sequence trimming, the number of samples corresponding to the sequence is the size of
@@ -159,47 +292,112 @@ BamPtr Trimmer::trim_sequence(bam1_t* input_record, std::pair<int, int> trim_int
             // the front of the read as well. If ts is negative, the tag is not present, so treat it as 0.
             // |---------------------- ns ------------------|
             // |----ts----|--------moves signal-------------|
-            ns = int(trimmed_moves.size() * stride) + std::max(0, ts);
+            ns = int(trimmed_moves.size * moves.stride) + std::max(0, ts);
         }
     }
 
-    auto [trimmed_modbase_str, trimmed_modbase_probs] = utils::trim_modbase_info(
-            seq, modbase_str, modbase_probs,
-            is_seq_reversed ? reverse_complement_interval(trim_interval, int(seq.length()))
-                            : trim_interval);
-
-    // Create a new bam record to hold the trimmed read.
-    BamPtr output(utils::new_unmapped_record(input_record, trimmed_seq, trimmed_qual));
-    bam1_t* out_record = output.get();
-
-    // Insert the new tags and delete the old ones.
-    if (!trimmed_moves.empty()) {
-        bam_aux_del(out_record, bam_aux_get(out_record, "mv"));
-        // Move table format is stride followed by moves.
-        trimmed_moves.insert(trimmed_moves.begin(), uint8_t(stride));
-        bam_aux_update_array(out_record, "mv", 'c', int(trimmed_moves.size()),
-                             (uint8_t*)trimmed_moves.data());
+    // The modbase tags are the only ones which need the sequence as text.
+    std::string trimmed_modbase_str;
+    std::vector<uint8_t> trimmed_modbase_probs;
+    if (bam_aux_get(input_record, "MM")) {
+        std::string seq = utils::extract_sequence(input_record);
+        if (is_seq_reversed) {
+            seq = utils::reverse_complement(seq);
+        }
+        auto [modbase_str, modbase_probs] = utils::extract_modbase_info(input_record);
+        std::tie(trimmed_modbase_str, trimmed_modbase_probs) = utils::trim_modbase_info(
+                seq, modbase_str, modbase_probs,
+                is_seq_reversed ? reverse_complement_interval(trim_interval, seqlen)
+                                : trim_interval);
+    }
+    const bool update_modbase = !trimmed_modbase_str.empty();
+
+    // Copy the tags in a single pass, dropping alignment tags and replacing trimmed ones.
+    std::vector<uint8_t> aux;
+    aux.reserve(bam_get_l_aux(input_record) + 16);
+    bool has_mn = false;
+    const uint8_t* const aux_end = bam_get_aux(input_record) + bam_get_l_aux(input_record);
+    for (const uint8_t* tag_data = bam_aux_first(input_record); tag_data;) {
+        const uint8_t* next = bam_aux_next(input_record, tag_data);
+        const char* tag = bam_aux_tag(tag_data);
+        const std::string_view tag_name(tag, 2);
+        if (utils::is_alignment_tag(tag)) {
+            // Dropped, as the record is unmapped.
+        } else if (tag_name == "mv" && trimmed_moves.size > 0) {
+            append_move_tag(aux, moves, trimmed_moves);
+        } else if (tag_name == "MM" && update_modbase) {
+            append_tag(aux, "MM", 'Z', trimmed_modbase_str.c_str(),
+                       trimmed_modbase_str.length() + 1);
+        } else if (tag_name == "ML" && update_modbase) {
+            append_array_tag(aux, "ML", 'C', trimmed_modbase_probs.data(),
+                             uint32_t(trimmed_modbase_probs.size()));
+        } else if (tag_name == "MN" && update_modbase) {
+            append_int_tag(aux, "MN", trimmed_len);
+            has_mn = true;
+        } else if (tag_name == "ts") {
+            if (ts >= 0) {
+                append_int_tag(aux, "ts", ts);
+            }
+        } else if (tag_name == "ns") {
+            if (ns >= 0) {
+                append_int_tag(aux, "ns", ns);
+            }
+        } else {
+            const uint8_t* tag_start = tag_data - 2;
+            aux.insert(aux.end(), tag_start, next ? next - 2 : aux_end);
+        }
+        tag_data = next;
+    }
+    if (update_modbase && !has_mn) {
+        append_int_tag(aux, "MN", trimmed_len);
     }
 
-    if (!trimmed_modbase_str.empty()) {
-        bam_aux_del(out_record, bam_aux_get(out_record, "MM"));
-        bam_aux_append(out_record, "MM", 'Z', int(trimmed_modbase_str.length() + 1),
-                       (uint8_t*)trimmed_modbase_str.c_str());
-        bam_aux_del(out_record, bam_aux_get(out_record, "ML"));
-        bam_aux_update_array(out_record, "ML", 'C', int(trimmed_modbase_probs.size()),
-                             (uint8_t*)trimmed_modbase_probs.data());
-        bam_aux_update_int(out_record, "MN", trimmed_seq.length());
+    // Build the trimmed, unmapped record in a single allocation.
+    const size_t qname_len = input_record->core.l_qname - input_record->core.l_extranul - 1;
+    const size_t l_extranul = (qname_len + 1) % 4 ? 4 - (qname_len + 1) % 4 : 0;
+    const size_t l_qname = qname_len + 1 + l_extranul;
+    const size_t l_data = l_qname + (trimmed_len + 1) / 2 + trimmed_len + aux.size();
+    if (l_data > std::numeric_limits<int>::max()) {
+        throw std::overflow_error("Trimmed record for " +
+                                  std::string(bam_get_qname(input_record)) + " is too large.");
     }
 
-    if (ts >= 0) {
-        bam_aux_update_int(out_record, "ts", ts);
-    } else if (bam_aux_get(out_record, "ts")) {
-        bam_aux_del(out_record, bam_aux_get(out_record, "ts"));
+    BamPtr output = utils::acquire_bam();
+    bam1_t* out_record = output.get();
+    if (out_record->m_data < l_data && sam_realloc_bam_data(out_record, l_data) < 0) {
+        throw std::bad_alloc();
+    }
+    out_record->l_data = int(l_data);
+    out_record->core = {};
+    out_record->core.tid = -1;
+    out_record->core.pos = -1;
+    out_record->core.bin = uint16_t(hts_reg2bin(-1, 0, 14, 5));
+    out_record->core.qual = 0;
+    out_record->core.l_extranul = uint8_t(l_extranul);
+    out_record->core.flag = BAM_FUNMAP;
+    out_record->core.l_qname = uint16_t(l_qname);
+    out_record->core.n_cigar = 0;
+    out_record->core.l_qseq = trimmed_len;
+    out_record->core.mtid = -1;
+    out_record->core.mpos = -1;
+    out_record->core.isize = 0;
+
+    uint8_t* data = out_record->data;
+    std::memcpy(data, bam_get_qname(input_record), qname_len);
+    std::memset(data + qname_len, 0, l_qname - qname_len);
+    copy_trimmed_bases(bam_get_seq(input_record), seqlen, is_seq_reversed, trim_interval,
+                       bam_get_seq(out_record));
+    const uint8_t* qual = bam_get_qual(input_record);
+    uint8_t* out_qual = bam_get_qual(out_record);
+    if (is_seq_reversed) {
+        for (int i = 0; i < trimmed_len; ++i) {
+            out_qual[i] = qual[seqlen - 1 - trim_interval.first - i];
+        }
+    } else {
+        std::memcpy(out_qual, qual + trim_interval.first, trimmed_len);
     }
-    if (ns >= 0) {
-        bam_aux_update_int(out_record, "ns", ns);
-    } else if (bam_aux_get(out_record, "ns")) {
-        bam_aux_del(out_record, bam_aux_get(out_record, "ns"));
+    if (!aux.empty()) {
+        std::memcpy(bam_get_aux(out_record), aux.data(), aux.size());
     }
 
     return output;
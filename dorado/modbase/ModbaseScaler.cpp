@@ -1,6 +1,7 @@
 #include "ModbaseScaler.h"
 
 #include "utils/math_utils.h"
+#include "utils/sequence_utils.h"
 
 #include <ATen/Functions.h>
 #include <ATen/TensorOperators.h>
@@ -19,14 +20,6 @@ ModBaseScaler::ModBaseScaler(const std::vector<float>& kmer_levels,
     assert(m_kmer_levels.size() == static_cast<size_t>(1ull << (2 * m_kmer_len)));
 }
 
-size_t ModBaseScaler::index_from_int_kmer(const int* int_kmer_start, size_t kmer_len) {
-    size_t index = 0;
-    for (int kmer_pos = 0; kmer_pos < static_cast<int>(kmer_len); ++kmer_pos) {
-        index += *(int_kmer_start + kmer_len - kmer_pos - 1) * (1 << (2 * kmer_pos));
-    }
-    return index;
-}
-
 at::Tensor ModBaseScaler::scale_signal(const at::Tensor& signal,
                                        const std::vector<int>& seq_ints,
                                        const std::vector<uint64_t>& seq_to_sig_map) const {
@@ -46,11 +39,10 @@ std::vector<float> ModBaseScaler::extract_levels(const std::vector<int>& int_seq
         return levels;
     }
 
-    auto int_kmer_start_ptr = int_seq.data();
+    const auto kmer_indices = utils::kmer_indices(int_seq, m_kmer_len);
     auto levels_ptr = levels.data() + m_centre_index;
-    for (size_t pos = 0; pos < int_seq.size() - m_kmer_len;
-         ++pos, ++int_kmer_start_ptr, ++levels_ptr) {
-        *(levels_ptr) = m_kmer_levels[index_from_int_kmer(int_kmer_start_ptr, m_kmer_len)];
+    for (size_t pos = 0; pos < int_seq.size() - m_kmer_len; ++pos, ++levels_ptr) {
+        *(levels_ptr) = m_kmer_levels[kmer_indices[pos]];
     }
     return levels;
 }
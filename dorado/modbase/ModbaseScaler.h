@@ -16,13 +16,6 @@ private:
     const size_t m_kmer_len;
     const size_t m_centre_index;
 
-    /** Get the index in the model kmer_levels corresponding to the input kmer
-     *  @param int_kmer_start Pointer to the start of the kmer in the sequence
-     *  @param kmer_len The length of the kmer
-     *  @return The index of the kmer
-     */
-    static inline size_t index_from_int_kmer(const int* int_kmer_start, size_t kmer_len);
-
     /** Get the expected normalized daq levels for in the input basecall sequence.
      *  @param int_seq The basecall sequence, encoded as integers with A=0, C=1, G=2, T=3
      *  @return A vector of the expected normalized daq level for each base
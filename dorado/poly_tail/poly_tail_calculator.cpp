@@ -11,12 +11,46 @@
 
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 namespace dorado::poly_tail {
 
 namespace {
 const int kMaxTailLength = PolyTailCalculator::max_tail_length();
-}
+
+// Prefix sums of the signal and its square over [start, end), so the mean and standard
+// deviation of any interval in that range take constant time however long the interval is.
+// The sums are kept in double, as the squares of the signal can't be summed over a long
+// range in float without losing the precision the variance needs.
+class SignalStats {
+public:
+    SignalStats(const c10::Half* signal, int start, int end)
+            : m_start(start),
+              m_sums(std::max(0, end - start) + 1, 0.0),
+              m_squared_sums(m_sums.size(), 0.0) {
+        for (int i = start; i < end; i++) {
+            const double value = static_cast<float>(signal[i]);
+            m_sums[i - start + 1] = m_sums[i - start] + value;
+            m_squared_sums[i - start + 1] = m_squared_sums[i - start] + value * value;
+        }
+    }
+
+    // Mean and standard deviation of the signal in [s, e).
+    std::pair<float, float> operator()(int s, int e) const {
+        const double n = e - s;
+        const double avg = (m_sums[e - m_start] - m_sums[s - m_start]) / n;
+        const double var =
+                (m_squared_sums[e - m_start] - m_squared_sums[s - m_start]) / n - avg * avg;
+        return {static_cast<float>(avg), static_cast<float>(std::sqrt(std::max(0.0, var)))};
+    }
+
+private:
+    const int m_start;
+    std::vector<double> m_sums;
+    std::vector<double> m_squared_sums;
+};
+
+}  // namespace
 
 float PolyTailCalculator::estimate_samples_per_base(const dorado::SimplexRead& read) const {
     const size_t num_bases = read.read_common.seq.length();
@@ -40,20 +74,6 @@ std::pair<int, int> PolyTailCalculator::determine_signal_bounds(int signal_ancho
     const c10::Half* signal = static_cast<c10::Half*>(read.read_common.raw_data.data_ptr());
     int signal_len = int(read.read_common.get_raw_data_samples());
 
-    auto calc_stats = [&](int s, int e) -> std::pair<float, float> {
-        float avg = 0;
-        for (int i = s; i < e; i++) {
-            avg += signal[i];
-        }
-        avg = avg / (e - s);
-        float var = 0;
-        for (int i = s; i < e; i++) {
-            var += (signal[i] - avg) * (signal[i] - avg);
-        }
-        var = var / (e - s);
-        return {avg, std::sqrt(var)};
-    };
-
     // Maximum variance between consecutive values to be
     // considered part of the same interval.
     const float kVar = 0.35f;
@@ -71,6 +91,9 @@ std::pair<int, int> PolyTailCalculator::determine_signal_bounds(int signal_ancho
     auto [left_end, right_end] = signal_range(signal_anchor, signal_len, num_samples_per_base);
     spdlog::trace("Bounds left {}, right {}", left_end, right_end);
 
+    // All the intervals considered are within the bounds.
+    const SignalStats calc_stats(signal, left_end, right_end);
+
     std::vector<std::pair<int, int>> intervals;
     std::pair<float, float> last_interval_stats;
     const int kStride = 3;
@@ -1,6 +1,7 @@
 #include "AlignerNode.h"
 
 #include "ClientInfo.h"
+#include "HtsWriter.h"
 #include "alignment/Minimap2Aligner.h"
 #include "alignment/Minimap2Index.h"
 #include "alignment/alignment_info.h"
@@ -190,6 +191,13 @@ void AlignerNode::align_bam_message(utils::concurrency::AsyncTaskExecutor& execu
         thread_local MmTbufPtr tbuf{mm_tbuf_init()};
         auto records = alignment::Minimap2Aligner(m_index_for_bam_messages)
                                .align(bam_message_.bam_ptr.get(), tbuf.get());
+        // The alignments replace the input record in the count of records its output waits for.
+        auto output = bam_message_.client_info
+                              ? bam_message_.client_info->contexts().get_ptr<HtsWriterOutput>()
+                              : nullptr;
+        if (output) {
+            output->add_pending(records.size());
+        }
         for (auto& record : records) {
             if (m_bedfile_for_bam_messages && !(record->core.flag & BAM_FUNMAP)) {
                 auto ref_id = record->core.tid;
@@ -197,6 +205,9 @@ void AlignerNode::align_bam_message(utils::concurrency::AsyncTaskExecutor& execu
             }
             send_message_to_sink(BamMessage{std::move(record), bam_message_.client_info});
         }
+        if (output) {
+            output->remove_pending();
+        }
     });
 }
 
@@ -4,19 +4,29 @@
 #include "utils/SampleSheet.h"
 #include "utils/fastq_reader.h"
 #include "utils/hts_file.h"
+#include "utils/thread_naming.h"
 
 #include <htslib/bgzf.h>
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 
+#include <algorithm>
 #include <cassert>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 namespace dorado {
 
 namespace {
-constexpr size_t BAM_BUFFER_SIZE =
-        20000000;  // 20 MB per barcode classification. So roughly 2 GB for 96 barcodes.
+// 20 MB per barcode classification, split between the file's two sort buffers.  So roughly
+// 2 GB for 96 barcodes.
+constexpr size_t BAM_BUFFER_SIZE = 20000000;
+// Writing is mostly copying into sort buffers or handing blocks to the compression
+// pool, so a few writer threads are enough to keep up with the input.
+constexpr size_t MAX_WRITER_THREADS = 4;
+constexpr size_t WRITER_QUEUE_SIZE = 1000;
 
 std::string get_run_id_from_fq_tag(const bam1_t& record) {
     auto fastq_id_tag = bam_aux_get(&record, "fq");
@@ -77,22 +87,63 @@ BarcodeDemuxerNode::BarcodeDemuxerNode(const std::string& output_dir,
           m_sort_bam(sort_bam && !write_fastq),
           m_sample_sheet(std::move(sample_sheet)) {
     std::filesystem::create_directories(m_output_dir);
+    if (!m_write_fastq) {
+        m_thread_pool.reset(hts_tpool_init(std::max(m_htslib_threads, 1)));
+        if (!m_thread_pool) {
+            throw std::runtime_error("Could not create thread pool for BAM output.");
+        }
+    }
+    const size_t num_writers =
+            std::clamp(static_cast<size_t>(m_htslib_threads), size_t{1}, MAX_WRITER_THREADS);
+    for (size_t i = 0; i < num_writers; ++i) {
+        m_writer_queues.push_back(std::make_unique<WriterQueue>(WRITER_QUEUE_SIZE));
+    }
 }
 
 BarcodeDemuxerNode::~BarcodeDemuxerNode() { stop_input_processing(); }
 
 void BarcodeDemuxerNode::input_thread_fn() {
+    std::vector<std::thread> writer_threads;
+    for (auto& queue : m_writer_queues) {
+        queue->restart();
+        writer_threads.emplace_back([this, &queue = *queue] {
+            utils::set_thread_name("brcd_demux_wr");
+            writer_thread_fn(queue);
+        });
+    }
+
     Message message;
     while (get_input_message(message)) {
         auto bam_message = std::move(std::get<BamMessage>(message));
-        write(*bam_message.bam_ptr);
+        auto& file = get_file(*bam_message.bam_ptr);
+        auto& queue = *m_writer_queues[m_file_writers.at(&file)];
+        if (queue.try_push({&file, std::move(bam_message.bam_ptr)}) !=
+            utils::AsyncQueueStatus::Success) {
+            break;
+        }
+    }
+
+    // Let the writers drain their queues before returning.
+    for (auto& queue : m_writer_queues) {
+        queue->terminate();
+    }
+    for (auto& writer_thread : writer_threads) {
+        writer_thread.join();
+    }
+}
+
+void BarcodeDemuxerNode::writer_thread_fn(WriterQueue& queue) {
+    WriteTask task;
+    while (queue.try_pop(task) == utils::AsyncQueueStatus::Success) {
+        write(*task.file, *task.record);
+        task.record.reset();
     }
 }
 
 // Each barcode is mapped to its own file. Depending
 // on the barcode assigned to each read, the read is
 // written to the corresponding barcode file.
-int BarcodeDemuxerNode::write(bam1_t& record) {
+utils::HtsFile& BarcodeDemuxerNode::get_file(bam1_t& record) {
     assert(m_header);
     // Fetch the barcode name.
     std::string barcode = "unclassified";
@@ -117,14 +168,23 @@ int BarcodeDemuxerNode::write(bam1_t& record) {
         file = std::make_unique<utils::HtsFile>(
                 filepath_str,
                 m_write_fastq ? utils::HtsFile::OutputMode::FASTQ : utils::HtsFile::OutputMode::BAM,
-                m_htslib_threads, m_sort_bam);
+                0, m_sort_bam);
+        if (m_thread_pool) {
+            file->set_thread_pool(m_thread_pool.get());
+        }
         if (m_sort_bam) {
             file->set_buffer_size(BAM_BUFFER_SIZE);
         }
         file->set_header(m_header.get());
+        // Files are shared out between the writers in the order they're created.
+        const size_t writer_idx = m_file_writers.size() % m_writer_queues.size();
+        m_file_writers.emplace(file.get(), writer_idx);
     }
+    return *file;
+}
 
-    auto hts_res = file->write(&record);
+int BarcodeDemuxerNode::write(utils::HtsFile& file, bam1_t& record) {
+    auto hts_res = file.write(&record);
     if (hts_res < 0) {
         throw std::runtime_error("Failed to write SAM record, error code " +
                                  std::to_string(hts_res));
@@ -142,18 +202,54 @@ void BarcodeDemuxerNode::set_header(const sam_hdr_t* const header) {
 
 void BarcodeDemuxerNode::finalise_hts_files(
         const utils::HtsFile::ProgressCallback& progress_callback) {
-    const size_t num_files = m_files.size();
-    size_t current_file_idx = 0;
+    std::vector<utils::HtsFile*> files;
+    files.reserve(m_files.size());
     for (auto& [bc, hts_file] : m_files) {
-        hts_file->finalise([&](size_t progress) {
-            // Give each file/barcode the same contribution to the total progress.
-            const size_t total_progress = (current_file_idx * 100 + progress) / num_files;
+        files.push_back(hts_file.get());
+    }
+
+    // Each file/barcode gives the same contribution to the total progress.
+    std::mutex progress_mutex;
+    std::vector<size_t> file_progress(files.size(), 0);
+    size_t reported_progress = 0;
+    auto update_progress = [&](size_t file_idx, size_t progress) {
+        std::lock_guard lock(progress_mutex);
+        file_progress[file_idx] = progress;
+        size_t total_progress = 0;
+        for (auto p : file_progress) {
+            total_progress += p;
+        }
+        total_progress /= file_progress.size();
+        // Only report forward progress, since files don't update in step with each other.
+        if (total_progress > reported_progress) {
+            reported_progress = total_progress;
             progress_callback(total_progress);
-        });
-        ++current_file_idx;
+        }
+    };
+
+    // The sort, merge and index of each file is independent of the others, so they
+    // run concurrently, all compressing with the shared thread pool.
+    std::atomic<size_t> next_file_idx{0};
+    auto finalise_files = [&] {
+        for (size_t file_idx = next_file_idx++; file_idx < files.size();
+             file_idx = next_file_idx++) {
+            files[file_idx]->finalise(
+                    [&, file_idx](size_t progress) { update_progress(file_idx, progress); });
+        }
+    };
+    const size_t num_threads =
+            std::min(files.size(), static_cast<size_t>(std::max(m_htslib_threads, 1)));
+    std::vector<std::thread> finalise_threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        finalise_threads.emplace_back(finalise_files);
+    }
+    finalise_files();
+    for (auto& finalise_thread : finalise_threads) {
+        finalise_thread.join();
     }
 
     m_files.clear();
+    m_file_writers.clear();
     progress_callback(100);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "read_pipeline/MessageSink.h"
+#include "utils/AsyncQueue.h"
 #include "utils/hts_file.h"
 #include "utils/stats.h"
 #include "utils/types.h"
@@ -10,6 +11,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct bam1_t;
 
@@ -40,17 +42,35 @@ public:
 
     // Finalisation must occur before destruction of this node.
     // Note that this isn't safe to call until after this node has been terminated.
+    // Files are finalised concurrently, and the callback receives their combined progress.
     void finalise_hts_files(const utils::HtsFile::ProgressCallback& progress_callback);
 
 private:
+    // Records are routed to the writer thread which owns their file, so that each
+    // file is only written from one thread and its records stay in order.
+    struct WriteTask {
+        utils::HtsFile* file{nullptr};
+        BamPtr record;
+    };
+    using WriterQueue = utils::AsyncQueue<WriteTask>;
+
     const std::filesystem::path m_output_dir;
     const int m_htslib_threads;
     SamHdrPtr m_header;
     std::atomic<int> m_processed_reads{0};
 
+    // Compression threads shared by every output file. Declared before the files so
+    // that it outlives them.
+    HtsTpoolPtr m_thread_pool;
     HtsFiles m_files;
+    // Index of the writer thread that each file in m_files is assigned to.
+    std::unordered_map<const utils::HtsFile*, size_t> m_file_writers;
+    std::vector<std::unique_ptr<WriterQueue>> m_writer_queues;
+
     void input_thread_fn();
-    int write(bam1_t& record);
+    void writer_thread_fn(WriterQueue& queue);
+    utils::HtsFile& get_file(bam1_t& record);
+    int write(utils::HtsFile& file, bam1_t& record);
     const bool m_write_fastq;
     const bool m_sort_bam;
     const std::unique_ptr<const utils::SampleSheet> m_sample_sheet;
@@ -9,19 +9,17 @@
 #include "utils/thread_naming.h"
 
 #include <ATen/Functions.h>
-#include <ATen/TensorIndexing.h>
 #include <nvtx3/nvtx3.hpp>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
-#include <cstdlib>
+#include <future>
 
 #if DORADO_METAL_BUILD
 #include "torch_utils/metal_utils.h"
 #endif
 
 using namespace std::chrono_literals;
-using namespace at::indexing;
 
 namespace dorado {
 
@@ -44,6 +42,11 @@ struct BasecallerNode::BasecallingRead {
     std::atomic_size_t num_chunks_called;  // Number of chunks which have been basecalled.
 };
 
+struct BasecallerNode::InFlightBatch {
+    std::vector<std::unique_ptr<BasecallingChunk>> chunks;
+    std::future<std::vector<basecall::decode::DecodedChunk>> decode_results;
+};
+
 size_t BasecallerNode::get_chunk_queue_idx(size_t read_raw_size) {
     // A read goes either to the queue with the smallest chunk size which can fit the whole read,
     // or, if the read is larger than all chunk sizes, the queue with the largest chunk size.
@@ -146,19 +149,9 @@ void BasecallerNode::basecall_current_batch(int worker_id) {
                   model_runner->batch_size(), batched_chunks.size(), worker_id);
 
     dorado::stats::Timer timer;
-    auto decode_results = model_runner->call_chunks(int(batched_chunks.size()));
+    auto decode_results = model_runner->call_chunks_async(int(batched_chunks.size()));
     m_call_chunks_ms += timer.GetElapsedMS();
 
-    for (size_t i = 0; i < batched_chunks.size(); i++) {
-        batched_chunks[i]->seq = std::move(decode_results[i].sequence);
-        batched_chunks[i]->qstring = std::move(decode_results[i].qstring);
-        batched_chunks[i]->moves = std::move(decode_results[i].moves);
-    }
-
-    for (auto &complete_chunk : batched_chunks) {
-        m_processed_chunks.try_push(std::move(complete_chunk));
-    }
-
     m_num_samples_incl_padding += model_runner->chunk_size() * model_runner->batch_size();
     if (batched_chunks.size() == model_runner->batch_size()) {
         ++m_num_batches_called;
@@ -166,7 +159,44 @@ void BasecallerNode::basecall_current_batch(int worker_id) {
         ++m_num_partial_batches_called;
     }
 
+    // The previous batch has been decoding while this one was assembled, and the runner
+    // needs its input buffer back before the next batch can be staged.
+    collect_in_flight_batch(worker_id);
+
+    auto &in_flight_batch = *m_in_flight_batches[worker_id];
+    in_flight_batch.chunks = std::move(batched_chunks);
+    in_flight_batch.decode_results = std::move(decode_results);
     batched_chunks.clear();
+
+    // Runners which call synchronously have nothing to overlap, so don't hold on to their results.
+    if (in_flight_batch.decode_results.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready) {
+        collect_in_flight_batch(worker_id);
+    }
+}
+
+void BasecallerNode::collect_in_flight_batch(int worker_id) {
+    auto &in_flight_batch = *m_in_flight_batches[worker_id];
+    if (!in_flight_batch.decode_results.valid()) {
+        return;
+    }
+
+    dorado::stats::Timer timer;
+    auto decode_results = in_flight_batch.decode_results.get();
+    m_decode_wait_ms += timer.GetElapsedMS();
+
+    auto &chunks = in_flight_batch.chunks;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        chunks[i]->seq = std::move(decode_results[i].sequence);
+        chunks[i]->qstring = std::move(decode_results[i].qstring);
+        chunks[i]->moves = std::move(decode_results[i].moves);
+    }
+
+    for (auto &complete_chunk : chunks) {
+        m_processed_chunks.try_push(std::move(complete_chunk));
+    }
+
+    chunks.clear();
 }
 
 void BasecallerNode::working_reads_manager() {
@@ -251,7 +281,6 @@ void BasecallerNode::basecall_worker_thread(int worker_id) {
 
     auto last_chunk_reserve_time = std::chrono::system_clock::now();
     const size_t batch_size = m_model_runners[worker_id]->batch_size();
-    const size_t chunk_size = m_model_runners[worker_id]->chunk_size();
     const int batch_timeout_ms = m_model_runners[worker_id]->batch_timeout_ms();
     const int chunk_queue_idx = worker_id % int(m_chunk_in_queues.size());
     while (true) {
@@ -272,6 +301,8 @@ void BasecallerNode::basecall_worker_thread(int worker_id) {
                 // get scores for whatever chunks are available.
                 basecall_current_batch(worker_id);
             }
+            // No more chunks are arriving, so there's nothing to overlap the decode with.
+            collect_in_flight_batch(worker_id);
 
             last_chunk_reserve_time = std::chrono::system_clock::now();
             continue;
@@ -280,30 +311,13 @@ void BasecallerNode::basecall_worker_thread(int worker_id) {
         // There's chunks to get_scores, so let's add them to our input tensor
         // FIXME -- it should not be possible to for this condition to be untrue.
         if (m_batched_chunks[worker_id].size() != batch_size) {
-            // Copy the chunk into the input tensor
+            // Copy the chunk straight from the read's signal into the input tensor, repeat-padding
+            // any non-full chunks.
             auto &source_read = chunk->owning_read->read;
-
             auto &read_common = get_read_common_data(source_read);
-            auto input_slice = read_common.raw_data.index(
-                    {Ellipsis, Slice(chunk->input_offset, chunk->input_offset + chunk_size)});
-
-            // Make sure the slice tensor is 2D
-            if (input_slice.ndimension() == 1) {
-                input_slice = input_slice.unsqueeze(0);
-            }
-            size_t slice_size = input_slice.size(1);
-
-            // repeat-pad any non-full chunks
-            if (slice_size != chunk_size) {
-                auto [n, overhang] = std::div((int)chunk_size, (int)slice_size);
-                input_slice = at::concat({input_slice.repeat({1, n}),
-                                          input_slice.index({Ellipsis, Slice(0, overhang)})},
-                                         1);
-            }
-
-            // Insert the chunk in the input tensor
             m_model_runners[worker_id]->accept_chunk(
-                    static_cast<int>(m_batched_chunks[worker_id].size()), input_slice);
+                    static_cast<int>(m_batched_chunks[worker_id].size()), read_common.raw_data,
+                    chunk->input_offset);
 
             m_batched_chunks[worker_id].push_back(std::move(chunk));
 
@@ -319,6 +333,7 @@ void BasecallerNode::basecall_worker_thread(int worker_id) {
     if (!m_batched_chunks[worker_id].empty()) {
         basecall_current_batch(worker_id);
     }
+    collect_in_flight_batch(worker_id);
 
     // Reduce the count of active runner threads.  If this was the last active
     // thread also send termination signal to sink
@@ -366,6 +381,9 @@ BasecallerNode::BasecallerNode(std::vector<basecall::RunnerPtr> model_runners,
     // Setup worker state
     const size_t num_workers = m_model_runners.size();
     m_batched_chunks.resize(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        m_in_flight_batches.push_back(std::make_unique<InFlightBatch>());
+    }
 
     for (auto &runner_ptr : m_model_runners) {
         // m_model_runners is effectively a 3D array with dimensions
@@ -436,6 +454,7 @@ stats::NamedStats BasecallerNode::sample_stats() const {
     stats["batches_called"] = double(m_num_batches_called);
     stats["partial_batches_called"] = double(m_num_partial_batches_called);
     stats["call_chunks_ms"] = double(m_call_chunks_ms);
+    stats["decode_wait_ms"] = double(m_decode_wait_ms);
     stats["called_reads_pushed"] = double(m_called_reads_pushed);
     stats["working_reads_items"] = double(m_working_reads_size);
     stats["working_reads_signal_mb"] = double(m_working_reads_signal_bytes) / double((1024 * 1024));
@@ -24,6 +24,7 @@ using RunnerPtr = std::unique_ptr<ModelRunnerBase>;
 class BasecallerNode : public MessageSink {
     struct BasecallingRead;
     struct BasecallingChunk;
+    struct InFlightBatch;
 
 public:
     // Chunk size and overlap are in raw samples
@@ -46,8 +47,10 @@ private:
     void input_thread_fn();
     // Basecall reads
     void basecall_worker_thread(int worker_id);
-    // Basecall batch of chunks
+    // Submit batch of chunks for basecalling
     void basecall_current_batch(int worker_id);
+    // Wait for the submitted batch to be decoded and pass its chunks on for stitching
+    void collect_in_flight_batch(int worker_id);
     // Construct complete reads
     void working_reads_manager();
 
@@ -81,6 +84,8 @@ private:
 
     // If we go multi-threaded, there will be one of these batches per thread
     std::vector<std::vector<std::unique_ptr<BasecallingChunk>>> m_batched_chunks;
+    // Batch submitted by each worker that is still being decoded while the next one is assembled.
+    std::vector<std::unique_ptr<InFlightBatch>> m_in_flight_batches;
 
     utils::AsyncQueue<std::unique_ptr<BasecallingChunk>> m_processed_chunks;
 
@@ -98,6 +103,7 @@ private:
     std::atomic<int64_t> m_num_batches_called = 0;
     std::atomic<int64_t> m_num_partial_batches_called = 0;
     std::atomic<int64_t> m_call_chunks_ms = 0;
+    std::atomic<int64_t> m_decode_wait_ms = 0;
     std::atomic<int64_t> m_called_reads_pushed = 0;
     std::atomic<int64_t> m_working_reads_size = 0;
     std::atomic<int64_t> m_num_bases_processed = 0;
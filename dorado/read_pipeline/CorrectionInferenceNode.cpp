@@ -7,32 +7,35 @@
 #include "correct/windows.h"
 #include "torch_utils/gpu_profiling.h"
 #include "utils/bam_utils.h"
+#include "utils/concurrency/synchronisation.h"
 #include "utils/sequence_utils.h"
 #include "utils/string_utils.h"
 #include "utils/thread_naming.h"
 #include "utils/types.h"
 
+#include <exception>
 #include <stdexcept>
 #include <unordered_set>
 #if DORADO_CUDA_BUILD
 #include "torch_utils/cuda_utils.h"
 #endif
-#include "hts_io/FastxRandomReader.h"
 
 #if DORADO_CUDA_BUILD
 #include <c10/cuda/CUDACachingAllocator.h>
 #include <c10/cuda/CUDAGuard.h>
 #endif
 #include <ATen/Tensor.h>
-#include <htslib/faidx.h>
 #include <htslib/sam.h>
 #include <minimap.h>
 #include <spdlog/spdlog.h>
 #include <torch/script.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -41,6 +44,55 @@ using namespace dorado::correction;
 
 namespace {
 
+// Fewest windows worth handing to another thread, as each window's pileup takes a while to build.
+constexpr size_t MIN_WINDOWS_PER_TASK = 4;
+
+// Calls fn(begin, end) for ranges of the windows [0, num_windows), and returns the results in
+// window order. The windows are split into a range per pool thread, or fewer if there aren't
+// enough windows. The calling thread and tasks on the pool take ranges until there are none left,
+// so the caller only waits for ranges that another thread has already started.
+template <typename Fn>
+auto run_window_tasks(dorado::utils::concurrency::MultiQueueThreadPool::ThreadPoolQueue& queue,
+                      size_t num_threads,
+                      size_t num_windows,
+                      Fn fn) {
+    using Result = decltype(fn(size_t{}, size_t{}));
+    const size_t num_tasks = std::clamp<size_t>(num_windows / MIN_WINDOWS_PER_TASK, 1,
+                                                std::max<size_t>(num_threads, 1));
+    const size_t windows_per_task = (num_windows + num_tasks - 1) / num_tasks;
+    std::vector<Result> results(num_tasks);
+    std::vector<std::exception_ptr> errors(num_tasks);
+    dorado::utils::concurrency::Latch latch(num_tasks);
+
+    // A pool task can start after the caller has returned, so everything it looks at before
+    // finding that there are no ranges left is owned by the task itself.
+    auto next_task = std::make_shared<std::atomic<size_t>>(0);
+    auto run_tasks = [&fn, &results, &errors, &latch, next_task, num_tasks, num_windows,
+                      windows_per_task] {
+        for (size_t task = (*next_task)++; task < num_tasks; task = (*next_task)++) {
+            const size_t begin = std::min(num_windows, task * windows_per_task);
+            const size_t end = std::min(num_windows, begin + windows_per_task);
+            try {
+                results[task] = fn(begin, end);
+            } catch (...) {
+                errors[task] = std::current_exception();
+            }
+            latch.count_down();
+        }
+    };
+    for (size_t task = 1; task < num_tasks; ++task) {
+        queue.push(run_tasks);
+    }
+    run_tasks();
+    latch.wait();
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return results;
+}
+
 dorado::BamPtr create_bam_record(const std::string& read_id, const std::string& seq) {
     bam1_t* rec = bam_init1();
     bam_set1(rec, read_id.length(), read_id.c_str(), 4 /*flag*/, -1 /*tid*/, -1 /*pos*/, 0 /*mapq*/,
@@ -50,30 +102,38 @@ dorado::BamPtr create_bam_record(const std::string& read_id, const std::string&
 }
 
 bool populate_alignments(dorado::CorrectionAlignments& alignments,
-                         dorado::hts_io::FastxRandomReader* reader,
+                         dorado::correction::OverlapReads& reads,
+                         const dorado::correction::ReadStore& read_store,
                          const std::unordered_set<int>& useful_overlap_idxs) {
     const auto& tname = alignments.read_name;
 
-    alignments.read_seq = reader->fetch_seq(tname);
-    alignments.read_qual = reader->fetch_qual(tname);
-    int tlen = (int)alignments.read_seq.length();
+    auto tread = read_store.find(tname);
+    if (!tread) {
+        spdlog::error("Read {} not found", tname);
+        return false;
+    }
+    reads.target = *tread;
+    int tlen = reads.target.length();
 
     // Might be worthwhile generating dense vectors with some index mapping to save memory
     // as using filtering of useful overlaps makes these vectors sparse.
     auto num_qnames = alignments.qnames.size();
-    alignments.seqs.resize(num_qnames);
-    alignments.quals.resize(num_qnames);
+    reads.queries.resize(num_qnames);
     alignments.cigars.resize(num_qnames);
 
     for (const size_t i : useful_overlap_idxs) {
         const std::string& qname = alignments.qnames[i];
-        alignments.seqs[i] = reader->fetch_seq(qname);
-        if ((int)alignments.seqs[i].length() != alignments.overlaps[i].qlen) {
+        auto qread = read_store.find(qname);
+        if (!qread) {
+            spdlog::error("Read {} not found", qname);
+            return false;
+        }
+        reads.queries[i] = *qread;
+        if (qread->length() != alignments.overlaps[i].qlen) {
             spdlog::error("qlen from before {} and qlen from after {} don't match for {}",
-                          alignments.overlaps[i].qlen, alignments.seqs[i].length(), qname);
+                          alignments.overlaps[i].qlen, qread->length(), qname);
             return false;
         }
-        alignments.quals[i] = reader->fetch_qual(qname);
         if (alignments.overlaps[i].tlen != tlen) {
             spdlog::error("tlen from before {} and tlen from after {} don't match for {}",
                           alignments.overlaps[i].tlen, tlen, tname);
@@ -145,13 +205,15 @@ void CorrectionInferenceNode::decode_fn() {
             }
             auto& output_features = find_iter->second;
             output_features[pos] = std::move(corrected_seq);
-            auto& pending = m_pending_features_by_id.find(read_name)->second;
-            pending--;
-            if (pending == 0) {
+            auto pending_iter = m_pending_features_by_id.find(read_name);
+            auto& pending = pending_iter->second;
+            pending.num_windows--;
+            if (pending.num_windows == 0) {
                 // Got all features!
                 to_decode = std::move(output_features);
+                m_read_latency.add(std::chrono::steady_clock::now() - pending.start_time);
                 m_features_by_id.erase(read_name);
-                m_pending_features_by_id.erase(read_name);
+                m_pending_features_by_id.erase(pending_iter);
             }
         }
 
@@ -190,8 +252,8 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
     }
     module.eval();
 
-    std::vector<at::Tensor> bases_batch;
-    std::vector<at::Tensor> quals_batch;
+    // Pinned buffers speed up the copies to the GPU.
+    FeatureBatch feature_batch(device.is_cuda());
     std::vector<int> lengths;
     std::vector<int64_t> sizes;
     std::vector<at::Tensor> indices_batch;
@@ -216,8 +278,7 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
         auto length_tensor =
                 at::from_blob(lengths.data(), {(int)lengths.size()},
                               at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU));
-        const at::Tensor batched_bases = collate<int>(bases_batch, (int)11, torch::kInt32);
-        const at::Tensor batched_quals = collate<float>(quals_batch, 0.f, torch::kFloat32);
+        const auto [batched_bases, batched_quals] = feature_batch.collate(wfs);
 
         std::unique_lock<std::mutex> lock(m_gpu_mutexes[mtx_idx]);
         std::vector<torch::jit::IValue> inputs;
@@ -259,8 +320,6 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
             m_inferred_features_queue.try_push(std::move(wf));
         }
 
-        bases_batch.clear();
-        quals_batch.clear();
         lengths.clear();
         sizes.clear();
         wfs.clear();
@@ -280,7 +339,7 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
 
         if (pop_status == utils::AsyncQueueStatus::Timeout) {
             // Ended with a timeout, so run inference if there are samples.
-            if (bases_batch.size() > 0) {
+            if (!wfs.empty()) {
                 batch_infer();
             }
             last_chunk_reserve_time = std::chrono::system_clock::now();
@@ -295,11 +354,6 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
         wfs.push_back(std::move(item));
         auto& wf = wfs.back();
 
-        auto b = wf.bases.transpose(0, 1);
-        auto q = wf.quals.transpose(0, 1);
-
-        bases_batch.push_back(b);
-        quals_batch.push_back(q);
         lengths.push_back(wf.length);
         sizes.push_back(wf.length);
         indices_batch.push_back(wf.indices);
@@ -307,7 +361,7 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
         last_chunk_reserve_time = std::chrono::system_clock::now();
     }
 
-    if (bases_batch.size() > 0) {
+    if (!wfs.empty()) {
         batch_infer();
     }
 
@@ -318,18 +372,13 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
 }
 
 void CorrectionInferenceNode::input_thread_fn() {
-    auto thread_id = m_num_active_feature_threads++;
-
-    auto fastx_reader = std::make_unique<hts_io::FastxRandomReader>(m_fastq);
-
-    if (thread_id == 0) {
-        total_reads_in_input = fastx_reader->num_entries();
-    }
+    m_num_active_feature_threads++;
 
     Message message;
     while (get_input_message(message)) {
         if (std::holds_alternative<CorrectionAlignments>(message)) {
             utils::ScopedProfileRange spr("input_loop", 1);
+            const auto start_time = std::chrono::steady_clock::now();
 
             auto alignments = std::get<CorrectionAlignments>(std::move(message));
             auto tname = alignments.read_name;
@@ -347,19 +396,40 @@ void CorrectionInferenceNode::input_thread_fn() {
                 continue;
             }
 
-            // Filter the window features and get the set of unique overlaps
-            const std::unordered_set<int> overlap_idxs = filter_features(windows, alignments);
+            // Filter the window features and get the set of unique overlaps. Reads with many
+            // windows are split over the window pool, so they don't hold up the other reads.
+            auto filtered_idxs = run_window_tasks(
+                    m_window_queue, m_num_window_threads, n_windows,
+                    [&windows, &alignments](size_t begin, size_t end) {
+                        return filter_features(windows, alignments, begin, end);
+                    });
+            std::unordered_set<int> overlap_idxs;
+            for (auto& idxs : filtered_idxs) {
+                overlap_idxs.merge(idxs);
+            }
             if (overlap_idxs.empty()) {
                 continue;
             }
 
+            // Views into the read store, which outlives them.
+            correction::OverlapReads reads;
             // Populate the alignment data with only the records that are useful after TOP_K filter
-            if (!populate_alignments(alignments, fastx_reader.get(), overlap_idxs)) {
+            if (!populate_alignments(alignments, reads, *m_read_store, overlap_idxs)) {
                 continue;
             }
 
             // Get the filtered features
-            auto wfs = extract_features(windows, alignments, m_window_size);
+            auto extracted_wfs = run_window_tasks(
+                    m_window_queue, m_num_window_threads, n_windows,
+                    [this, &windows, &alignments, &reads](size_t begin, size_t end) {
+                        return extract_features(windows, alignments, reads, m_window_size, begin,
+                                                end);
+                    });
+            std::vector<WindowFeatures> wfs;
+            wfs.reserve(n_windows);
+            for (auto& range_wfs : extracted_wfs) {
+                std::move(range_wfs.begin(), range_wfs.end(), std::back_inserter(wfs));
+            }
 
             std::vector<std::string> corrected_seqs;
             corrected_seqs.resize(wfs.size());
@@ -374,14 +444,17 @@ void CorrectionInferenceNode::input_thread_fn() {
                     corrected_seqs[w] = decode_window(wfs[w]);
                 }
             }
+            m_feature_latency.add(std::chrono::steady_clock::now() - start_time);
             if (features_to_infer.empty()) {
                 num_early_reads++;
                 concat_features_and_send(corrected_seqs, tname);
+                m_read_latency.add(std::chrono::steady_clock::now() - start_time);
             } else {
                 std::lock_guard<std::mutex> lock(m_features_mutex);
                 if (m_features_by_id.find(tname) == m_features_by_id.end()) {
                     m_features_by_id.insert({tname, std::move(corrected_seqs)});
-                    m_pending_features_by_id.insert({tname, (int)features_to_infer.size()});
+                    m_pending_features_by_id.insert(
+                            {tname, PendingRead{(int)features_to_infer.size(), start_time}});
                 } else {
                     spdlog::error("Features for {} already exist! Skipping.", tname);
                     continue;
@@ -416,15 +489,22 @@ CorrectionInferenceNode::CorrectionInferenceNode(const std::string& fastq,
                                                  const std::string& device,
                                                  int infer_threads,
                                                  const int batch_size,
-                                                 const std::filesystem::path& model_dir)
+                                                 const std::filesystem::path& model_dir,
+                                                 const std::filesystem::path& temp_dir)
         : MessageSink(1000, threads),
           m_fastq(fastq),
+          m_read_store(std::make_unique<correction::ReadStore>(fastq, threads, temp_dir)),
+          m_window_pool(std::make_unique<utils::concurrency::MultiQueueThreadPool>(
+                  threads,
+                  "corr_windows")),
+          m_num_window_threads(threads),
+          m_window_queue(
+                  m_window_pool->create_task_queue(utils::concurrency::TaskPriority::normal)),
           m_model_config(parse_model_config(model_dir / "config.toml")),
           m_features_queue(1000),
-          m_inferred_features_queue(500),
-          m_bases_manager(batch_size),
-          m_quals_manager(batch_size) {
+          m_inferred_features_queue(500) {
     m_window_size = m_model_config.window_size;
+    total_reads_in_input = static_cast<int>(m_read_store->num_reads());
 
     std::vector<std::string> devices;
     if (device == "cpu") {
@@ -463,17 +543,6 @@ CorrectionInferenceNode::CorrectionInferenceNode(const std::string& fastq,
     for (int i = 0; i < 4; i++) {
         m_decode_threads.push_back(std::thread(&CorrectionInferenceNode::decode_fn, this));
     }
-    // Create index for fastq file.
-    char* idx_name = fai_path(fastq.c_str());
-    spdlog::debug("Looking for idx {}", idx_name);
-    if (idx_name && !std::filesystem::exists(idx_name)) {
-        if (fai_build(fastq.c_str()) != 0) {
-            spdlog::error("Failed to build index for file {}", fastq);
-            throw std::runtime_error{"Failed to build index for file " + fastq + "."};
-        }
-        spdlog::debug("Created fastq index.");
-    }
-    hts_free(idx_name);
 }
 
 void CorrectionInferenceNode::terminate(const FlushOptions&) {
@@ -492,6 +561,8 @@ stats::NamedStats CorrectionInferenceNode::sample_stats() const {
     stats::NamedStats stats = stats::from_obj(m_work_queue);
     stats["num_reads_corrected"] = double(num_reads.load());
     stats["total_reads_in_input"] = total_reads_in_input;
+    m_feature_latency.report(stats, "feature_latency");
+    m_read_latency.report(stats, "read_latency");
     return stats;
 }
 
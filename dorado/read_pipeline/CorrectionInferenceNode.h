@@ -1,10 +1,11 @@
 #pragma once
 
+#include "correct/read_store.h"
 #include "correct/types.h"
-#include "hts_io/FastxRandomReader.h"
 #include "read_pipeline/MessageSink.h"
 #include "read_pipeline/messages.h"
 #include "utils/AsyncQueue.h"
+#include "utils/concurrency/multi_queue_thread_pool.h"
 #include "utils/stats.h"
 #include "utils/types.h"
 
@@ -15,7 +16,6 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <vector>
@@ -29,7 +29,8 @@ public:
                             const std::string& device,
                             int infer_threads,
                             int bach_size,
-                            const std::filesystem::path& model_dir);
+                            const std::filesystem::path& model_dir,
+                            const std::filesystem::path& temp_dir);
     ~CorrectionInferenceNode() { stop_input_processing(); }
     std::string get_name() const override { return "CorrectionInferenceNode"; }
     stats::NamedStats sample_stats() const override;
@@ -40,6 +41,14 @@ public:
 
 private:
     const std::string m_fastq;
+    // Built once from the input reads and shared by the input threads.
+    std::unique_ptr<correction::ReadStore> m_read_store;
+    // Runs ranges of the windows of each read, so reads with many windows are spread over
+    // several threads.
+    std::unique_ptr<utils::concurrency::MultiQueueThreadPool> m_window_pool;
+    const size_t m_num_window_threads;
+    // Shared by the input threads, and made once, as the pool keeps every queue it makes.
+    utils::concurrency::MultiQueueThreadPool::ThreadPoolQueue& m_window_queue;
     correction::ModelConfig m_model_config;
     void input_thread_fn();
     int m_window_size;
@@ -62,56 +71,21 @@ private:
     int total_reads_in_input{0};
 
     std::unordered_map<std::string, std::vector<std::string>> m_features_by_id;
-    std::unordered_map<std::string, int> m_pending_features_by_id;
+    struct PendingRead {
+        int num_windows;
+        std::chrono::steady_clock::time_point start_time;
+    };
+    std::unordered_map<std::string, PendingRead> m_pending_features_by_id;
     std::mutex m_features_mutex;
 
     std::atomic<int> m_num_active_feature_threads{0};
     std::atomic<int> m_num_active_infer_threads{0};
 
-    std::array<std::mutex, 32> m_gpu_mutexes;
+    // Time taken to extract the features of a read, and to correct it.
+    stats::LatencyHistogram m_feature_latency;
+    stats::LatencyHistogram m_read_latency;
 
-    // Class to pre-allocate memory and generate tensors from it.
-    template <typename T>
-    class MemoryManager {
-    public:
-        MemoryManager(int batch_size) {
-            const size_t num_tensors = 8 * 8;  // devices * threads per device;
-            size_t tensor_size = WS * NR * batch_size;
-            m_bases_ptr = std::make_unique<T[]>(tensor_size * num_tensors);
-
-            for (size_t i = 0; i < num_tensors; i++) {
-                m_bases_locations.push(&m_bases_ptr.get()[i * tensor_size]);
-            }
-        };
-
-        ~MemoryManager() = default;
-
-        T* get_next_ptr() {
-            std::lock_guard<std::mutex> lock(m_bases_mtx);
-            if (m_bases_locations.size() == 0) {
-                throw std::runtime_error("No more pointers left!");
-            }
-            auto next_ptr = m_bases_locations.front();
-            m_bases_locations.pop();
-            return next_ptr;
-        }
-
-        void return_ptr(T* ptr) {
-            std::lock_guard<std::mutex> lock(m_bases_mtx);
-            m_bases_locations.push(ptr);
-        }
-
-    private:
-        static constexpr int WS = 5120;
-        static constexpr int NR = 31;
-
-        std::unique_ptr<T[]> m_bases_ptr;
-        std::queue<T*> m_bases_locations;
-        std::mutex m_bases_mtx;
-    };
-
-    MemoryManager<int> m_bases_manager;
-    MemoryManager<float> m_quals_manager;
+    std::array<std::mutex, 32> m_gpu_mutexes;
 };
 
 }  // namespace dorado
@@ -10,6 +10,7 @@
 #include "alignment/minimap2_wrappers.h"
 #include "utils/PostCondition.h"
 #include "utils/alignment_utils.h"
+#include "utils/bam_pool.h"
 #include "utils/bam_utils.h"
 #include "utils/thread_naming.h"
 
@@ -18,8 +19,10 @@
 #include <minimap.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <cassert>
 #include <filesystem>
+#include <string_view>
 
 namespace dorado {
 
@@ -27,6 +30,8 @@ void CorrectionMapperNode::extract_alignments(const mm_reg1_t* reg,
                                               int hits,
                                               const std::string& qread,
                                               const std::string& qname) {
+    // Targets this query has already been aligned to.
+    std::vector<int> processed_targets;
     for (int j = 0; j < hits; j++) {
         // mapping region
         auto aln = &reg[j];
@@ -36,37 +41,21 @@ void CorrectionMapperNode::extract_alignments(const mm_reg1_t* reg,
         }
 
         const auto& ref = m_index->index()->seq[aln->rid];
-        const std::string tname(ref.name);
+        const std::string_view tname(ref.name);
 
         // Skip self alignment.
         if (qname == tname) {
             continue;
         }
 
-        std::unique_lock<std::mutex> lock(m_correction_mtx);
-        if (m_read_mutex.find(tname) == m_read_mutex.end()) {
-            m_read_mutex.emplace(tname, std::make_unique<std::mutex>());
-            CorrectionAlignments new_aln;
-            new_aln.read_name = tname;
-            m_correction_records.emplace(tname, std::move(new_aln));
-            m_processed_queries_per_target.emplace(tname, std::unordered_set<std::string>());
-        }
-        auto& mtx = *m_read_mutex[tname];
-        auto& processed_queries = m_processed_queries_per_target[tname];
-        auto& alignments = m_correction_records[tname];
-        lock.unlock();
-
-        {
-            std::lock_guard<std::mutex> aln_lock(mtx);
-            if (processed_queries.find(qname) != processed_queries.end()) {
-                // Query/target pair has been processed before. Assume that
-                // the first one processed is the best one, and ignore
-                // the rest.
-                continue;
-            } else {
-                processed_queries.insert(qname);
-            }
+        if (std::find(processed_targets.begin(), processed_targets.end(), aln->rid) !=
+            processed_targets.end()) {
+            // Query/target pair has been processed before. Assume that
+            // the first one processed is the best one, and ignore
+            // the rest.
+            continue;
         }
+        processed_targets.push_back(aln->rid);
 
         utils::Overlap ovlp;
         ovlp.qstart = aln->qs;
@@ -95,16 +84,8 @@ void CorrectionMapperNode::extract_alignments(const mm_reg1_t* reg,
             continue;
         }
 
-        // Non-const because it will be moved below.
-        std::vector<CigarOp> cigar = convert_mm2_cigar(aln->p->cigar, aln->p->n_cigar);
-
-        {
-            std::lock_guard<std::mutex> aln_lock(mtx);
-
-            alignments.qnames.push_back(qname);
-            alignments.cigars.push_back(std::move(cigar));
-            alignments.overlaps.push_back(std::move(ovlp));
-        }
+        const std::vector<CigarOp> cigar = convert_mm2_cigar(aln->p->cigar, aln->p->n_cigar);
+        m_alignment_spool->add(aln->rid, qname, ovlp, cigar);
     }
 }
 
@@ -122,13 +103,10 @@ void CorrectionMapperNode::input_thread_fn() {
         m_alignments_processed++;
         // TODO: Remove and move to ProgressTracker
         if (m_alignments_processed.load() % 10000 == 0) {
-            std::unique_lock<std::mutex> lock(m_correction_mtx);
-            size_t total = 0;
-            for (auto& [_, r] : m_correction_records) {
-                total += r.size();
-            }
-            spdlog::debug("Alignments processed {}, total m_corrected_records size {} MB",
-                          m_alignments_processed.load(), (float)total / (1024 * 1024));
+            spdlog::debug("Alignments processed {}, alignments in memory {} MB, spilled {} MB",
+                          m_alignments_processed.load(),
+                          (float)m_alignment_spool->memory_size() / (1024 * 1024),
+                          (float)m_alignment_spool->spilled_size() / (1024 * 1024));
         }
 
         for (int j = 0; j < hits; j++) {
@@ -141,8 +119,9 @@ void CorrectionMapperNode::input_thread_fn() {
 void CorrectionMapperNode::load_read_fn() {
     utils::set_thread_name("errcorr_load");
     HtsReader reader(m_index_file, {});
+    reader.set_num_threads(m_reader_threads);
     while (reader.read()) {
-        m_reads_queue.try_push(BamPtr(bam_dup1(reader.record.get())));
+        m_reads_queue.try_push(utils::duplicate_bam(reader.record.get()));
         m_reads_read++;
         // TODO: Remove and move to ProgressTracker
         if (m_reads_read.load() % 10000 == 0) {
@@ -156,29 +135,39 @@ void CorrectionMapperNode::send_data_fn(Pipeline& pipeline) {
     while (true) {
         std::unique_lock<std::mutex> lock(m_copy_mtx);
         m_copy_cv.wait(lock, [&] {
-            return (!m_shadow_correction_records.empty() || m_copy_terminate.load());
+            return (!m_shadow_alignment_spools.empty() || m_copy_terminate.load());
         });
 
-        if (m_shadow_correction_records.empty() && m_copy_terminate.load()) {
+        if (m_shadow_alignment_spools.empty() && m_copy_terminate.load()) {
             break;
         }
 
-        for (auto& shadow_data : m_shadow_correction_records) {
-            spdlog::debug("Pushing {} records downstream of mapping.", shadow_data.size());
+        for (auto& spool : m_shadow_alignment_spools) {
+            spdlog::debug("Pushing records for {} targets downstream of mapping.",
+                          spool->num_targets());
             int64_t num_pushed{0};
-            for (auto& [tname, r] : shadow_data) {
+            // Targets are read back one at a time, in index order, so only the alignments
+            // waiting in the pipeline are held in memory.
+            for (size_t target = 0; target < spool->num_targets(); ++target) {
+                if (spool->num_alignments(target) == 0) {
+                    continue;
+                }
+                const auto& tname = spool->target_name(target);
                 // Skip reads which were already processed.
                 if (m_skip_set.count(tname) > 0) {
                     spdlog::trace("Resuming in mapping: skipping read '{}'.", tname);
                     continue;
                 }
-                pipeline.push_message(std::move(r));
+                CorrectionAlignments alignments;
+                alignments.read_name = tname;
+                spool->take(target, alignments.qnames, alignments.cigars, alignments.overlaps);
+                pipeline.push_message(std::move(alignments));
                 ++num_pushed;
             }
             m_reads_to_infer.fetch_add(num_pushed);
             spdlog::debug("Pushed {} non-skipped records for correction.", num_pushed);
         }
-        m_shadow_correction_records.clear();
+        m_shadow_alignment_spools.clear();
     }
 }
 
@@ -228,8 +217,17 @@ void CorrectionMapperNode::process(Pipeline& pipeline) {
         m_alignments_processed.store(0);
         m_reads_queue.restart();
 
-        // Create aligner.
+        // Create aligner, and the spool for the alignments to this index chunk.
         m_aligner = std::make_unique<alignment::Minimap2Aligner>(m_index);
+        std::vector<std::string> target_names;
+        target_names.reserve(m_index->index()->n_seq);
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_index->index()->n_seq); ++i) {
+            target_names.emplace_back(m_index->index()->seq[i].name);
+        }
+        // The spool of the previous chunk is still being sent downstream while this one fills,
+        // so each gets half of the memory.
+        m_alignment_spool = std::make_unique<correction::AlignmentSpool>(
+                std::move(target_names), m_alignment_memory / 2, m_temp_dir);
         // 1. Start thread for generating reads.
         reader_thread = std::thread(&CorrectionMapperNode::load_read_fn, this);
         // 2. Start threads for aligning reads.
@@ -251,13 +249,10 @@ void CorrectionMapperNode::process(Pipeline& pipeline) {
             // Only copy when the thread sending alignments to downstream pipeline
             // is done.
             std::unique_lock<std::mutex> lock(m_copy_mtx);
-            m_shadow_correction_records.emplace_back(std::move(m_correction_records));
+            m_shadow_alignment_spools.emplace_back(std::move(m_alignment_spool));
         }
         m_copy_cv.notify_one();
 
-        m_correction_records = {};
-        m_read_mutex.clear();
-        m_processed_queries_per_target.clear();
         // 4. Load next index and loop
         m_current_index++;
     } while (m_index->load_next_chunk(m_num_threads) != alignment::IndexLoadResult::end_of_index);
@@ -271,12 +266,18 @@ void CorrectionMapperNode::process(Pipeline& pipeline) {
 
 CorrectionMapperNode::CorrectionMapperNode(const std::string& index_file,
                                            int threads,
+                                           int reader_threads,
                                            uint64_t index_size,
+                                           uint64_t alignment_memory,
+                                           std::filesystem::path temp_dir,
                                            std::string furthest_skip_header,
                                            std::unordered_set<std::string> skip_set)
         : MessageSink(10000, threads),
           m_index_file(index_file),
           m_num_threads(threads),
+          m_reader_threads(reader_threads),
+          m_alignment_memory(alignment_memory),
+          m_temp_dir(std::move(temp_dir)),
           m_reads_queue(5000),
           m_furthest_skip_header{std::move(furthest_skip_header)},
           m_skip_set{std::move(skip_set)} {
@@ -4,6 +4,7 @@
 #include "alignment/Minimap2Aligner.h"
 #include "alignment/Minimap2Index.h"
 #include "alignment/Minimap2IndexSupportTypes.h"
+#include "correct/alignment_spool.h"
 #include "read_pipeline/MessageSink.h"
 #include "read_pipeline/messages.h"
 #include "utils/AsyncQueue.h"
@@ -15,11 +16,11 @@
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
-#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -29,7 +30,10 @@ class CorrectionMapperNode : public MessageSink {
 public:
     CorrectionMapperNode(const std::string& index_file,
                          int threads,
+                         int reader_threads,
                          uint64_t index_size,
+                         uint64_t alignment_memory,
+                         std::filesystem::path temp_dir,
                          std::string furthest_skip_header,
                          std::unordered_set<std::string> skip_set);
     ~CorrectionMapperNode() = default;
@@ -43,6 +47,9 @@ public:
 private:
     std::string m_index_file;
     int m_num_threads;
+    int m_reader_threads;
+    uint64_t m_alignment_memory;
+    std::filesystem::path m_temp_dir;
 
     std::unique_ptr<alignment::Minimap2Aligner> m_aligner;
     std::shared_ptr<alignment::Minimap2Index> m_index;
@@ -59,17 +66,12 @@ private:
     // Queue for reads being aligned.
     utils::AsyncQueue<BamPtr> m_reads_queue;
 
-    // Map to collects alignments by target id.
-    std::mutex m_correction_mtx;
-    std::unordered_map<std::string, CorrectionAlignments> m_correction_records;
-    std::unordered_map<std::string, std::unordered_set<std::string>> m_processed_queries_per_target;
+    // Collects the alignments to the reads in the current index chunk.
+    std::unique_ptr<correction::AlignmentSpool> m_alignment_spool;
 
     std::mutex m_copy_mtx;
     std::condition_variable m_copy_cv;
-    std::vector<std::unordered_map<std::string, CorrectionAlignments>> m_shadow_correction_records;
-
-    // Mutex per target id to prevent a global lock across all targets.
-    std::unordered_map<std::string, std::unique_ptr<std::mutex>> m_read_mutex;
+    std::vector<std::unique_ptr<correction::AlignmentSpool>> m_shadow_alignment_spools;
 
     int m_index_seqs{0};
     int m_current_index{0};
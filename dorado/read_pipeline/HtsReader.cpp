@@ -3,6 +3,9 @@
 #include "read_pipeline/DefaultClientInfo.h"
 #include "read_pipeline/ReadPipeline.h"
 #include "read_pipeline/messages.h"
+#include "utils/AsyncQueue.h"
+#include "utils/PostCondition.h"
+#include "utils/bam_pool.h"
 #include "utils/bam_utils.h"
 #include "utils/fastq_reader.h"
 #include "utils/types.h"
@@ -10,6 +13,7 @@
 #include <htslib/sam.h>
 #include <spdlog/spdlog.h>
 
+#include <exception>
 #include <filesystem>
 #include <functional>
 #include <memory>
@@ -17,6 +21,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -26,6 +31,12 @@ namespace {
 
 const std::string HTS_FORMAT_TEXT_FASTQ{"FASTQ sequence text"};
 
+// Records are handed from the prefetch thread to the pipeline in batches, to amortise
+// the cost of the handover.
+constexpr std::size_t PREFETCH_BATCH_SIZE = 256;
+constexpr std::size_t PREFETCH_QUEUE_SIZE = 16;
+using PrefetchQueue = utils::AsyncQueue<std::vector<BamPtr>>;
+
 void write_bam_aux_tag_from_string(bam1_t& record, const std::string& bam_tag_string) {
     // Format TAG:TYPE:VALUE where TAG is a 2 char string, TYPE is a single char, and value
     std::istringstream tag_stream{bam_tag_string};
@@ -103,6 +114,9 @@ public:
 
     const std::string& format() const { return HTS_FORMAT_TEXT_FASTQ; }
 
+    // The FASTQ reader decompresses on the calling thread.
+    void set_num_threads(int) {}
+
     bool try_get_next_record(bam1_t& record) {
         auto fastq_record = m_fastq_reader.try_get_next_record();
         if (!fastq_record) {
@@ -141,11 +155,52 @@ public:
     sam_hdr_t* header() const { return m_header.get(); }
     const std::string& format() const { return m_format; }
 
+    void set_num_threads(int threads) {
+        if (hts_set_threads(m_file.get(), threads) < 0) {
+            throw std::runtime_error("Could not enable multi threading for reading.");
+        }
+    }
+
     bool try_get_next_record(bam1_t& record) {
         return sam_read1(m_file.get(), m_header.get(), &record) >= 0;
     }
 };
 
+// Reads records into batches until the input or max_reads is exhausted, dropping any
+// which aren't in the read list. The queue is terminated on return.
+void prefetch_records(const std::function<bool(bam1_t&)>& bam_record_generator,
+                      const std::optional<std::unordered_set<std::string>>& read_list,
+                      std::size_t max_reads,
+                      PrefetchQueue& prefetch_queue) {
+    auto on_return = utils::PostCondition([&prefetch_queue] { prefetch_queue.terminate(); });
+
+    std::size_t num_reads = 0;
+    std::vector<BamPtr> batch;
+    batch.reserve(PREFETCH_BATCH_SIZE);
+    auto record = utils::acquire_bam();
+    while ((max_reads == 0 || num_reads < max_reads) && bam_record_generator(*record)) {
+        if (read_list) {
+            std::string read_id = bam_get_qname(record.get());
+            if (read_list->find(read_id) == read_list->end()) {
+                continue;
+            }
+        }
+        batch.push_back(std::move(record));
+        record = utils::acquire_bam();
+        ++num_reads;
+        if (batch.size() == PREFETCH_BATCH_SIZE) {
+            if (prefetch_queue.try_push(std::move(batch)) != utils::AsyncQueueStatus::Success) {
+                return;
+            }
+            batch.clear();
+            batch.reserve(PREFETCH_BATCH_SIZE);
+        }
+    }
+    if (!batch.empty()) {
+        prefetch_queue.try_push(std::move(batch));
+    }
+}
+
 }  // namespace
 
 HtsReader::HtsReader(const std::string& filename,
@@ -157,7 +212,7 @@ HtsReader::HtsReader(const std::string& filename,
     }
     is_aligned = m_header->n_targets > 0;
 
-    record.reset(bam_init1());
+    record = utils::acquire_bam();
 }
 
 template <typename T>
@@ -168,12 +223,19 @@ bool HtsReader::try_initialise_generator(const std::string& filename) {
     }
     m_header = generator->header();
     m_format = generator->format();
+    m_set_generator_threads = [generator](int threads) { generator->set_num_threads(threads); };
     m_bam_record_generator = [generator_ = std::move(generator)](bam1_t& bam_record) {
         return generator_->try_get_next_record(bam_record);
     };
     return true;
 }
 
+void HtsReader::set_num_threads(std::size_t threads) {
+    if (threads > 0) {
+        m_set_generator_threads(static_cast<int>(threads));
+    }
+}
+
 void HtsReader::set_client_info(std::shared_ptr<ClientInfo> client_info) {
     m_client_info = std::move(client_info);
 }
@@ -190,27 +252,46 @@ bool HtsReader::has_tag(const char* tagname) {
 }
 
 std::size_t HtsReader::read(Pipeline& pipeline, std::size_t max_reads) {
-    std::size_t num_reads = 0;
-    while (this->read()) {
-        if (m_read_list) {
-            std::string read_id = bam_get_qname(record.get());
-            if (m_read_list->find(read_id) == m_read_list->end()) {
-                continue;
-            }
+    // Reading, decoding and filtering happen on the prefetch thread, so the pipeline is
+    // being fed while the next records are read.
+    PrefetchQueue prefetch_queue(PREFETCH_QUEUE_SIZE);
+    std::exception_ptr prefetch_error;
+    std::thread prefetch_thread([&] {
+        try {
+            prefetch_records(m_bam_record_generator, m_read_list, max_reads, prefetch_queue);
+        } catch (...) {
+            prefetch_error = std::current_exception();
         }
-        if (m_record_mutator) {
-            m_record_mutator(record);
+    });
+    auto join_prefetch_thread = utils::PostCondition([&] {
+        // Stops the prefetch thread early if we're returning due to an error.
+        if (prefetch_thread.joinable()) {
+            prefetch_queue.terminate();
+            prefetch_thread.join();
         }
+    });
 
-        BamMessage bam_message{BamPtr(bam_dup1(record.get())), m_client_info};
-        pipeline.push_message(std::move(bam_message));
-        ++num_reads;
-        if (max_reads > 0 && num_reads >= max_reads) {
-            break;
-        }
-        if (num_reads % 50000 == 0) {
-            spdlog::debug("Processed {} reads", num_reads);
+    std::size_t num_reads = 0;
+    std::vector<BamPtr> batch;
+    std::vector<Message> messages;
+    while (prefetch_queue.try_pop(batch) == utils::AsyncQueueStatus::Success) {
+        messages.reserve(batch.size());
+        for (auto& prefetched_record : batch) {
+            if (m_record_mutator) {
+                m_record_mutator(prefetched_record);
+            }
+            messages.emplace_back(BamMessage{std::move(prefetched_record), m_client_info});
+            ++num_reads;
+            if (num_reads % 50000 == 0) {
+                spdlog::debug("Processed {} reads", num_reads);
+            }
         }
+        pipeline.push_messages(std::move(messages));
+    }
+
+    prefetch_thread.join();
+    if (prefetch_error) {
+        std::rethrow_exception(prefetch_error);
     }
     spdlog::debug("Total reads processed: {}", num_reads);
     return num_reads;
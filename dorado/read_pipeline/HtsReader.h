@@ -27,8 +27,13 @@ public:
               std::optional<std::unordered_set<std::string>> read_list);
     bool read();
 
+    // Decompress the input with this many additional threads. Has no effect for inputs that
+    // aren't BGZF compressed, and must be called before any records are read.
+    void set_num_threads(std::size_t threads);
+
     // If reading directly into a pipeline need to set the client info on the messages
     void set_client_info(std::shared_ptr<ClientInfo> client_info);
+    // Records are read and filtered on a prefetch thread, and pushed to the pipeline in batches.
     std::size_t read(Pipeline& pipeline, std::size_t max_reads);
     template <typename T>
     T get_tag(const char* tagname);
@@ -51,6 +56,7 @@ private:
     std::optional<std::unordered_set<std::string>> m_read_list;
 
     std::function<bool(bam1_t&)> m_bam_record_generator{};
+    std::function<void(int)> m_set_generator_threads{};
 
     template <typename T>
     bool try_initialise_generator(const std::string& filename);
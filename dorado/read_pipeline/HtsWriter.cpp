@@ -1,5 +1,6 @@
 #include "HtsWriter.h"
 
+#include "read_pipeline/ClientInfo.h"
 #include "read_pipeline/ReadPipeline.h"
 #include "utils/sequence_utils.h"
 
@@ -12,13 +13,34 @@
 #include <cassert>
 #include <filesystem>
 #include <stdexcept>
+#include <vector>
 
 namespace dorado {
 
 using OutputMode = dorado::utils::HtsFile::OutputMode;
 
+void HtsWriterOutput::remove_pending() {
+    if (m_pending.fetch_sub(1) == 1) {
+        // Taking the lock means a waiter is either not yet checking the count or already waiting.
+        std::lock_guard lock(m_pending_mutex);
+        m_pending_cv.notify_all();
+    }
+}
+
+void HtsWriterOutput::wait_until_written() {
+    std::unique_lock lock(m_pending_mutex);
+    m_pending_cv.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
 HtsWriter::HtsWriter(utils::HtsFile& file, std::string gpu_names)
-        : MessageSink(10000, 1), m_file(file), m_gpu_names(std::move(gpu_names)) {
+        : MessageSink(10000, 1), m_file(&file), m_gpu_names(std::move(gpu_names)) {
+    if (!m_gpu_names.empty()) {
+        m_gpu_names = "gpu:" + m_gpu_names;
+    }
+}
+
+HtsWriter::HtsWriter(std::string gpu_names)
+        : MessageSink(10000, 1), m_file(nullptr), m_gpu_names(std::move(gpu_names)) {
     if (!m_gpu_names.empty()) {
         m_gpu_names = "gpu:" + m_gpu_names;
     }
@@ -38,60 +60,91 @@ OutputMode HtsWriter::get_output_mode(const std::string& mode) {
 }
 
 void HtsWriter::input_thread_fn() {
-    Message message;
-    while (get_input_message(message)) {
-        if (!std::holds_alternative<BamMessage>(message)) {
-            continue;
-        }
+    // Records are popped in groups so the input queue is locked once per group rather than
+    // once per record.
+    constexpr size_t kMaxMessagesPerGroup = 64;
+    std::vector<Message> messages;
+    while (get_input_messages(messages, kMaxMessagesPerGroup)) {
+        for (auto& message : messages) {
+            if (!std::holds_alternative<BamMessage>(message)) {
+                continue;
+            }
 
-        auto bam_message = std::move(std::get<BamMessage>(message));
-        BamPtr aln = std::move(bam_message.bam_ptr);
+            auto bam_message = std::move(std::get<BamMessage>(message));
+            BamPtr aln = std::move(bam_message.bam_ptr);
 
-        if (m_file.get_output_mode() == utils::HtsFile::OutputMode::FASTQ) {
-            if (!m_gpu_names.empty()) {
-                bam_aux_append(aln.get(), "DS", 'Z', int(m_gpu_names.length() + 1),
-                               (uint8_t*)m_gpu_names.c_str());
+            // The client's own output takes precedence over the writer's file.
+            auto output = bam_message.client_info
+                                  ? bam_message.client_info->contexts().get_ptr<HtsWriterOutput>()
+                                  : nullptr;
+            if (!output && !m_file) {
+                throw std::runtime_error("No output file for SAM record.");
             }
-        }
+            auto& file = output ? output->file : *m_file;
 
-        auto res = write(aln.get());
-        if (res < 0) {
-            throw std::runtime_error("Failed to write SAM record, error code " +
-                                     std::to_string(res));
-        }
+            if (file.get_output_mode() == utils::HtsFile::OutputMode::FASTQ) {
+                if (!m_gpu_names.empty()) {
+                    bam_aux_append(aln.get(), "DS", 'Z', int(m_gpu_names.length() + 1),
+                                   (uint8_t*)m_gpu_names.c_str());
+                }
+            }
 
-        // For the purpose of estimating write count, we ignore duplex reads
-        int64_t dx_tag = 0;
-        auto tag_str = bam_aux_get(aln.get(), "dx");
-        if (tag_str) {
-            dx_tag = bam_aux2i(tag_str);
-        }
+            auto res = write(file, aln.get());
+            if (res < 0) {
+                throw std::runtime_error("Failed to write SAM record, error code " +
+                                         std::to_string(res));
+            }
+            if (output) {
+                const auto flag = aln->core.flag;
+                output->total++;
+                if (flag & BAM_FUNMAP) {
+                    output->unmapped++;
+                } else if (!(flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY))) {
+                    output->primary++;
+                }
+                output->remove_pending();
+            }
 
-        bool ignore_read_id = dx_tag == 1;
-
-        if (ignore_read_id) {
-            // Read is a duplex read.
-            m_duplex_reads_written++;
-        } else {
-            std::string read_id;
-
-            // If read is a split read, use the parent read id
-            // to track write count since we don't know a priori
-            // how many split reads will be generated.
-            auto pid_tag = bam_aux_get(aln.get(), "pi");
-            if (pid_tag) {
-                read_id = std::string(bam_aux2Z(pid_tag));
-                m_split_reads_written++;
-            } else {
-                read_id = bam_get_qname(aln.get());
+            // For the purpose of estimating write count, we ignore duplex reads
+            int64_t dx_tag = 0;
+            auto tag_str = bam_aux_get(aln.get(), "dx");
+            if (tag_str) {
+                dx_tag = bam_aux2i(tag_str);
             }
 
-            m_processed_read_ids.add(std::move(read_id));
+            bool ignore_read_id = dx_tag == 1;
+
+            if (ignore_read_id) {
+                // Read is a duplex read.
+                m_duplex_reads_written++;
+            } else {
+                std::string read_id;
+
+                // If read is a split read, use the parent read id
+                // to track write count since we don't know a priori
+                // how many split reads will be generated.
+                auto pid_tag = bam_aux_get(aln.get(), "pi");
+                if (pid_tag) {
+                    read_id = std::string(bam_aux2Z(pid_tag));
+                    m_split_reads_written++;
+                } else {
+                    read_id = bam_get_qname(aln.get());
+                }
+
+                m_processed_read_ids.add(std::move(read_id));
+            }
         }
     }
 }
 
 int HtsWriter::write(bam1_t* const record) {
+    if (!m_file) {
+        throw std::runtime_error("HtsWriter has no output file of its own.");
+    }
+    return write(*m_file, record);
+}
+
+int HtsWriter::write(utils::HtsFile& file, bam1_t* const record) {
     // track stats
     m_total++;
     if (record->core.flag & BAM_FUNMAP) {
@@ -112,7 +165,7 @@ int HtsWriter::write(bam1_t* const record) {
         };
     }
 
-    return m_file.write(record);
+    return file.write(record);
 }
 
 stats::NamedStats HtsWriter::sample_stats() const {
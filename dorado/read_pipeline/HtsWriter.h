@@ -4,6 +4,7 @@
 #include "utils/stats.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -15,9 +16,38 @@ struct bam1_t;
 
 namespace dorado {
 
+// Registered in a client's contexts to have an HtsWriter write that client's records to their
+// own file, so that one writer can serve several clients at once, e.g. the input files of
+// dorado aligner.
+struct HtsWriterOutput {
+    explicit HtsWriterOutput(utils::HtsFile& file_) : file(file_) {}
+
+    utils::HtsFile& file;
+    // Counts of the records written to this output. Only updated by the writer thread.
+    size_t total{0};
+    size_t primary{0};
+    size_t unmapped{0};
+
+    // Records on their way to this output. They're added before they're pushed into the
+    // pipeline and removed by the writer once written, so once the last record has been pushed
+    // the output is complete when the count reaches 0. A node that replaces a record with
+    // others adds the new ones before removing the original.
+    void add_pending(size_t count) { m_pending.fetch_add(count); }
+    void remove_pending();
+    // Blocks until every pending record has been written.
+    void wait_until_written();
+
+private:
+    std::atomic<size_t> m_pending{0};
+    std::mutex m_pending_mutex;
+    std::condition_variable m_pending_cv;
+};
+
 class HtsWriter : public MessageSink {
 public:
     HtsWriter(utils::HtsFile& file, std::string gpu_names);
+    // Every record must come from a client with an HtsWriterOutput.
+    explicit HtsWriter(std::string gpu_names);
     ~HtsWriter();
     std::string get_name() const override { return "HtsWriter"; }
     stats::NamedStats sample_stats() const override;
@@ -40,11 +70,12 @@ private:
     size_t m_secondary{0};
     size_t m_supplementary{0};
 
-    utils::HtsFile& m_file;
+    utils::HtsFile* const m_file;
 
     std::string m_gpu_names{};
 
     void input_thread_fn();
+    int write(utils::HtsFile& file, bam1_t* record);
     std::atomic<int> m_duplex_reads_written{0};
     std::atomic<int> m_split_reads_written{0};
 
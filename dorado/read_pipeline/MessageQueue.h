@@ -0,0 +1,96 @@
+#pragma once
+
+#include "messages.h"
+#include "utils/AsyncQueue.h"
+#include "utils/BoundedMpmcQueue.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace dorado {
+
+// Implementation used for a node's input queue.
+enum class MessageQueueType {
+    // utils::AsyncQueue: a std::queue guarded by a single mutex.
+    Locking,
+    // utils::BoundedMpmcQueue: a lock-free ring buffer which only locks to wait when full/empty.
+    LockFree,
+};
+
+// Input queue of a MessageSink, forwarding to the selected queue implementation.
+class MessageQueue {
+    using LockingQueuePtr = std::unique_ptr<utils::AsyncQueue<Message>>;
+    using LockFreeQueuePtr = std::unique_ptr<utils::BoundedMpmcQueue<Message>>;
+    std::variant<LockingQueuePtr, LockFreeQueuePtr> m_queue;
+
+    template <class Fn>
+    decltype(auto) visit(Fn&& fn) {
+        return std::visit([&](auto& queue) -> decltype(auto) { return fn(*queue); }, m_queue);
+    }
+
+    template <class Fn>
+    decltype(auto) visit(Fn&& fn) const {
+        return std::visit([&](const auto& queue) -> decltype(auto) { return fn(*queue); },
+                          m_queue);
+    }
+
+public:
+    MessageQueue(size_t capacity, MessageQueueType type) {
+        if (type == MessageQueueType::LockFree) {
+            m_queue = std::make_unique<utils::BoundedMpmcQueue<Message>>(capacity);
+        } else {
+            m_queue = std::make_unique<utils::AsyncQueue<Message>>(capacity);
+        }
+    }
+
+    MessageQueueType type() const {
+        return std::holds_alternative<LockFreeQueuePtr>(m_queue) ? MessageQueueType::LockFree
+                                                                 : MessageQueueType::Locking;
+    }
+
+    utils::AsyncQueueStatus try_push(Message&& message) {
+        return visit([&](auto& queue) { return queue.try_push(std::move(message)); });
+    }
+
+    utils::AsyncQueueStatus try_push_n(std::vector<Message>&& messages) {
+        return visit([&](auto& queue) { return queue.try_push_n(std::move(messages)); });
+    }
+
+    utils::AsyncQueueStatus try_pop(Message& message) {
+        return visit([&](auto& queue) { return queue.try_pop(message); });
+    }
+
+    template <class ProcessFn>
+    utils::AsyncQueueStatus process_and_pop_n(ProcessFn process_fn, size_t max_count) {
+        return visit([&](auto& queue) { return queue.process_and_pop_n(process_fn, max_count); });
+    }
+
+    void terminate() {
+        visit([](auto& queue) { queue.terminate(); });
+    }
+
+    void restart() {
+        visit([](auto& queue) { queue.restart(); });
+    }
+
+    size_t capacity() const {
+        return visit([](const auto& queue) { return queue.capacity(); });
+    }
+
+    size_t size() const {
+        return visit([](const auto& queue) { return queue.size(); });
+    }
+
+    std::string get_name() const {
+        return visit([](const auto& queue) { return queue.get_name(); });
+    }
+
+    std::unordered_map<std::string, double> sample_stats() const {
+        return visit([](const auto& queue) { return queue.sample_stats(); });
+    }
+};
+
+}  // namespace dorado
@@ -1,13 +1,22 @@
 #include "MessageSink.h"
 
+#include "utils/dev_utils.h"
 #include "utils/thread_naming.h"
 
 #include <cassert>
 
 namespace dorado {
 
+MessageQueueType default_message_queue_type() {
+    return utils::get_dev_opt<int>("lock_free_queues", 0) != 0 ? MessageQueueType::LockFree
+                                                               : MessageQueueType::Locking;
+}
+
 MessageSink::MessageSink(size_t max_messages, int num_input_threads)
-        : m_work_queue(max_messages), m_num_input_threads(num_input_threads) {}
+        : MessageSink(max_messages, num_input_threads, default_message_queue_type()) {}
+
+MessageSink::MessageSink(size_t max_messages, int num_input_threads, MessageQueueType queue_type)
+        : m_work_queue(max_messages, queue_type), m_num_input_threads(num_input_threads) {}
 
 void MessageSink::push_message_internal(Message &&message) {
 #ifndef NDEBUG
@@ -19,6 +28,43 @@ void MessageSink::push_message_internal(Message &&message) {
     assert(status == utils::AsyncQueueStatus::Success);
 }
 
+void MessageSink::push_messages(std::vector<Message> &&messages) {
+#ifndef NDEBUG
+    const auto status =
+#endif
+            m_work_queue.try_push_n(std::move(messages));
+    assert(status == utils::AsyncQueueStatus::Success);
+}
+
+bool MessageSink::get_input_messages(std::vector<Message> &messages, size_t max_messages) {
+    messages.clear();
+    // The queue may hold its lock while calling the process function, so only move the
+    // messages out here and forward any disconnected reads once the pop has finished.
+    const auto status = m_work_queue.process_and_pop_n(
+            [&messages](Message &&message) { messages.push_back(std::move(message)); },
+            max_messages);
+    if (status != utils::AsyncQueueStatus::Success) {
+        return false;
+    }
+
+    if (!m_sinks.empty() && forward_on_disconnected()) {
+        auto is_disconnected = [](const Message &message) {
+            return is_read_message(message) && get_read_common_data(message).client_info &&
+                   get_read_common_data(message).client_info->is_disconnected();
+        };
+        auto out_it = messages.begin();
+        for (auto &message : messages) {
+            if (is_disconnected(message)) {
+                send_message_to_sink(0, std::move(message));
+            } else {
+                *out_it++ = std::move(message);
+            }
+        }
+        messages.erase(out_it, messages.end());
+    }
+    return true;
+}
+
 void MessageSink::add_sink(MessageSink &sink) { m_sinks.push_back(std::ref(sink)); }
 
 void MessageSink::start_input_processing(const std::function<void()> &input_thread_fn,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ClientInfo.h"
+#include "MessageQueue.h"
 #include "flush_options.h"
 #include "messages.h"
 #include "utils/AsyncQueue.h"
@@ -20,12 +21,18 @@
 
 namespace dorado {
 
+// Input queue type used by nodes which don't select one explicitly.
+// Lock-free queues can be enabled with `--devopts "lock_free_queues=1"`.
+MessageQueueType default_message_queue_type();
+
 // Base class for an object which consumes messages as part of the processing pipeline.
 // Destructors of derived classes must call terminate() in order to shut down
 // waits on the input queue before attempting to join input worker threads.
 class MessageSink {
 public:
+    // The input queue type defaults to default_message_queue_type().
     MessageSink(size_t max_messages, int num_input_threads);
+    MessageSink(size_t max_messages, int num_input_threads, MessageQueueType queue_type);
 
     virtual ~MessageSink() = default;
 
@@ -43,6 +50,11 @@ public:
         push_message_internal(Message(std::move(msg)));
     }
 
+    // Adds a group of messages to the input queue in order, taking the queue lock once
+    // per run of available space rather than once per message.  This can block if the
+    // sink's queue is full.  Queue stats still count individual messages.
+    void push_messages(std::vector<Message>&& messages);
+
     // Waits until work is finished and shuts down worker threads.
     // No work can be done by the node after this returns until
     // restart is subsequently called.
@@ -75,6 +87,19 @@ protected:
         send_message_to_sink(0, std::forward<Msg>(message));
     }
 
+    // Sends a group of messages to the designated sink.  messages is left empty.
+    void send_messages_to_sink(int sink_index, std::vector<Message>&& messages) {
+        m_sinks.at(sink_index).get().push_messages(std::move(messages));
+    }
+
+    // Version for nodes with a single sink that is implicit.
+    void send_messages_to_sink(std::vector<Message>&& messages) {
+        if (m_sinks.size() != 1) {
+            throw std::runtime_error("Invalid m_sinks size");
+        }
+        send_messages_to_sink(0, std::move(messages));
+    }
+
     // Pops the next input message, returning true on success.
     // If terminating, returns false.
     bool get_input_message(Message& message) {
@@ -90,8 +115,14 @@ protected:
         return status == utils::AsyncQueueStatus::Success;
     }
 
+    // Replaces the contents of messages with up to max_messages input messages, waiting
+    // until at least one is available.  Returns false if terminating.
+    // Reads from disconnected clients are forwarded to sink 0 as in get_input_message, so
+    // messages may be empty on success.
+    bool get_input_messages(std::vector<Message>& messages, size_t max_messages);
+
     // Queue of work items for this node.
-    utils::AsyncQueue<Message> m_work_queue;
+    MessageQueue m_work_queue;
 
     // Mark the input queue as active, and start input processing threads executing the
     // supplied functor.
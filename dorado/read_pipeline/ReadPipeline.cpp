@@ -115,6 +115,12 @@ void Pipeline::push_message(Message &&message) {
     dynamic_cast<MessageSink &>(*m_nodes.at(source_node_index)).push_message(std::move(message));
 }
 
+void Pipeline::push_messages(std::vector<Message> &&messages) {
+    assert(!m_nodes.empty());
+    const auto source_node_index = m_source_to_sink_order.front();
+    dynamic_cast<MessageSink &>(*m_nodes.at(source_node_index)).push_messages(std::move(messages));
+}
+
 stats::NamedStats Pipeline::terminate(const FlushOptions &flush_options) {
     stats::NamedStats final_stats;
     // Nodes must be terminated in source to sink order to ensure all in flight
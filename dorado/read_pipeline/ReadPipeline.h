@@ -86,6 +86,10 @@ public:
     // Routes the given message to the pipeline source node.
     void push_message(Message&& message);
 
+    // Routes a group of messages, in order, to the pipeline source node.
+    // messages is left empty.
+    void push_messages(std::vector<Message>&& messages);
+
     // Stops all pipeline nodes in source to sink order.
     // Returns stats from nodes' final states.
     // After this is called the pipeline will do no further work processing subsequent inputs,
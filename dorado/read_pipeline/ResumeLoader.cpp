@@ -2,6 +2,7 @@
 
 #include "DefaultClientInfo.h"
 #include "HtsReader.h"
+#include "utils/bam_pool.h"
 #include "utils/tty_utils.h"
 
 #include <htslib/sam.h>
@@ -10,6 +11,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <string_view>
 
 namespace dorado {
 
@@ -39,25 +41,28 @@ void ResumeLoader::copy_completed_reads() {
     hts_set_log_level(HTS_LOG_OFF);
 
     HtsReader reader(m_resume_file, std::nullopt);
+    reader.set_num_threads(m_num_threads);
     spdlog::info("Resuming from file {}...", m_resume_file);
 
     auto client_info = std::make_shared<DefaultClientInfo>();
+    size_t num_reads = 0;
     // Iterate over all reads and write to sink.
     try {
         while (reader.read()) {
-            std::string read_id;
             // If a split read is found, use the parent read id to
             // resume basecalling since that's the read id found in
             // the raw dataset.
             auto pid_tag = bam_aux_get(reader.record.get(), "pi");
-            if (pid_tag) {
-                read_id = std::string(bam_aux2Z(pid_tag));
-            } else {
-                read_id = bam_get_qname(reader.record);
+            const char* read_id =
+                    pid_tag ? bam_aux2Z(pid_tag) : bam_get_qname(reader.record.get());
+            if (read_id) {
+                m_processed_read_ids.insert(std::string_view(read_id));
             }
-            m_processed_read_ids.insert(read_id);
-            m_sink.push_message(BamMessage{BamPtr(bam_dup1(reader.record.get())), client_info});
-            if (is_safe_to_log && m_processed_read_ids.size() % 100 == 0) {
+            // Hand the record itself to the sink rather than copying it, and read the next
+            // record into a fresh one.
+            m_sink.push_message(BamMessage{std::move(reader.record), client_info});
+            reader.record = utils::acquire_bam();
+            if (is_safe_to_log && ++num_reads % 100 == 0) {
                 bar.tick();
             }
         }
@@ -72,8 +77,4 @@ void ResumeLoader::copy_completed_reads() {
     hts_set_log_level(initial_hts_log_level);
 }
 
-std::unordered_set<std::string> ResumeLoader::get_processed_read_ids() const {
-    return m_processed_read_ids;
-}
-
 }  // namespace dorado
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "read_pipeline/MessageSink.h"
+#include "utils/read_id_set.h"
 
+#include <cstddef>
 #include <string>
-#include <unordered_set>
+#include <utility>
 
 namespace dorado {
 
@@ -11,14 +13,20 @@ class ResumeLoader {
 public:
     ResumeLoader(MessageSink& sink, const std::string& resume_file);
 
+    // Decompress the resume file with this many additional threads.
+    void set_num_threads(size_t threads) { m_num_threads = threads; }
+
     void copy_completed_reads();
-    std::unordered_set<std::string> get_processed_read_ids() const;
+    const utils::ReadIdSet& get_processed_read_ids() const { return m_processed_read_ids; }
+    // Moves the read IDs out, so they can be handed to the DataLoader without a copy.
+    utils::ReadIdSet take_processed_read_ids() { return std::move(m_processed_read_ids); }
 
 private:
     MessageSink& m_sink;
     std::string m_resume_file;
+    size_t m_num_threads{0};
 
-    std::unordered_set<std::string> m_processed_read_ids;
+    utils::ReadIdSet m_processed_read_ids;
 };
 
 }  // namespace dorado
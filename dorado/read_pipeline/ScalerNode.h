@@ -27,6 +27,7 @@ public:
 
 private:
     void input_thread_fn();
+    void scale_read(SimplexRead& read);
 
     const basecall::SignalNormalisationParams m_scaling_params;
     const models::SampleType m_model_type;
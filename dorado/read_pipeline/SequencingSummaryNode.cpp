@@ -0,0 +1,216 @@
+#include "SequencingSummaryNode.h"
+
+#include "summary/summary.h"
+#include "summary/summary_columns.h"
+#include "utils/PostCondition.h"
+#include "utils/thread_naming.h"
+
+#include <htslib/sam.h>
+#include <spdlog/spdlog.h>
+
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// Text rows are formatted into a block of about this size before being queued for writing.
+constexpr size_t SUMMARY_BLOCK_SIZE = 1 << 20;
+// Formatted blocks waiting to be written. This bounds the memory used if writing falls behind.
+constexpr size_t MAX_QUEUED_BLOCKS = 16;
+
+// Fills a row from a read which hasn't been converted to BAM yet, with the same values that
+// would be read back from the tags of its BAM record. The row has no alignment values.
+void build_read_row(dorado::SummaryRowBuilder& row_builder,
+                    const dorado::ReadCommon& read,
+                    dorado::SummaryRow& row) {
+    row = dorado::SummaryRow{};
+    row.filename = read.attributes.fast5_filename;
+    row.read_id = read.read_id;
+    row.run_id = read.run_id.empty() ? std::string_view("unknown") : read.run_id;
+    row.channel = read.attributes.channel_number;
+    row.mux = read.attributes.mux;
+    row.start_time = row_builder.get_start_time(read.generate_read_group(),
+                                                read.attributes.start_time);
+    if (!read.is_duplex && read.sample_rate > 0) {
+        const auto raw_samples = read.get_raw_data_samples();
+        row.duration = float(raw_samples + read.num_trimmed_samples) / float(read.sample_rate);
+        row.template_duration = float(raw_samples) / float(read.sample_rate);
+    }
+    row.template_start = row.start_time + (row.duration - row.template_duration);
+    row.sequence_length = int32_t(read.seq.size());
+    row.mean_qscore = read.calculate_mean_qscore();
+    row.barcode = read.barcode.empty() ? std::string_view("unclassified") : read.barcode;
+}
+
+}  // namespace
+
+namespace dorado {
+
+SequencingSummaryNode::SequencingSummaryNode(std::string summary_filename,
+                                             std::string columns_filename,
+                                             int threads)
+        : MessageSink(10000, 1),
+          m_summary_filename(std::move(summary_filename)),
+          m_columns_filename(std::move(columns_filename)),
+          m_threads(threads),
+          m_output_queue(MAX_QUEUED_BLOCKS) {}
+
+SequencingSummaryNode::~SequencingSummaryNode() { stop_input_processing(); }
+
+void SequencingSummaryNode::set_header(const sam_hdr_t* const header) {
+    if (!header) {
+        return;
+    }
+    m_header.reset(sam_hdr_dup(header));
+    auto fields = SummaryData::GENERAL_FIELDS | SummaryData::BARCODING_FIELDS;
+    if (m_header->n_targets > 0) {
+        fields |= SummaryData::ALIGNMENT_FIELDS;
+    }
+
+    if (!m_summary_filename.empty()) {
+        m_summary_formatter = std::make_unique<SummaryData>(fields);
+        m_summary_file.open(m_summary_filename);
+        if (!m_summary_file) {
+            throw std::runtime_error("Could not open summary file " + m_summary_filename);
+        }
+        const auto field_names = SummaryData::get_field_names(fields);
+        for (size_t i = 0; i < field_names.size(); ++i) {
+            m_summary_file << (i > 0 ? "\t" : "") << field_names[i];
+        }
+        m_summary_file << '\n';
+    }
+    if (!m_columns_filename.empty()) {
+        m_columns_writer =
+                std::make_unique<SummaryColumnsWriter>(m_columns_filename, fields, m_threads);
+    }
+}
+
+void SequencingSummaryNode::input_thread_fn() {
+    m_output_queue.restart();
+    std::thread writer_thread([this] {
+        utils::set_thread_name("seq_summary_wr");
+        writer_thread_fn();
+    });
+    auto join_writer_thread = utils::PostCondition([&] {
+        // Lets the writer drain the queue, including when we're returning due to an error.
+        m_output_queue.terminate();
+        writer_thread.join();
+    });
+
+    std::unique_ptr<SummaryRowBuilder> row_builder;
+    SummaryRow row;
+    std::string summary_block;
+
+    auto queue_block = [this](bool is_columns, std::string data) {
+        if (!data.empty()) {
+            m_output_queue.try_push({is_columns, std::move(data)});
+        }
+    };
+
+    Message message;
+    while (get_input_message(message)) {
+        const bool has_read =
+                std::holds_alternative<BamMessage>(message) || is_read_message(message);
+        if (has_read && !m_header) {
+            // Throwing would end the process from this thread, so the reads are still passed
+            // on and the summary is reported as failed.
+            if (!m_write_failed.exchange(true)) {
+                spdlog::error("SequencingSummaryNode header has not been set.");
+            }
+        } else if (has_read) {
+            if (!row_builder) {
+                row_builder = std::make_unique<SummaryRowBuilder>(m_header.get());
+            }
+
+            bool has_row = true;
+            if (std::holds_alternative<BamMessage>(message)) {
+                auto& record = std::get<BamMessage>(message).bam_ptr;
+                has_row = row_builder->build(record.get(), row);
+            } else {
+                build_read_row(*row_builder, get_read_common_data(message), row);
+            }
+
+            if (has_row) {
+                if (m_summary_formatter) {
+                    m_summary_formatter->append_row(summary_block, row);
+                    if (summary_block.size() >= SUMMARY_BLOCK_SIZE) {
+                        queue_block(false, std::exchange(summary_block, {}));
+                    }
+                }
+                if (m_columns_writer && m_columns_writer->buffer_row(row)) {
+                    queue_block(true, m_columns_writer->take_chunk());
+                }
+                ++m_num_rows;
+            }
+        }
+        send_message_to_sink(std::move(message));
+    }
+
+    // Hand over the partial blocks before the writer finishes.
+    queue_block(false, std::move(summary_block));
+    if (m_columns_writer) {
+        queue_block(true, m_columns_writer->take_chunk());
+    }
+}
+
+void SequencingSummaryNode::writer_thread_fn() {
+    OutputBlock block;
+    while (m_output_queue.try_pop(block) == utils::AsyncQueueStatus::Success) {
+        if (m_write_failed) {
+            continue;
+        }
+        try {
+            if (block.is_columns) {
+                m_columns_writer->write_chunk(block.data);
+            } else if (!m_summary_file.write(block.data.data(), block.data.size())) {
+                throw std::runtime_error("Could not write to summary file " + m_summary_filename);
+            }
+        } catch (const std::exception& e) {
+            // Keep draining the queue so the pipeline isn't blocked, but stop writing.
+            spdlog::error("{}", e.what());
+            m_write_failed = true;
+        }
+    }
+}
+
+stats::NamedStats SequencingSummaryNode::sample_stats() const {
+    auto stats = stats::from_obj(m_work_queue);
+    stats["summary_rows"] = static_cast<double>(m_num_rows.load());
+    stats["queued_summary_blocks"] = static_cast<double>(m_output_queue.size());
+    return stats;
+}
+
+void SequencingSummaryNode::terminate(const FlushOptions&) {
+    stop_input_processing();
+
+    // Every row has been written, so the outputs are finished here. A failure to write them is
+    // logged and left for write_failed(), so the nodes after this one still terminate.
+    if (m_summary_file.is_open()) {
+        m_summary_file.close();
+        if (m_summary_file.fail()) {
+            spdlog::error("Could not write to summary file {}", m_summary_filename);
+            m_write_failed = true;
+        }
+        m_outputs_closed = true;
+    }
+    if (m_columns_writer) {
+        try {
+            m_columns_writer->close();
+        } catch (const std::exception& e) {
+            spdlog::error("{}", e.what());
+            m_write_failed = true;
+        }
+        m_outputs_closed = true;
+    }
+}
+
+void SequencingSummaryNode::restart() {
+    if (m_outputs_closed) {
+        throw std::runtime_error(
+                "SequencingSummaryNode can't be restarted once its outputs are closed.");
+    }
+    start_input_processing([this] { input_thread_fn(); }, "seq_summary");
+}
+
+}  // namespace dorado
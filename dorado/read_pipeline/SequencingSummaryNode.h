@@ -0,0 +1,68 @@
+#pragma once
+
+#include "read_pipeline/MessageSink.h"
+#include "utils/AsyncQueue.h"
+#include "utils/stats.h"
+#include "utils/types.h"
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace dorado {
+
+class SummaryColumnsWriter;
+class SummaryData;
+class SummaryRowBuilder;
+struct SummaryRow;
+class ReadCommon;
+
+// Writes a sequencing summary row for each read as it passes through, then forwards it, so
+// the summary is produced as reads complete rather than by a pass over the output files.
+// Rows are filled from BAM records, or from reads which haven't been converted to BAM yet.
+// Formatting is done on the node's thread, and a writer thread writes the formatted rows.
+class SequencingSummaryNode : public MessageSink {
+public:
+    // The text summary is written to summary_filename and the columnar summary to
+    // columns_filename. Either may be empty if it isn't wanted.
+    SequencingSummaryNode(std::string summary_filename, std::string columns_filename, int threads);
+    ~SequencingSummaryNode();
+    std::string get_name() const override { return "SequencingSummaryNode"; }
+    stats::NamedStats sample_stats() const override;
+    // Closes the outputs. Failures are logged rather than thrown; see write_failed().
+    void terminate(const FlushOptions&) override;
+    void restart() override;
+
+    // True if any of the summary couldn't be written. Only final once the node is terminated.
+    bool write_failed() const { return m_write_failed; }
+
+    // Must be called before any reads are sent to the node. The summary has alignment
+    // fields if the header has reference sequences.
+    void set_header(const sam_hdr_t* header);
+
+private:
+    // Formatted rows waiting to be written to one of the outputs.
+    struct OutputBlock {
+        bool is_columns{false};
+        std::string data;
+    };
+    using OutputQueue = utils::AsyncQueue<OutputBlock>;
+
+    const std::string m_summary_filename;
+    const std::string m_columns_filename;
+    const int m_threads;
+    SamHdrPtr m_header;
+    std::unique_ptr<SummaryData> m_summary_formatter;
+    std::ofstream m_summary_file;
+    std::unique_ptr<SummaryColumnsWriter> m_columns_writer;
+    OutputQueue m_output_queue;
+    std::atomic<size_t> m_num_rows{0};
+    std::atomic<bool> m_write_failed{false};
+    bool m_outputs_closed{false};
+
+    void input_thread_fn();
+    void writer_thread_fn();
+};
+
+}  // namespace dorado
@@ -35,6 +35,10 @@ struct Attributes {
 
 class ClientInfo;
 
+namespace utils {
+class BamRecordBuilder;
+}
+
 class ReadCommon {
 public:
     at::Tensor raw_data;  // Loaded from source file
@@ -126,11 +130,14 @@ public:
     float model_q_bias{0.0f};
     float model_q_scale{0.0f};
 
-private:
-    void generate_duplex_read_tags(bam1_t*) const;
-    void generate_read_tags(bam1_t* aln, bool emit_moves, bool is_duplex_parent) const;
-    void generate_modbase_tags(bam1_t* aln, uint8_t threshold) const;
     std::string generate_read_group() const;
+
+private:
+    void generate_duplex_read_tags(utils::BamRecordBuilder& builder) const;
+    void generate_read_tags(utils::BamRecordBuilder& builder,
+                            bool emit_moves,
+                            bool is_duplex_parent) const;
+    void generate_modbase_tags(utils::BamRecordBuilder& builder, uint8_t threshold) const;
 };
 
 // Class representing a duplex read, including stereo-encoded raw data
@@ -224,12 +231,6 @@ struct CorrectionAlignments {
     std::vector<std::vector<CigarOp>> cigars;
     std::vector<utils::Overlap> overlaps;
 
-    // Populated in CorrectionInferenceNode::populate_alignments if the alignment is useful
-    std::string read_seq;
-    std::vector<uint8_t> read_qual;
-    std::vector<std::string> seqs;
-    std::vector<std::vector<uint8_t>> quals;
-
     // This is mostly to workaround an issue where sometimes
     // the tend of an overlap is much bigger than the
     // tlen of the read. This is unexpected and happens
@@ -248,19 +249,13 @@ struct CorrectionAlignments {
     }
 
     size_t size() {
-        size_t si = read_name.length() + read_seq.length() + read_qual.size();
+        size_t si = read_name.length();
         for (auto& o : overlaps) {
             si += sizeof(o);
         }
         for (auto& v : cigars) {
             si += v.size() * sizeof(CigarOp);
         }
-        for (auto& s : seqs) {
-            si += s.length();
-        }
-        for (auto& v : quals) {
-            si += v.size();
-        }
         for (auto& s : qnames) {
             si += s.length();
         }
@@ -1,15 +1,26 @@
 #include "summary.h"
 
 #include "read_pipeline/HtsReader.h"
+#include "utils/AsyncQueue.h"
 #include "utils/bam_utils.h"
 #include "utils/log_utils.h"
 #include "utils/time_utils.h"
 
+#include <htslib/sam.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <charconv>
 #include <csignal>
+#include <cstdio>
 #include <filesystem>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 
 namespace {
 
@@ -33,6 +44,107 @@ public:
 
 volatile sig_atomic_t SigIntHandler::interrupt{};
 
+// Rows are formatted into a buffer of about this size before being written out.
+constexpr size_t ROWS_BUFFER_SIZE = 1 << 20;
+// Maximum number of buffers of rows queued per file when processing files in parallel.
+constexpr size_t MAX_QUEUED_BUFFERS_PER_FILE = 4;
+// Files processed at once by process_tree.
+constexpr size_t MAX_FILES_IN_FLIGHT = 8;
+
+// The aux tags used in the summary. The views are into the record's aux data.
+struct SummaryTags {
+    std::string_view read_group;
+    std::string_view f5_filename;
+    std::string_view fn_filename;
+    std::string_view start_time;
+    std::string_view barcode;
+    int64_t channel{0};
+    int64_t mux{0};
+    int64_t num_samples{0};
+    int64_t trim_samples{0};
+    int64_t bed_hits{0};
+    float duration{0};
+    float mean_qscore{0};
+};
+
+constexpr uint16_t tag_key(const char* tag) {
+    return static_cast<uint16_t>((static_cast<uint8_t>(tag[0]) << 8) |
+                                 static_cast<uint8_t>(tag[1]));
+}
+
+std::string_view aux_string(const uint8_t* aux) {
+    const char* value = bam_aux2Z(aux);
+    return value ? std::string_view(value) : std::string_view();
+}
+
+// Decodes all the tags in one pass over the aux data, rather than a bam_aux_get scan per tag.
+SummaryTags decode_summary_tags(bam1_t* record) {
+    SummaryTags tags;
+    for (uint8_t* aux = bam_aux_first(record); aux != nullptr; aux = bam_aux_next(record, aux)) {
+        switch (tag_key(bam_aux_tag(aux))) {
+        case tag_key("RG"):
+            tags.read_group = aux_string(aux);
+            break;
+        case tag_key("f5"):
+            tags.f5_filename = aux_string(aux);
+            break;
+        case tag_key("fn"):
+            tags.fn_filename = aux_string(aux);
+            break;
+        case tag_key("st"):
+            tags.start_time = aux_string(aux);
+            break;
+        case tag_key("BC"):
+            tags.barcode = aux_string(aux);
+            break;
+        case tag_key("ch"):
+            tags.channel = bam_aux2i(aux);
+            break;
+        case tag_key("mx"):
+            tags.mux = bam_aux2i(aux);
+            break;
+        case tag_key("ns"):
+            tags.num_samples = bam_aux2i(aux);
+            break;
+        case tag_key("ts"):
+            tags.trim_samples = bam_aux2i(aux);
+            break;
+        case tag_key("bh"):
+            tags.bed_hits = bam_aux2i(aux);
+            break;
+        case tag_key("du"):
+            tags.duration = static_cast<float>(bam_aux2f(aux));
+            break;
+        case tag_key("qs"):
+            tags.mean_qscore = static_cast<float>(bam_aux2f(aux));
+            break;
+        default:
+            break;
+        }
+    }
+    return tags;
+}
+
+void append_value(std::string& rows, std::string_view value) { rows += value; }
+
+template <typename T, std::enable_if_t<std::is_integral_v<T>, bool> = true>
+void append_value(std::string& rows, T value) {
+    std::array<char, 24> buffer;
+    const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    rows.append(buffer.data(), result.ptr);
+}
+
+// Matches the default formatting of std::ostream, which is printf's %g.
+void append_value(std::string& rows, double value) {
+    std::array<char, 32> buffer;
+    const int length = std::snprintf(buffer.data(), buffer.size(), "%g", value);
+    rows.append(buffer.data(), std::min(static_cast<size_t>(length), buffer.size() - 1));
+}
+
+void append_value(std::string& rows, float value) {
+    append_value(rows, static_cast<double>(value));
+}
+
 }  // anonymous namespace
 
 namespace dorado {
@@ -65,6 +177,8 @@ SummaryData::SummaryData(FieldFlags flags) { set_fields(flags); }
 
 void SummaryData::set_separator(char s) { m_separator = s; }
 
+void SummaryData::set_num_threads(int threads) { m_num_threads = std::max(threads, 1); }
+
 void SummaryData::set_fields(FieldFlags flags) {
     if (flags == 0 || flags > (GENERAL_FIELDS | BARCODING_FIELDS | ALIGNMENT_FIELDS)) {
         throw std::runtime_error(
@@ -76,13 +190,16 @@ void SummaryData::set_fields(FieldFlags flags) {
 bool SummaryData::process_file(const std::string& filename, std::ostream& writer) {
     SigIntHandler sig_handler;
     HtsReader reader(filename, std::nullopt);
+    reader.set_num_threads(m_num_threads);
     m_field_flags = GENERAL_FIELDS | BARCODING_FIELDS;
     if (reader.is_aligned) {
         m_field_flags |= ALIGNMENT_FIELDS;
     }
-    auto read_group_exp_start_time = utils::get_read_group_info(reader.header(), "DT");
     write_header(writer);
-    return write_rows_from_reader(reader, writer, read_group_exp_start_time);
+    return write_rows_from_reader(reader, [&writer](std::string& rows) {
+        writer.write(rows.data(), rows.size());
+        return true;
+    });
 }
 
 bool SummaryData::process_tree(const std::string& folder, std::ostream& writer) {
@@ -101,172 +218,238 @@ bool SummaryData::process_tree(const std::string& folder, std::ostream& writer)
     }
     SigIntHandler sig_handler;
     write_header(writer);
-    for (const auto& read_file : files) {
-        HtsReader reader(read_file, std::nullopt);
-        auto read_group_exp_start_time = utils::get_read_group_info(reader.header(), "DT");
-        bool ok = write_rows_from_reader(reader, writer, read_group_exp_start_time);
-        if (!ok) {
-            spdlog::error("File {} could not be processed. Skipping file.", read_file);
+
+    // Files are processed in parallel, each passing its rows through a queue of its own, and
+    // the queues are drained in file order so the output is the same as processing serially.
+    // Workers take files in order, so the file being drained is always being worked on and a
+    // worker blocked on a full queue is only ever waiting for earlier files.
+    using RowsQueue = utils::AsyncQueue<std::string>;
+    std::vector<std::unique_ptr<RowsQueue>> file_rows;
+    for (size_t i = 0; i < files.size(); ++i) {
+        file_rows.push_back(std::make_unique<RowsQueue>(MAX_QUEUED_BUFFERS_PER_FILE));
+    }
+
+    std::atomic<size_t> next_file_idx{0};
+    auto process_files = [&] {
+        for (size_t file_idx = next_file_idx++; file_idx < files.size();
+             file_idx = next_file_idx++) {
+            auto& rows_queue = *file_rows[file_idx];
+            bool ok = false;
+            try {
+                HtsReader reader(files[file_idx], std::nullopt);
+                ok = write_rows_from_reader(reader, [&rows_queue](std::string& rows) {
+                    auto status = rows_queue.try_push(std::move(rows));
+                    return status == utils::AsyncQueueStatus::Success;
+                });
+            } catch (const std::exception& e) {
+                spdlog::error("{}", e.what());
+            }
+            if (!ok) {
+                spdlog::error("File {} could not be processed. Skipping file.", files[file_idx]);
+            }
+            rows_queue.terminate();
         }
+    };
+
+    const size_t num_workers =
+            std::clamp(std::min(files.size(), static_cast<size_t>(m_num_threads)), size_t{1},
+                       MAX_FILES_IN_FLIGHT);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back(process_files);
+    }
+    for (auto& rows_queue : file_rows) {
+        std::string rows;
+        while (rows_queue->try_pop(rows) == utils::AsyncQueueStatus::Success) {
+            writer.write(rows.data(), rows.size());
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
     }
     return true;
 }
 
+std::vector<std::string> SummaryData::get_field_names(FieldFlags flags) {
+    auto names = s_required_fields;
+    if (flags & GENERAL_FIELDS) {
+        names.insert(names.end(), s_general_fields.begin(), s_general_fields.end());
+    }
+    if (flags & BARCODING_FIELDS) {
+        names.insert(names.end(), s_barcoding_fields.begin(), s_barcoding_fields.end());
+    }
+    if (flags & ALIGNMENT_FIELDS) {
+        names.insert(names.end(), s_alignment_fields.begin(), s_alignment_fields.end());
+    }
+    return names;
+}
+
 void SummaryData::write_header(std::ostream& writer) {
-    for (size_t i = 0; i < s_required_fields.size(); ++i) {
+    const auto names = get_field_names(m_field_flags);
+    for (size_t i = 0; i < names.size(); ++i) {
         if (i > 0) {
             writer << m_separator;
         }
-        writer << s_required_fields[i];
+        writer << names[i];
     }
+    writer << '\n';
+}
+
+void SummaryData::append_row(std::string& rows, const SummaryRow& row) const {
+    auto append_field = [this, &rows](auto value) {
+        rows += m_separator;
+        append_value(rows, value);
+    };
+
+    rows += row.filename;
+    append_field(row.read_id);
+
     if (m_field_flags & GENERAL_FIELDS) {
-        for (size_t i = 0; i < s_general_fields.size(); ++i) {
-            writer << m_separator << s_general_fields[i];
-        }
+        append_field(row.run_id);
+        append_field(row.channel);
+        append_field(row.mux);
+        append_field(row.start_time);
+        append_field(row.duration);
+        append_field(row.template_start);
+        append_field(row.template_duration);
+        append_field(row.sequence_length);
+        append_field(row.mean_qscore);
     }
+
     if (m_field_flags & BARCODING_FIELDS) {
-        for (size_t i = 0; i < s_barcoding_fields.size(); ++i) {
-            writer << m_separator << s_barcoding_fields[i];
-        }
+        append_field(row.barcode);
     }
+
     if (m_field_flags & ALIGNMENT_FIELDS) {
-        for (size_t i = 0; i < s_alignment_fields.size(); ++i) {
-            writer << m_separator << s_alignment_fields[i];
-        }
+        append_field(row.alignment_genome);
+        append_field(row.alignment_genome_start);
+        append_field(row.alignment_genome_end);
+        append_field(row.alignment_strand_start);
+        append_field(row.alignment_strand_end);
+        append_field(row.alignment_direction);
+        append_field(row.alignment_length);
+        append_field(row.alignment_num_aligned);
+        append_field(row.alignment_num_correct);
+        append_field(row.alignment_num_insertions);
+        append_field(row.alignment_num_deletions);
+        append_field(row.alignment_num_substitutions);
+        append_field(row.alignment_mapq);
+        append_field(row.alignment_strand_coverage);
+        append_field(row.alignment_identity);
+        append_field(row.alignment_accuracy);
+        append_field(row.alignment_bed_hits);
     }
-    writer << '\n';
+    rows += '\n';
 }
 
 bool SummaryData::write_rows_from_reader(
         HtsReader& reader,
-        std::ostream& writer,
-        const std::map<std::string, std::string>& read_group_exp_start_time) {
+        const std::function<bool(std::string& rows)>& write_rows) const {
+    std::string rows;
+    rows.reserve(ROWS_BUFFER_SIZE + ROWS_BUFFER_SIZE / 8);
+
+    SummaryRowBuilder row_builder(reader.header());
+    SummaryRow row;
     while (reader.read() && !SigIntHandler::interrupt) {
-        if (reader.record->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) {
+        if (!row_builder.build(reader.record.get(), row)) {
             continue;
         }
+        append_row(rows, row);
 
-        std::string run_id = "unknown";
-        std::string model = "unknown";
-
-        auto rg_value = reader.get_tag<std::string>("RG");
-        if (rg_value.length() > 0) {
-            auto rg_split = rg_value.find('_');
-            run_id = rg_value.substr(0, rg_split);
-            model = rg_value.substr(rg_split + 1, rg_value.length());
-        }
-
-        auto filename = reader.get_tag<std::string>("f5");
-        if (filename.empty()) {
-            filename = reader.get_tag<std::string>("fn");
-        }
-        auto read_id = bam_get_qname(reader.record);
-        auto channel = reader.get_tag<int>("ch");
-        auto mux = reader.get_tag<int>("mx");
-
-        auto start_time_dt = reader.get_tag<std::string>("st");
-        auto duration = reader.get_tag<float>("du");
-
-        auto seqlen = reader.record->core.l_qseq;
-        auto mean_qscore = reader.get_tag<float>("qs");
-
-        auto num_samples = reader.get_tag<int>("ns");
-        auto trim_samples = reader.get_tag<int>("ts");
-
-        auto barcode = reader.get_tag<std::string>("BC");
-        if (barcode.empty()) {
-            barcode = "unclassified";
-        }
-
-        float template_duration = duration;
-        if (num_samples > 0 && duration > 0) {
-            // If either num_samples or duration are 0 (due to missing tags), then
-            // we can't properly compute template_duration.
-            float sample_rate = num_samples / duration;
-            template_duration = (num_samples - trim_samples) / sample_rate;
-        }
-        auto start_time = 0.0;
-        auto exp_start_time_iter = read_group_exp_start_time.find(rg_value);
-        if (exp_start_time_iter != read_group_exp_start_time.end()) {
-            auto exp_start_dt = exp_start_time_iter->second;
-            start_time = utils::time_difference_seconds(start_time_dt, exp_start_dt);
+        if (rows.size() >= ROWS_BUFFER_SIZE) {
+            if (!write_rows(rows)) {
+                return false;
+            }
+            rows.clear();
         }
-        auto template_start_time = start_time + (duration - template_duration);
+    }
+    return rows.empty() || write_rows(rows);
+}
 
-        writer << filename << m_separator << read_id;
+SummaryRowBuilder::SummaryRowBuilder(sam_hdr_t* header)
+        : m_header(header),
+          m_is_aligned(header && header->n_targets > 0),
+          m_read_group_exp_start_time(utils::get_read_group_info(header, "DT")) {}
 
-        if (m_field_flags & GENERAL_FIELDS) {
-            writer << m_separator << run_id << m_separator << channel << m_separator << mux
-                   << m_separator << start_time << m_separator << duration << m_separator
-                   << template_start_time << m_separator << template_duration << m_separator
-                   << seqlen << m_separator << mean_qscore;
-        }
+bool SummaryRowBuilder::build(bam1_t* record, SummaryRow& row) {
+    if (record->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) {
+        return false;
+    }
 
-        if (m_field_flags & BARCODING_FIELDS) {
-            writer << m_separator << barcode;
-        }
+    const auto tags = decode_summary_tags(record);
+    row = SummaryRow{};
 
-        if (m_field_flags & ALIGNMENT_FIELDS) {
-            std::string alignment_genome = "*";
-            int32_t alignment_genome_start = -1;
-            int32_t alignment_genome_end = -1;
-            int32_t alignment_strand_start = -1;
-            int32_t alignment_strand_end = -1;
-            std::string alignment_direction = "*";
-            int32_t alignment_length = 0;
-            int32_t alignment_mapq = 0;
-            int alignment_num_aligned = 0;
-            int alignment_num_correct = 0;
-            int alignment_num_insertions = 0;
-            int alignment_num_deletions = 0;
-            int alignment_num_substitutions = 0;
-            float strand_coverage = 0.0;
-            float alignment_identity = 0.0;
-            float alignment_accurary = 0.0;
-            int alignment_bed_hits = 0;
-
-            if (reader.is_aligned && !(reader.record->core.flag & BAM_FUNMAP)) {
-                alignment_mapq = static_cast<int>(reader.record->core.qual);
-                alignment_genome = reader.header()->target_name[reader.record->core.tid];
-
-                alignment_genome_start = int32_t(reader.record->core.pos);
-                alignment_genome_end = int32_t(bam_endpos(reader.record.get()));
-                alignment_direction = bam_is_rev(reader.record) ? "-" : "+";
-
-                auto alignment_counts = utils::get_alignment_op_counts(reader.record.get());
-                alignment_num_aligned = int(alignment_counts.matches);
-                alignment_num_correct =
-                        int(alignment_counts.matches - alignment_counts.substitutions);
-                alignment_num_insertions = int(alignment_counts.insertions);
-                alignment_num_deletions = int(alignment_counts.deletions);
-                alignment_num_substitutions = int(alignment_counts.substitutions);
-                alignment_length = int(alignment_counts.matches + alignment_counts.insertions +
-                                       alignment_counts.deletions);
-                alignment_strand_start = int(alignment_counts.softclip_start);
-                alignment_strand_end = int(seqlen - alignment_counts.softclip_end);
-
-                strand_coverage = (alignment_strand_end - alignment_strand_start) /
-                                  static_cast<float>(seqlen);
-                alignment_identity =
-                        alignment_num_correct / static_cast<float>(alignment_counts.matches);
-                alignment_accurary = alignment_num_correct / static_cast<float>(alignment_length);
-                alignment_bed_hits = reader.get_tag<int>("bh");
-            }
+    row.filename = tags.f5_filename.empty() ? tags.fn_filename : tags.f5_filename;
+    row.read_id = bam_get_qname(record);
 
-            writer << m_separator << alignment_genome << m_separator << alignment_genome_start
-                   << m_separator << alignment_genome_end << m_separator << alignment_strand_start
-                   << m_separator << alignment_strand_end << m_separator << alignment_direction
-                   << m_separator << alignment_length << m_separator << alignment_num_aligned
-                   << m_separator << alignment_num_correct << m_separator
-                   << alignment_num_insertions << m_separator << alignment_num_deletions
-                   << m_separator << alignment_num_substitutions << m_separator << alignment_mapq
-                   << m_separator << strand_coverage << m_separator << alignment_identity
-                   << m_separator << alignment_accurary << m_separator << alignment_bed_hits;
-            ;
-        }
-        writer << '\n';
+    row.run_id = "unknown";
+    if (!tags.read_group.empty()) {
+        row.run_id = tags.read_group.substr(0, tags.read_group.find('_'));
+    }
+    row.channel = tags.channel;
+    row.mux = tags.mux;
+
+    const auto seqlen = record->core.l_qseq;
+    const auto duration = tags.duration;
+    float template_duration = duration;
+    if (tags.num_samples > 0 && duration > 0) {
+        // If either num_samples or duration are 0 (due to missing tags), then
+        // we can't properly compute template_duration.
+        float sample_rate = tags.num_samples / duration;
+        template_duration = (tags.num_samples - tags.trim_samples) / sample_rate;
+    }
+    row.start_time = get_start_time(tags.read_group, tags.start_time);
+    row.duration = duration;
+    row.template_start = row.start_time + (duration - template_duration);
+    row.template_duration = template_duration;
+    row.sequence_length = seqlen;
+    row.mean_qscore = tags.mean_qscore;
+
+    row.barcode = tags.barcode.empty() ? std::string_view("unclassified") : tags.barcode;
+
+    if (m_is_aligned && !(record->core.flag & BAM_FUNMAP)) {
+        row.alignment_mapq = static_cast<int>(record->core.qual);
+        row.alignment_genome = m_header->target_name[record->core.tid];
+
+        row.alignment_genome_start = int32_t(record->core.pos);
+        row.alignment_genome_end = int32_t(bam_endpos(record));
+        row.alignment_direction = bam_is_rev(record) ? "-" : "+";
+
+        auto alignment_counts = utils::get_alignment_op_counts(record);
+        row.alignment_num_aligned = int(alignment_counts.matches);
+        row.alignment_num_correct = int(alignment_counts.matches - alignment_counts.substitutions);
+        row.alignment_num_insertions = int(alignment_counts.insertions);
+        row.alignment_num_deletions = int(alignment_counts.deletions);
+        row.alignment_num_substitutions = int(alignment_counts.substitutions);
+        row.alignment_length = int(alignment_counts.matches + alignment_counts.insertions +
+                                   alignment_counts.deletions);
+        row.alignment_strand_start = int(alignment_counts.softclip_start);
+        row.alignment_strand_end = int(seqlen - alignment_counts.softclip_end);
+
+        row.alignment_strand_coverage = (row.alignment_strand_end - row.alignment_strand_start) /
+                                        static_cast<float>(seqlen);
+        row.alignment_identity =
+                row.alignment_num_correct / static_cast<float>(alignment_counts.matches);
+        row.alignment_accuracy =
+                row.alignment_num_correct / static_cast<float>(row.alignment_length);
+        row.alignment_bed_hits = tags.bed_hits;
     }
     return true;
 }
 
+double SummaryRowBuilder::get_start_time(std::string_view read_group,
+                                         std::string_view read_start_time) {
+    if (read_group != m_last_read_group) {
+        m_last_read_group = read_group;
+        auto exp_start_time_iter = m_read_group_exp_start_time.find(m_last_read_group);
+        m_exp_start_dt = exp_start_time_iter != m_read_group_exp_start_time.end()
+                                 ? &exp_start_time_iter->second
+                                 : nullptr;
+    }
+    if (!m_exp_start_dt) {
+        return 0.0;
+    }
+    return utils::time_difference_seconds(std::string(read_start_time), *m_exp_start_dt);
+}
+
 }  // namespace dorado
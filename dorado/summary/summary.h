@@ -1,14 +1,78 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+struct bam1_t;
+struct sam_hdr_t;
+
 namespace dorado {
 
 class HtsReader;
 
+/// The values of one row of a sequencing summary, in field order. The string values are views
+/// into the record and header the row was built from.
+struct SummaryRow {
+    std::string_view filename;
+    std::string_view read_id;
+
+    std::string_view run_id;
+    int64_t channel{0};
+    int64_t mux{0};
+    double start_time{0};
+    float duration{0};
+    double template_start{0};
+    float template_duration{0};
+    int32_t sequence_length{0};
+    float mean_qscore{0};
+
+    std::string_view barcode;
+
+    std::string_view alignment_genome{"*"};
+    int32_t alignment_genome_start{-1};
+    int32_t alignment_genome_end{-1};
+    int32_t alignment_strand_start{-1};
+    int32_t alignment_strand_end{-1};
+    std::string_view alignment_direction{"*"};
+    int32_t alignment_length{0};
+    int32_t alignment_num_aligned{0};
+    int32_t alignment_num_correct{0};
+    int32_t alignment_num_insertions{0};
+    int32_t alignment_num_deletions{0};
+    int32_t alignment_num_substitutions{0};
+    int32_t alignment_mapq{0};
+    float alignment_strand_coverage{0};
+    float alignment_identity{0};
+    float alignment_accuracy{0};
+    int64_t alignment_bed_hits{0};
+};
+
+/// Builds summary rows from the records of a file with the given header.
+class SummaryRowBuilder {
+public:
+    explicit SummaryRowBuilder(sam_hdr_t* header);
+
+    /// Returns false for secondary and supplementary records, which have no row.
+    bool build(bam1_t* record, SummaryRow& row);
+
+    /// Seconds from the start of the read group's experiment to the read's start time, or 0 if
+    /// the header has no start time for the read group.
+    double get_start_time(std::string_view read_group, std::string_view read_start_time);
+
+private:
+    const sam_hdr_t* const m_header;
+    const bool m_is_aligned;
+    const std::map<std::string, std::string> m_read_group_exp_start_time;
+    // The experiment start time of the last read group seen, which rarely changes.
+    std::string m_last_read_group;
+    const std::string* m_exp_start_dt{nullptr};
+};
+
 class SummaryData {
 public:
     using FieldFlags = uint32_t;
@@ -21,6 +85,8 @@ public:
 
     void set_separator(char s);
     void set_fields(FieldFlags flags);
+    /// Threads used to process files, or to decompress them when processing a single file.
+    void set_num_threads(int threads);
 
     /// This will automatically set the fields based on the contents of the file.
     bool process_file(const std::string& filename, std::ostream& writer);
@@ -28,6 +94,12 @@ public:
     /// For this method the fields must already be set.
     bool process_tree(const std::string& folder, std::ostream& writer);
 
+    /// Names of the fields written for the given flags, in order.
+    static std::vector<std::string> get_field_names(FieldFlags flags);
+
+    /// Formats a row with the current fields and separator, appending it to rows.
+    void append_row(std::string& rows, const SummaryRow& row) const;
+
 private:
     static std::vector<std::string> s_required_fields;
     static std::vector<std::string> s_general_fields;
@@ -36,11 +108,13 @@ private:
 
     char m_separator{'\t'};
     FieldFlags m_field_flags{};
+    int m_num_threads{1};
 
     void write_header(std::ostream& writer);
+    /// Rows are formatted into large buffers which are passed to write_rows, which returns
+    /// false if no more rows should be written.
     bool write_rows_from_reader(HtsReader& reader,
-                                std::ostream& writer,
-                                const std::map<std::string, std::string>& rgst);
+                                const std::function<bool(std::string& rows)>& write_rows) const;
 };
 
 }  // namespace dorado
@@ -0,0 +1,478 @@
+#include "summary_columns.h"
+
+#include <htslib/bgzf.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace {
+
+constexpr std::string_view MAGIC = "DSUMCOL2";
+constexpr std::string_view END_MAGIC = "DSUMEND2";
+// More than there are summary fields, for rejecting corrupt files.
+constexpr uint32_t MAX_COLUMNS = 1024;
+
+using FieldPtr = std::variant<std::string_view dorado::SummaryRow::*,
+                              int64_t dorado::SummaryRow::*,
+                              int32_t dorado::SummaryRow::*,
+                              float dorado::SummaryRow::*,
+                              double dorado::SummaryRow::*>;
+// Type bytes of the FieldPtr alternatives, in order.
+constexpr std::array<char, 5> FIELD_TYPES = {'s', 'l', 'i', 'f', 'd'};
+
+struct ColumnSpec {
+    const char* name;
+    FieldPtr field;
+};
+
+std::vector<ColumnSpec> get_column_specs(dorado::SummaryData::FieldFlags fields) {
+    using dorado::SummaryData;
+    using dorado::SummaryRow;
+    std::vector<ColumnSpec> specs{{"filename", &SummaryRow::filename},
+                                  {"read_id", &SummaryRow::read_id}};
+    if (fields & SummaryData::GENERAL_FIELDS) {
+        specs.insert(specs.end(),
+                     {{"run_id", &SummaryRow::run_id},
+                      {"channel", &SummaryRow::channel},
+                      {"mux", &SummaryRow::mux},
+                      {"start_time", &SummaryRow::start_time},
+                      {"duration", &SummaryRow::duration},
+                      {"template_start", &SummaryRow::template_start},
+                      {"template_duration", &SummaryRow::template_duration},
+                      {"sequence_length_template", &SummaryRow::sequence_length},
+                      {"mean_qscore_template", &SummaryRow::mean_qscore}});
+    }
+    if (fields & SummaryData::BARCODING_FIELDS) {
+        specs.push_back({"barcode", &SummaryRow::barcode});
+    }
+    if (fields & SummaryData::ALIGNMENT_FIELDS) {
+        specs.insert(specs.end(),
+                     {{"alignment_genome", &SummaryRow::alignment_genome},
+                      {"alignment_genome_start", &SummaryRow::alignment_genome_start},
+                      {"alignment_genome_end", &SummaryRow::alignment_genome_end},
+                      {"alignment_strand_start", &SummaryRow::alignment_strand_start},
+                      {"alignment_strand_end", &SummaryRow::alignment_strand_end},
+                      {"alignment_direction", &SummaryRow::alignment_direction},
+                      {"alignment_length", &SummaryRow::alignment_length},
+                      {"alignment_num_aligned", &SummaryRow::alignment_num_aligned},
+                      {"alignment_num_correct", &SummaryRow::alignment_num_correct},
+                      {"alignment_num_insertions", &SummaryRow::alignment_num_insertions},
+                      {"alignment_num_deletions", &SummaryRow::alignment_num_deletions},
+                      {"alignment_num_substitutions", &SummaryRow::alignment_num_substitutions},
+                      {"alignment_mapq", &SummaryRow::alignment_mapq},
+                      {"alignment_strand_coverage", &SummaryRow::alignment_strand_coverage},
+                      {"alignment_identity", &SummaryRow::alignment_identity},
+                      {"alignment_accuracy", &SummaryRow::alignment_accuracy},
+                      {"alignment_bed_hits", &SummaryRow::alignment_bed_hits}});
+    }
+    return specs;
+}
+
+// The unsigned integer with the same size as T, for byte order conversion.
+template <typename T>
+using Bits = std::conditional_t<sizeof(T) == 2,
+                                uint16_t,
+                                std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+
+// Values are stored little-endian whatever the byte order of the host.
+template <typename T>
+void append_bytes(std::string& buffer, T value) {
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) == sizeof(Bits<T>));
+    Bits<T> bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::array<char, sizeof(T)> bytes;
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<char>(bits >> (8 * i));
+    }
+    buffer.append(bytes.data(), bytes.size());
+}
+
+template <typename T>
+T load_bytes(const char* data) {
+    Bits<T> bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bits |= static_cast<Bits<T>>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The 16 byte trailer compresses to a block well under this size.
+constexpr size_t MAX_TRAILER_BLOCK_SIZE = 256;
+// The empty block which ends every BGZF file.
+constexpr size_t BGZF_EOF_BLOCK_SIZE = 28;
+constexpr size_t BGZF_HEADER_SIZE = 18;
+
+// Returns the file offset of the trailer block, the last block before the empty one. Blocks can't
+// be found from the end of the file through BGZF, so the file's tail is searched for the header
+// of a block which ends where the empty block starts.
+uint64_t find_trailer_block(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    const auto file_size = static_cast<uint64_t>(file ? std::streamoff(file.tellg()) : 0);
+    const auto tail_size =
+            std::min<uint64_t>(file_size, MAX_TRAILER_BLOCK_SIZE + BGZF_EOF_BLOCK_SIZE);
+    std::string tail(tail_size, '\0');
+    file.seekg(static_cast<std::streamoff>(file_size - tail_size));
+    if (!file || !file.read(tail.data(), tail.size()) || tail_size < BGZF_EOF_BLOCK_SIZE) {
+        throw std::runtime_error("Could not read the end of summary columns file " + filename);
+    }
+
+    const size_t trailer_end = tail_size - BGZF_EOF_BLOCK_SIZE;
+    for (size_t block_size = BGZF_HEADER_SIZE; block_size <= trailer_end; ++block_size) {
+        const char* header = tail.data() + trailer_end - block_size;
+        if (std::memcmp(header, "\x1f\x8b\x08\x04", 4) == 0 && header[12] == 'B' &&
+            header[13] == 'C' && load_bytes<uint16_t>(header + 16) + size_t{1} == block_size) {
+            return file_size - tail_size + trailer_end - block_size;
+        }
+    }
+    throw std::runtime_error(filename + " has no summary columns trailer.");
+}
+
+size_t value_size(char type) {
+    switch (type) {
+    case 'l':
+    case 'd':
+        return 8;
+    case 'i':
+    case 'f':
+    case 's':
+        return 4;
+    default:
+        throw std::runtime_error(std::string("Unknown summary column type '") + type + "'.");
+    }
+}
+
+}  // namespace
+
+namespace dorado {
+
+struct SummaryColumnsWriter::Column {
+    FieldPtr field;
+    // Fixed size values of the rows in the current chunk, which for strings are their lengths.
+    std::string values;
+    // The concatenated strings of the rows in the current chunk.
+    std::string strings;
+};
+
+SummaryColumnsWriter::SummaryColumnsWriter(const std::string& filename,
+                                           SummaryData::FieldFlags fields,
+                                           int threads) {
+    const auto specs = get_column_specs(fields);
+    std::vector<std::string> names;
+    for (const auto& spec : specs) {
+        names.emplace_back(spec.name);
+    }
+    if (names != SummaryData::get_field_names(fields)) {
+        throw std::logic_error("Summary columns don't match the summary fields.");
+    }
+
+    m_file = bgzf_open(filename.c_str(), "w");
+    if (!m_file) {
+        throw std::runtime_error("Could not open summary columns file " + filename);
+    }
+    if (threads > 1 && bgzf_mt(m_file, threads, 256) < 0) {
+        bgzf_close(m_file);
+        throw std::runtime_error("Could not enable threads for summary columns file " + filename);
+    }
+
+    std::string header(MAGIC);
+    append_bytes(header, static_cast<uint32_t>(specs.size()));
+    for (const auto& spec : specs) {
+        const char type = FIELD_TYPES[spec.field.index()];
+        const auto name_length = static_cast<uint16_t>(std::strlen(spec.name));
+        header += type;
+        append_bytes(header, name_length);
+        header.append(spec.name, name_length);
+        auto& column = m_columns.emplace_back(Column{spec.field, {}, {}});
+        column.values.reserve(ROWS_PER_CHUNK * value_size(type));
+    }
+    write(header.data(), header.size());
+}
+
+SummaryColumnsWriter::~SummaryColumnsWriter() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        spdlog::error("{}", e.what());
+    }
+}
+
+void SummaryColumnsWriter::add_row(const SummaryRow& row) {
+    if (buffer_row(row)) {
+        flush();
+    }
+}
+
+void SummaryColumnsWriter::flush() { write_chunk(take_chunk()); }
+
+bool SummaryColumnsWriter::buffer_row(const SummaryRow& row) {
+    for (auto& column : m_columns) {
+        std::visit(
+                [&row, &column](auto field) {
+                    const auto& value = row.*field;
+                    if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string_view>) {
+                        if (value.size() > MAX_STRING_LENGTH) {
+                            throw std::runtime_error("Summary column value is too long.");
+                        }
+                        append_bytes(column.values, static_cast<uint32_t>(value.size()));
+                        column.strings += value;
+                    } else {
+                        append_bytes(column.values, value);
+                    }
+                },
+                column.field);
+    }
+    return ++m_num_chunk_rows == ROWS_PER_CHUNK;
+}
+
+std::string SummaryColumnsWriter::take_chunk() {
+    std::string chunk;
+    if (m_num_chunk_rows == 0) {
+        return chunk;
+    }
+    // The row count and the size of each column come first, so that write_chunk can start each
+    // column in a new block. Only the columns' data is written to the file.
+    size_t chunk_size = sizeof(m_num_chunk_rows) + m_columns.size() * sizeof(uint64_t);
+    for (const auto& column : m_columns) {
+        chunk_size += column.values.size() + column.strings.size();
+    }
+    chunk.reserve(chunk_size);
+    append_bytes(chunk, m_num_chunk_rows);
+    for (const auto& column : m_columns) {
+        append_bytes(chunk, static_cast<uint64_t>(column.values.size() + column.strings.size()));
+    }
+    for (auto& column : m_columns) {
+        chunk += column.values;
+        chunk += column.strings;
+        column.values.clear();
+        column.strings.clear();
+    }
+    m_num_chunk_rows = 0;
+    return chunk;
+}
+
+void SummaryColumnsWriter::write_chunk(const std::string& chunk) {
+    if (chunk.empty()) {
+        return;
+    }
+    const auto num_rows = load_bytes<uint32_t>(chunk.data());
+    append_bytes(m_footer, num_rows);
+    const char* column_sizes = chunk.data() + sizeof(num_rows);
+    const char* column_data = column_sizes + m_columns.size() * sizeof(uint64_t);
+    for (size_t i = 0; i < m_columns.size(); ++i) {
+        const auto size = load_bytes<uint64_t>(column_sizes + i * sizeof(uint64_t));
+        append_bytes(m_footer, start_block());
+        write(column_data, size);
+        column_data += size;
+    }
+    ++m_num_chunks;
+    m_num_rows_written += num_rows;
+}
+
+void SummaryColumnsWriter::close() {
+    if (!m_file) {
+        return;
+    }
+    flush();
+    const auto footer_offset = start_block();
+    std::string num_chunks;
+    append_bytes(num_chunks, m_num_chunks);
+    write(num_chunks.data(), num_chunks.size());
+    write(m_footer.data(), m_footer.size());
+
+    // The trailer gets a block of its own, which closing the file ends.
+    start_block();
+    std::string trailer;
+    append_bytes(trailer, footer_offset);
+    trailer += END_MAGIC;
+    write(trailer.data(), trailer.size());
+    auto file = std::exchange(m_file, nullptr);
+    if (bgzf_close(file) < 0) {
+        throw std::runtime_error("Could not close summary columns file.");
+    }
+}
+
+void SummaryColumnsWriter::write(const void* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    const auto written = bgzf_write(m_file, data, size);
+    if (written < 0 || static_cast<size_t>(written) != size) {
+        throw std::runtime_error("Could not write to summary columns file.");
+    }
+}
+
+uint64_t SummaryColumnsWriter::start_block() {
+    if (bgzf_flush(m_file) < 0) {
+        throw std::runtime_error("Could not write to summary columns file.");
+    }
+    return static_cast<uint64_t>(bgzf_tell(m_file));
+}
+
+SummaryColumnsReader::SummaryColumnsReader(const std::string& filename) {
+    m_file = bgzf_open(filename.c_str(), "r");
+    if (!m_file) {
+        throw std::runtime_error("Could not open summary columns file " + filename);
+    }
+
+    std::string magic(MAGIC.size(), '\0');
+    read(magic.data(), magic.size());
+    if (magic != MAGIC) {
+        throw std::runtime_error(filename + " is not a summary columns file.");
+    }
+    const auto num_columns = read_value<uint32_t>();
+    if (num_columns > MAX_COLUMNS) {
+        throw std::runtime_error(filename + " has too many summary columns.");
+    }
+    m_columns.resize(num_columns);
+    for (auto& column : m_columns) {
+        read(&column.type, sizeof(column.type));
+        // Throws for types this reader doesn't know.
+        value_size(column.type);
+        const auto name_length = read_value<uint16_t>();
+        column.name.resize(name_length);
+        read(column.name.data(), name_length);
+    }
+    m_selected.assign(m_columns.size(), true);
+    read_footer(filename);
+}
+
+void SummaryColumnsReader::read_footer(const std::string& filename) {
+    seek(find_trailer_block(filename) << 16);
+    const auto footer_offset = read_value<uint64_t>();
+    std::string end_magic(END_MAGIC.size(), '\0');
+    read(end_magic.data(), end_magic.size());
+    if (end_magic != END_MAGIC) {
+        throw std::runtime_error(filename + " has no summary columns trailer.");
+    }
+
+    seek(footer_offset);
+    const auto num_chunks = read_value<uint32_t>();
+    for (uint32_t i = 0; i < num_chunks; ++i) {
+        auto& chunk = m_chunks.emplace_back();
+        chunk.num_rows = read_value<uint32_t>();
+        if (chunk.num_rows > SummaryColumnsWriter::ROWS_PER_CHUNK) {
+            throw std::runtime_error("Summary columns chunk has " +
+                                     std::to_string(chunk.num_rows) +
+                                     " rows, more than the maximum of " +
+                                     std::to_string(SummaryColumnsWriter::ROWS_PER_CHUNK) + ".");
+        }
+        chunk.column_offsets.resize(m_columns.size());
+        for (auto& offset : chunk.column_offsets) {
+            offset = read_value<uint64_t>();
+        }
+    }
+}
+
+SummaryColumnsReader::~SummaryColumnsReader() {
+    if (m_file) {
+        bgzf_close(m_file);
+    }
+}
+
+void SummaryColumnsReader::select_columns(const std::vector<std::string>& names) {
+    std::vector<bool> selected(m_columns.size(), false);
+    for (const auto& name : names) {
+        auto column = std::find_if(m_columns.begin(), m_columns.end(),
+                                   [&name](const Column& c) { return c.name == name; });
+        if (column == m_columns.end()) {
+            throw std::runtime_error("There is no summary column named " + name);
+        }
+        selected[column - m_columns.begin()] = true;
+    }
+    m_selected = std::move(selected);
+}
+
+size_t SummaryColumnsReader::read_chunk() {
+    if (m_next_chunk == m_chunks.size()) {
+        return 0;
+    }
+    const auto& chunk = m_chunks[m_next_chunk++];
+    const auto num_rows = chunk.num_rows;
+    for (size_t column_index = 0; column_index < m_columns.size(); ++column_index) {
+        auto& column = m_columns[column_index];
+        column.ints.clear();
+        column.reals.clear();
+        column.strings.clear();
+        if (!m_selected[column_index]) {
+            continue;
+        }
+
+        seek(chunk.column_offsets[column_index]);
+        m_buffer.resize(num_rows * value_size(column.type));
+        read(m_buffer.data(), m_buffer.size());
+        auto get_values = [this, num_rows](auto& values, auto type_tag) {
+            using T = decltype(type_tag);
+            values.resize(num_rows);
+            for (uint32_t i = 0; i < num_rows; ++i) {
+                values[i] = load_bytes<T>(m_buffer.data() + i * sizeof(T));
+            }
+        };
+        switch (column.type) {
+        case 'l':
+            get_values(column.ints, int64_t{});
+            break;
+        case 'i':
+            get_values(column.ints, int32_t{});
+            break;
+        case 'f':
+            get_values(column.reals, float{});
+            break;
+        case 'd':
+            get_values(column.reals, double{});
+            break;
+        case 's': {
+            std::vector<size_t> lengths;
+            get_values(lengths, uint32_t{});
+            // Each string is read as it's allocated, so a corrupt length can't allocate much
+            // more than the file holds.
+            column.strings.reserve(num_rows);
+            for (auto length : lengths) {
+                if (length > SummaryColumnsWriter::MAX_STRING_LENGTH) {
+                    throw std::runtime_error("Summary columns string of " +
+                                             std::to_string(length) + " bytes is too long.");
+                }
+                auto& value = column.strings.emplace_back(length, '\0');
+                read(value.data(), length);
+            }
+            break;
+        }
+        }
+    }
+    return num_rows;
+}
+
+template <typename T>
+T SummaryColumnsReader::read_value() {
+    std::array<char, sizeof(T)> bytes;
+    read(bytes.data(), bytes.size());
+    return load_bytes<T>(bytes.data());
+}
+
+void SummaryColumnsReader::seek(uint64_t offset) {
+    if (bgzf_seek(m_file, static_cast<int64_t>(offset), SEEK_SET) < 0) {
+        throw std::runtime_error("Summary columns file is corrupt.");
+    }
+}
+
+void SummaryColumnsReader::read(void* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    const auto num_read = bgzf_read(m_file, data, size);
+    if (num_read < 0 || static_cast<size_t>(num_read) != size) {
+        throw std::runtime_error("Summary columns file is truncated.");
+    }
+}
+
+}  // namespace dorado
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "summary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct BGZF;
+
+namespace dorado {
+
+/// Writes sequencing summary rows in a columnar binary format, which is much quicker to write
+/// and to load for analysis than the text summary when a run has many millions of reads.
+///
+/// The file is BGZF compressed, so it can be decompressed with bgzip. Decompressed it holds:
+///   - the magic bytes "DSUMCOL2"
+///   - a uint32 column count, then for each column a type byte and a uint16 length-prefixed name
+///   - chunks of up to ROWS_PER_CHUNK rows, each holding every column's values in turn
+///   - a footer: a uint32 chunk count, then for each chunk a uint32 row count and the uint64
+///     BGZF virtual offset of each of its columns
+///   - a trailer: the uint64 virtual offset of the footer and the magic bytes "DSUMEND2"
+/// Each column of a chunk starts a new BGZF block, so a reader can seek to just the columns it
+/// needs. The trailer is a block of its own, so it can be found from the end of the file.
+/// Column types are 'l' (int64), 'i' (int32), 'f' (float32), 'd' (float64) and 's' (strings,
+/// stored as a uint32 length per row followed by the concatenated bytes). All values, including
+/// the counts and lengths, are encoded little-endian whatever the host's byte order. Columns are
+/// named and ordered as in the text summary.
+class SummaryColumnsWriter {
+public:
+    static constexpr uint32_t ROWS_PER_CHUNK = 1 << 16;
+    // Longer strings are rejected, so that the reader can reject corrupt lengths.
+    static constexpr uint32_t MAX_STRING_LENGTH = 1 << 20;
+
+    SummaryColumnsWriter(const std::string& filename, SummaryData::FieldFlags fields, int threads);
+    ~SummaryColumnsWriter();
+
+    /// Buffers a row, writing out the chunk once it's full.
+    void add_row(const SummaryRow& row);
+    /// Writes out the buffered rows.
+    void flush();
+    /// Flushes and ends the file. The destructor does this if it hasn't been called.
+    void close();
+
+    /// Buffers a row, returning true once the chunk is full. Together with take_chunk and
+    /// write_chunk this lets rows be encoded on one thread and written on another.
+    bool buffer_row(const SummaryRow& row);
+    /// Moves the buffered rows out as an encoded chunk, which is empty if there are none.
+    std::string take_chunk();
+    void write_chunk(const std::string& chunk);
+
+    size_t num_rows_written() const { return m_num_rows_written; }
+
+private:
+    struct Column;
+
+    BGZF* m_file{nullptr};
+    std::vector<Column> m_columns;
+    uint32_t m_num_chunk_rows{0};
+    size_t m_num_rows_written{0};
+    // The footer's entries for the chunks written so far.
+    uint32_t m_num_chunks{0};
+    std::string m_footer;
+
+    void write(const void* data, size_t size);
+    // Ends the current BGZF block, returning the virtual offset of the next one.
+    uint64_t start_block();
+};
+
+/// Reads a file written by SummaryColumnsWriter, a chunk of rows at a time. Only the selected
+/// columns are read, which is all of them unless select_columns is called.
+class SummaryColumnsReader {
+public:
+    struct Column {
+        std::string name;
+        char type;
+        // The values of the current chunk, held in the vector for the column's type.
+        std::vector<int64_t> ints;
+        std::vector<double> reals;
+        std::vector<std::string> strings;
+    };
+
+    explicit SummaryColumnsReader(const std::string& filename);
+    ~SummaryColumnsReader();
+
+    const std::vector<Column>& columns() const { return m_columns; }
+    size_t num_chunks() const { return m_chunks.size(); }
+
+    /// Reads only the named columns from now on, leaving the others empty. Throws if a column
+    /// doesn't exist.
+    void select_columns(const std::vector<std::string>& names);
+
+    /// Reads the next chunk into the columns, returning its number of rows, or 0 at the end.
+    size_t read_chunk();
+
+private:
+    struct Chunk {
+        uint32_t num_rows;
+        std::vector<uint64_t> column_offsets;
+    };
+
+    BGZF* m_file{nullptr};
+    std::vector<Column> m_columns;
+    std::vector<bool> m_selected;
+    std::vector<Chunk> m_chunks;
+    size_t m_next_chunk{0};
+    std::string m_buffer;
+
+    void read_footer(const std::string& filename);
+    void seek(uint64_t offset);
+    void read(void* data, size_t size);
+    template <typename T>
+    T read_value();
+};
+
+}  // namespace dorado
@@ -5,10 +5,13 @@
 #include <torch/csrc/jit/serialization/pickle.h>
 #include <torch/torch.h>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
 namespace {
@@ -177,6 +180,100 @@ void copy_tensor_elems(at::Tensor& dest_tensor,
     }
 }
 
+namespace {
+
+// Fills `row` of `length` elements by repeating its first `count` elements.
+template <typename T>
+void repeat_pad_row(T* const row, std::size_t count, std::size_t length) {
+    std::size_t filled = count;
+    while (filled < length) {
+        // `filled` is a multiple of `count` until the final copy, so copying from the start of
+        // the row preserves the repeat pattern.
+        const std::size_t num_to_copy = std::min(filled, length - filled);
+        std::memcpy(&row[filled], row, num_to_copy * sizeof(T));
+        filled += num_to_copy;
+    }
+}
+
+template <typename DestT, typename SrcT>
+void copy_chunk_to_batch_row_impl(DestT* const dest,
+                                  const SrcT* const src,
+                                  std::size_t num_channels,
+                                  std::size_t dest_length,
+                                  std::size_t src_length,
+                                  std::size_t src_offset,
+                                  std::size_t count) {
+    for (std::size_t c = 0; c < num_channels; ++c) {
+        DestT* const dest_row = &dest[c * dest_length];
+        const SrcT* const src_row = &src[c * src_length + src_offset];
+        if constexpr (std::is_same_v<DestT, SrcT>) {
+            std::memcpy(dest_row, src_row, count * sizeof(DestT));
+        } else if constexpr (std::is_same_v<DestT, c10::Half> && std::is_same_v<SrcT, float>) {
+            convert_f32_to_f16_impl(dest_row, src_row, count);
+        } else {
+            for (std::size_t i = 0; i < count; ++i) {
+                dest_row[i] = static_cast<DestT>(src_row[i]);
+            }
+        }
+        repeat_pad_row(dest_row, count, dest_length);
+    }
+}
+
+}  // namespace
+
+void copy_chunk_to_batch_row(at::Tensor& dest_tensor,
+                             std::size_t dest_row,
+                             const at::Tensor& src_tensor,
+                             std::size_t src_offset) {
+    assert(dest_tensor.dim() == 3);
+    const std::size_t num_channels = dest_tensor.size(1);
+    const std::size_t dest_length = dest_tensor.size(2);
+    const std::size_t src_length = src_tensor.size(-1);
+    assert(dest_row < std::size_t(dest_tensor.size(0)));
+    assert(std::size_t(src_tensor.numel()) == num_channels * src_length);
+    assert(src_offset < src_length);
+    const std::size_t count = std::min(dest_length, src_length - src_offset);
+
+    const bool can_copy_directly = dest_tensor.is_contiguous() && src_tensor.is_contiguous() &&
+                                   dest_tensor.is_cpu() && src_tensor.is_cpu();
+    const auto dest_dtype = dest_tensor.scalar_type();
+    const auto src_dtype = src_tensor.scalar_type();
+    auto is_supported_dtype = [](at::ScalarType dtype) {
+        return dtype == at::ScalarType::Half || dtype == at::ScalarType::Float;
+    };
+
+    if (can_copy_directly && is_supported_dtype(dest_dtype) && is_supported_dtype(src_dtype)) {
+        const std::size_t dest_row_offset = dest_row * num_channels * dest_length;
+        auto copy = [&](auto* dest, const auto* src) {
+            copy_chunk_to_batch_row_impl(&dest[dest_row_offset], src, num_channels, dest_length,
+                                         src_length, src_offset, count);
+        };
+        if (dest_dtype == at::ScalarType::Half && src_dtype == at::ScalarType::Half) {
+            copy(dest_tensor.data_ptr<c10::Half>(), src_tensor.data_ptr<c10::Half>());
+        } else if (dest_dtype == at::ScalarType::Half) {
+            copy(dest_tensor.data_ptr<c10::Half>(), src_tensor.data_ptr<float>());
+        } else if (src_dtype == at::ScalarType::Half) {
+            copy(dest_tensor.data_ptr<float>(), src_tensor.data_ptr<c10::Half>());
+        } else {
+            copy(dest_tensor.data_ptr<float>(), src_tensor.data_ptr<float>());
+        }
+        return;
+    }
+
+    // Slow fallback path for other layouts, devices and dtypes.
+    using at::indexing::Ellipsis;
+    using at::indexing::Slice;
+    auto chunk = src_tensor.index({Ellipsis, Slice(src_offset, src_offset + count)});
+    if (chunk.dim() == 1) {
+        chunk = chunk.unsqueeze(0);
+    }
+    if (count != dest_length) {
+        auto [n, overhang] = std::div(int(dest_length), int(count));
+        chunk = at::concat({chunk.repeat({1, n}), chunk.index({Ellipsis, Slice(0, overhang)})}, 1);
+    }
+    dest_tensor.index_put_({int64_t(dest_row), Ellipsis}, chunk);
+}
+
 ScaledTensor quantize_tensor(const at::Tensor& t, int dim) {
     auto fp_range = t.abs().amax(dim);
     constexpr int levels = 256;
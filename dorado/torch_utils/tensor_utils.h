@@ -37,6 +37,15 @@ void copy_tensor_elems(at::Tensor& dest_tensor,
                        std::size_t src_offset,
                        std::size_t count);
 
+// Copies the chunk of the signal `src_tensor` (CT, or T for a single channel) starting at sample
+// `src_offset` into row `dest_row` of the NCT batch tensor `dest_tensor`.  If the signal ends
+// before the row is full the copied samples are repeated to pad it.  The copy goes straight into
+// the batch without intermediate tensors when both are contiguous CPU tensors.
+void copy_chunk_to_batch_row(at::Tensor& dest_tensor,
+                             std::size_t dest_row,
+                             const at::Tensor& src_tensor,
+                             std::size_t src_offset);
+
 struct ScaledTensor {
     at::Tensor t;
     at::Tensor scale;
@@ -66,27 +66,35 @@ std::vector<uint8_t> trim_quality(const std::vector<uint8_t>& qual,
 
 std::tuple<int, std::vector<uint8_t>> trim_move_table(const std::vector<uint8_t>& move_vals,
                                                       const std::pair<int, int>& trim_interval) {
-    std::vector<uint8_t> trimmed_moves;
-    int num_positions_trimmed = 0;
-    if (!move_vals.empty() && (trim_interval.second > trim_interval.first)) {
+    const auto trimmed = find_trimmed_moves(move_vals.data(), move_vals.size(), trim_interval);
+    const auto first = move_vals.begin() + trimmed.first;
+    return {trimmed.positions_trimmed, std::vector<uint8_t>(first, first + trimmed.size)};
+}
+
+TrimmedMoves find_trimmed_moves(const uint8_t* move_vals,
+                                size_t num_moves,
+                                const std::pair<int, int>& trim_interval) {
+    TrimmedMoves trimmed;
+    if (num_moves > 0 && (trim_interval.second > trim_interval.first)) {
         // Start with -1 because as soon as the first move_val==1 is encountered,
         // we have moved to the first base.
         int seq_base_pos = -1;
-        for (int i = 0; i < int(move_vals.size()); i++) {
-            auto mv = move_vals[i];
-            if (mv == 1) {
+        for (size_t i = 0; i < num_moves; i++) {
+            if (move_vals[i] == 1) {
                 seq_base_pos++;
             }
             if (seq_base_pos >= trim_interval.second) {
                 break;
             } else if (seq_base_pos >= trim_interval.first) {
-                trimmed_moves.push_back(mv);
+                if (trimmed.size++ == 0) {
+                    trimmed.first = i;
+                }
             } else {
-                num_positions_trimmed++;
+                trimmed.positions_trimmed++;
             }
         }
     }
-    return {num_positions_trimmed, trimmed_moves};
+    return trimmed;
 }
 
 std::tuple<std::string, std::vector<uint8_t>> trim_modbase_info(
@@ -24,6 +24,18 @@ std::vector<uint8_t> trim_quality(const std::vector<uint8_t>& qual,
 std::tuple<int, std::vector<uint8_t>> trim_move_table(const std::vector<uint8_t>& move_vals,
                                                       const std::pair<int, int>& trim_interval);
 
+// The part of a move table kept by trimming, which is always a contiguous run of moves.
+struct TrimmedMoves {
+    int positions_trimmed = 0;
+    size_t first = 0;
+    size_t size = 0;
+};
+
+// As trim_move_table, but finds the moves to keep without copying them.
+TrimmedMoves find_trimmed_moves(const uint8_t* move_vals,
+                                size_t num_moves,
+                                const std::pair<int, int>& trim_interval);
+
 // Trim the mod base info. The interval defines the portion of the read to keep.
 // Returns trimmed mod base bam tag string and the mod base probabilities vector.
 std::tuple<std::string, std::vector<uint8_t>> trim_modbase_info(
@@ -8,6 +8,7 @@
 #include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace dorado::utils {
 
@@ -138,6 +139,41 @@ public:
         return AsyncQueueStatus::Success;
     }
 
+    // Adds the items to the queue in order, taking the lock once for as many items as there
+    // is space for and blocking whenever the queue is full.
+    // If terminate() is called, returns AsyncQueueStatus::Terminate and the items which had
+    // not yet been added are discarded.
+    AsyncQueueStatus try_push_n(std::vector<Item>&& items) {
+        auto item_it = items.begin();
+        while (item_it != items.end()) {
+            std::unique_lock lock(m_mutex);
+            m_not_full_cv.wait(lock,
+                               [this] { return m_items.size() < m_capacity || m_terminate; });
+            if (m_terminate) {
+                items.clear();
+                return AsyncQueueStatus::Terminate;
+            }
+
+            size_t num_pushed = 0;
+            while (item_it != items.end() && m_items.size() < m_capacity) {
+                m_items.push(std::move(*item_it));
+                ++item_it;
+                ++num_pushed;
+            }
+            m_num_pushes += num_pushed;
+
+            // Inform waiting threads that there are now items available.
+            lock.unlock();
+            if (num_pushed > 1) {
+                m_not_empty_cv.notify_all();
+            } else {
+                m_not_empty_cv.notify_one();
+            }
+        }
+        items.clear();
+        return AsyncQueueStatus::Success;
+    }
+
     // Obtains the next item in the queue, potentially timing out.
     // If queue is empty:
     // If timeout is reached, but we are not terminating, returns AsyncQueueStatus::Timeout.
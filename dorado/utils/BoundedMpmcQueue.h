@@ -0,0 +1,385 @@
+#pragma once
+
+#include "AsyncQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+// Padding of the cache line aligned members is intentional.
+#pragma warning(push)
+#pragma warning(disable : 4324)
+#endif  // _WIN32
+
+namespace dorado::utils {
+
+// Bounded multi-producer/multi-consumer queue with the same push/pop/terminate/restart
+// semantics as AsyncQueue.
+// Items are held in a ring buffer of slots, each with its own sequence number, so that
+// producers and consumers only contend on an atomic position counter rather than a mutex.
+// Threads only fall back to waiting on a condition variable when the queue is full (pushes)
+// or empty (pops), and only then do the other side's operations have to take a lock to
+// notify them.
+// Items must be movable.
+template <class Item>
+class BoundedMpmcQueue {
+    static constexpr size_t kCacheLineSize = 64;
+    // Number of times a blocked push/pop retries before waiting on a condition variable.
+    static constexpr int kSpinCount = 16;
+
+    struct alignas(kCacheLineSize) Slot {
+        // Equals the push position this slot can next be written at, or that position + 1
+        // once an item has been written and can be popped.
+        // Accesses are sequentially consistent so that, together with the waiting counts,
+        // a thread about to wait can't miss the slot changing state (see wake_waiters).
+        std::atomic<uint64_t> sequence{0};
+        std::optional<Item> item;
+    };
+
+    const size_t m_capacity;
+    // A slot's "written" sequence would collide with the next lap's push position if there
+    // were only one slot, so there are always at least two, and pushes also check the item
+    // count when that makes the ring bigger than the capacity.
+    const size_t m_num_slots;
+    std::unique_ptr<Slot[]> m_slots;
+
+    // Positions of the next push and pop.  These only ever increase, so also act as the
+    // push and pop counts for stats.
+    alignas(kCacheLineSize) std::atomic<uint64_t> m_push_pos{0};
+    alignas(kCacheLineSize) std::atomic<uint64_t> m_pop_pos{0};
+
+    // If true, waits should terminate regardless of other state.
+    // Pending attempts to push or pop items will fail.
+    alignas(kCacheLineSize) std::atomic<bool> m_terminate{false};
+
+    // Slow path for threads which have to wait for space or items.
+    // The waiting counts let the fast path skip the lock when nobody is waiting.
+    std::mutex m_wait_mutex;
+    std::condition_variable m_not_full_cv;
+    std::condition_variable m_not_empty_cv;
+    std::atomic<int> m_num_waiting_pushers{0};
+    std::atomic<int> m_num_waiting_poppers{0};
+
+    // Attempts to add the item without blocking.  The item is only moved from on success.
+    bool try_enqueue(Item& item) {
+        uint64_t pos = m_push_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[pos % m_num_slots];
+            const uint64_t sequence = slot.sequence.load();
+            const auto diff = static_cast<int64_t>(sequence - pos);
+            if (diff == 0) {
+                // This load and the pop position update are sequentially consistent, like the
+                // slot sequences, so a pusher about to wait can't miss a pop (see wake_waiters).
+                if (m_num_slots != m_capacity && pos - m_pop_pos.load() >= m_capacity) {
+                    return false;
+                }
+                if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.item.emplace(std::move(item));
+                    slot.sequence.store(pos + 1);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The slot still holds an item from the previous lap: we're full.
+                return false;
+            } else {
+                pos = m_push_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Attempts to remove the next item without blocking.
+    bool try_dequeue(Item& item) {
+        uint64_t pos = m_pop_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[pos % m_num_slots];
+            const uint64_t sequence = slot.sequence.load();
+            const auto diff = static_cast<int64_t>(sequence - (pos + 1));
+            if (diff == 0) {
+                if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed)) {
+                    item = std::move(*slot.item);
+                    slot.item.reset();
+                    slot.sequence.store(pos + m_num_slots);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // Nothing has been written to this slot yet: we're empty.
+                return false;
+            } else {
+                pos = m_pop_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // True if every item that has been pushed has also been popped.
+    bool is_drained() const {
+        return m_pop_pos.load(std::memory_order_acquire) >=
+               m_push_pos.load(std::memory_order_acquire);
+    }
+
+    // Wakes threads waiting on cv, if there are any.
+    void wake_waiters(std::atomic<int>& num_waiting, std::condition_variable& cv, bool all) {
+        // The slot update made before this call and this load, and the waiter's increment and
+        // its subsequent slot load, are all sequentially consistent: either the waiter sees
+        // the slot update, or we see that it's waiting.
+        if (num_waiting.load() == 0) {
+            return;
+        }
+        // Taking the lock ensures the waiter is either yet to check its predicate or is
+        // inside the wait, so the notification can't be lost.
+        { std::lock_guard lock(m_wait_mutex); }
+        if (all) {
+            cv.notify_all();
+        } else {
+            cv.notify_one();
+        }
+    }
+
+    // Calls try_fn until it returns true, spinning briefly before waiting on cv.
+    // If timeout_time is given and passes first, returns false.
+    template <class TryFn, class Clock, class Duration>
+    bool wait_until_done(TryFn try_fn,
+                         std::atomic<int>& num_waiting,
+                         std::condition_variable& cv,
+                         const std::chrono::time_point<Clock, Duration>* timeout_time) {
+        for (int i = 0; i < kSpinCount; ++i) {
+            if (try_fn()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock lock(m_wait_mutex);
+        num_waiting.fetch_add(1);
+        bool done = true;
+        if (timeout_time) {
+            done = cv.wait_until(lock, *timeout_time, try_fn);
+        } else {
+            cv.wait(lock, try_fn);
+        }
+        num_waiting.fetch_sub(1);
+        return done;
+    }
+
+    AsyncQueueStatus push_impl(Item& item) {
+        bool pushed = false;
+        auto try_push_fn = [this, &item, &pushed] {
+            if (m_terminate.load(std::memory_order_acquire)) {
+                return true;
+            }
+            pushed = try_enqueue(item);
+            return pushed;
+        };
+        const std::chrono::steady_clock::time_point* no_timeout = nullptr;
+        wait_until_done(try_push_fn, m_num_waiting_pushers, m_not_full_cv, no_timeout);
+        return pushed ? AsyncQueueStatus::Success : AsyncQueueStatus::Terminate;
+    }
+
+    template <class Clock, class Duration>
+    AsyncQueueStatus pop_impl(Item& item,
+                              const std::chrono::time_point<Clock, Duration>* timeout_time) {
+        bool popped = false;
+        auto try_pop_fn = [this, &item, &popped] {
+            popped = try_dequeue(item);
+            // Termination takes effect once all items have been popped from the queue.
+            return popped || (m_terminate.load(std::memory_order_acquire) && is_drained());
+        };
+        if (!wait_until_done(try_pop_fn, m_num_waiting_poppers, m_not_empty_cv, timeout_time)) {
+            return AsyncQueueStatus::Timeout;
+        }
+        if (!popped) {
+            return AsyncQueueStatus::Terminate;
+        }
+        wake_waiters(m_num_waiting_pushers, m_not_full_cv, false);
+        return AsyncQueueStatus::Success;
+    }
+
+    // Pops the first item via pop_impl, then up to max_count - 1 more without blocking,
+    // calling process_fn on each.
+    template <class ProcessFn, class Clock, class Duration>
+    AsyncQueueStatus process_items(ProcessFn& process_fn,
+                                   size_t max_count,
+                                   const std::chrono::time_point<Clock, Duration>* timeout_time) {
+        assert(max_count > 0);
+        Item item;
+        const auto status = pop_impl(item, timeout_time);
+        if (status != AsyncQueueStatus::Success) {
+            return status;
+        }
+        process_fn(std::move(item));
+        size_t num_popped = 1;
+        while (num_popped < max_count && try_dequeue(item)) {
+            process_fn(std::move(item));
+            ++num_popped;
+        }
+        if (num_popped > 1) {
+            // In general we have removed > 1 item and there can be > 1 thread waiting to push.
+            wake_waiters(m_num_waiting_pushers, m_not_full_cv, true);
+        }
+        return AsyncQueueStatus::Success;
+    }
+
+public:
+    // Attempts to push items beyond capacity will block.
+    explicit BoundedMpmcQueue(size_t capacity)
+            : m_capacity(capacity),
+              m_num_slots(std::max(capacity, size_t{2})),
+              m_slots(std::make_unique<Slot[]>(m_num_slots)) {
+        assert(m_capacity > 0);
+        for (size_t i = 0; i < m_num_slots; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedMpmcQueue() {
+        // Ensure waits terminate before destruction.
+        terminate();
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue(BoundedMpmcQueue&&) = delete;
+    BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue& operator=(BoundedMpmcQueue&&) = delete;
+
+    // Attempts to add an item to the queue.
+    // If the queue is full, blocks until there is space or terminate() is called.
+    // Returns AsyncQueueStatus::Success if the item was added, or AsyncQueueStatus::Terminate
+    // if terminate() was called, in which case the item is not added.
+    // Items pushed must be rvalues, since we assume sole ownership.
+    AsyncQueueStatus try_push(Item&& item) {
+        const auto status = push_impl(item);
+        if (status == AsyncQueueStatus::Success) {
+            wake_waiters(m_num_waiting_poppers, m_not_empty_cv, false);
+        }
+        return status;
+    }
+
+    // Adds the items to the queue in order, blocking whenever it is full.
+    // Waiting consumers are notified once for the whole batch rather than once per item.
+    // If terminate() is called, returns AsyncQueueStatus::Terminate and the items which had
+    // not yet been added are discarded.
+    AsyncQueueStatus try_push_n(std::vector<Item>&& items) {
+        auto status = AsyncQueueStatus::Success;
+        size_t num_unannounced = 0;
+        for (auto& item : items) {
+            if (m_terminate.load(std::memory_order_acquire)) {
+                status = AsyncQueueStatus::Terminate;
+                break;
+            }
+            if (try_enqueue(item)) {
+                ++num_unannounced;
+                continue;
+            }
+            // We're full: make sure consumers know about what we've added before blocking.
+            if (num_unannounced > 0) {
+                wake_waiters(m_num_waiting_poppers, m_not_empty_cv, true);
+                num_unannounced = 0;
+            }
+            status = push_impl(item);
+            if (status != AsyncQueueStatus::Success) {
+                break;
+            }
+            ++num_unannounced;
+        }
+        if (num_unannounced > 0) {
+            wake_waiters(m_num_waiting_poppers, m_not_empty_cv, num_unannounced > 1);
+        }
+        items.clear();
+        return status;
+    }
+
+    // Obtains the next item in the queue, potentially timing out.
+    // If queue is empty:
+    // If timeout is reached, but we are not terminating, returns AsyncQueueStatus::Timeout.
+    // If we are terminating, returns AsyncQueueStatus::Terminate.
+    // Otherwise block until an item is added.
+    template <class Clock, class Duration>
+    AsyncQueueStatus try_pop_until(Item& item,
+                                   const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        return pop_impl(item, &timeout_time);
+    }
+
+    // Obtains the next item in the queue.
+    // If queue is empty:
+    // If we are terminating, returns AsyncQueueStatus::Terminate.
+    // Otherwise block until an item is added, upon which AsyncQueueStatus::Success
+    // is returned.
+    AsyncQueueStatus try_pop(Item& item) {
+        const std::chrono::steady_clock::time_point* no_timeout = nullptr;
+        return pop_impl(item, no_timeout);
+    }
+
+    // Waits for an item as try_pop does, then pops up to max_count items that are available
+    // without blocking, calling process_fn on each.
+    template <class ProcessFn>
+    AsyncQueueStatus process_and_pop_n(ProcessFn process_fn, size_t max_count) {
+        const std::chrono::steady_clock::time_point* no_timeout = nullptr;
+        return process_items(process_fn, max_count, no_timeout);
+    }
+
+    // Like process_and_pop_n, except it also has a timeout.  If the queue is empty
+    // and we time out before an item is added, returns AsyncQueueStatus::Timeout.
+    template <class ProcessFn, class Clock, class Duration>
+    AsyncQueueStatus process_and_pop_n_with_timeout(
+            ProcessFn process_fn,
+            size_t max_count,
+            const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        return process_items(process_fn, max_count, &timeout_time);
+    }
+
+    // Tells the queue to terminate any waits.
+    // Pushes will fail and return AsyncQueueStatus::Terminate until restart is called.
+    // Pops will return AsyncQueueStatus::Terminate once the queue is empty.
+    void terminate() {
+        {
+            std::lock_guard lock(m_wait_mutex);
+            m_terminate.store(true, std::memory_order_release);
+        }
+        m_not_full_cv.notify_all();
+        m_not_empty_cv.notify_all();
+    }
+
+    // Resets state to active following a terminate call.
+    void restart() {
+        std::lock_guard lock(m_wait_mutex);
+        m_terminate.store(false, std::memory_order_release);
+    }
+
+    // Maximum number of items the queue can contain.
+    size_t capacity() const { return m_capacity; }
+
+    // Current number of items in the queue.  Only useful for stats sampling and
+    // testing.
+    size_t size() const {
+        const auto pop_pos = m_pop_pos.load(std::memory_order_acquire);
+        const auto push_pos = m_push_pos.load(std::memory_order_acquire);
+        return push_pos > pop_pos ? std::min(size_t(push_pos - pop_pos), m_capacity) : 0;
+    }
+
+    std::string get_name() const { return "queue"; }
+
+    std::unordered_map<std::string, double> sample_stats() const {
+        std::unordered_map<std::string, double> stats;
+        stats["items"] = double(size());
+        stats["pushes"] = double(m_push_pos.load(std::memory_order_relaxed));
+        stats["pops"] = double(m_pop_pos.load(std::memory_order_relaxed));
+        return stats;
+    }
+};
+
+}  // namespace dorado::utils
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif  // _WIN32
@@ -0,0 +1,172 @@
+#include "bam_pool.h"
+
+#include <htslib/sam.h>
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// The pool is never destroyed, so whatever it holds stays allocated until the process exits.
+// At worst that is MAX_SHARED_BYTES in the shared pool, plus 2 * BATCH_SIZE records of up to
+// MAX_RETAINED_DATA, i.e. 4 MiB, in the cache of each thread which has released records.
+
+// Records are passed between a thread's cache and the shared pool in batches of this size.
+constexpr size_t BATCH_SIZE = 32;
+// Bytes of records, including their data buffers, held by the shared pool. Batches which
+// would take it over this are freed.
+constexpr size_t MAX_SHARED_BYTES = 64 * 1024 * 1024;
+// Records with larger data buffers are freed rather than recycled.
+constexpr uint32_t MAX_RETAINED_DATA = 64 * 1024;
+
+struct PoolStats {
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> recycled{0};
+    std::atomic<size_t> freed{0};
+};
+
+struct Batch {
+    std::vector<bam1_t*> records;
+    size_t num_bytes{0};
+};
+
+struct SharedPool {
+    std::mutex mutex;
+    std::vector<Batch> batches;
+    size_t num_bytes{0};
+    PoolStats stats;
+};
+
+// Deliberately never destroyed, since records can be released during static destruction.
+SharedPool& shared_pool() {
+    static auto* pool = new SharedPool();
+    return *pool;
+}
+
+void free_records(std::vector<bam1_t*>& records) {
+    for (auto* record : records) {
+        bam_destroy1(record);
+    }
+    shared_pool().stats.freed += records.size();
+    records.clear();
+}
+
+// Gives a batch to the shared pool, freeing it if the pool is full.
+void share_batch(std::vector<bam1_t*>&& records) {
+    size_t num_bytes = 0;
+    for (const auto* record : records) {
+        num_bytes += sizeof(bam1_t) + record->m_data;
+    }
+    auto& pool = shared_pool();
+    {
+        std::lock_guard lock(pool.mutex);
+        if (pool.num_bytes + num_bytes <= MAX_SHARED_BYTES) {
+            pool.num_bytes += num_bytes;
+            pool.batches.push_back({std::move(records), num_bytes});
+            return;
+        }
+    }
+    free_records(records);
+}
+
+// Set once the thread's cache has been destroyed, after which records are freed directly.
+thread_local bool t_cache_destroyed = false;
+
+struct LocalCache {
+    std::vector<bam1_t*> records;
+
+    ~LocalCache() {
+        t_cache_destroyed = true;
+        if (!records.empty()) {
+            share_batch(std::move(records));
+        }
+    }
+};
+
+LocalCache& local_cache() {
+    thread_local LocalCache cache;
+    return cache;
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+BamPtr acquire_bam() {
+    auto& pool = shared_pool();
+    if (!t_cache_destroyed) {
+        auto& cache = local_cache();
+        if (cache.records.empty()) {
+            std::lock_guard lock(pool.mutex);
+            if (!pool.batches.empty()) {
+                auto& batch = pool.batches.back();
+                pool.num_bytes -= batch.num_bytes;
+                cache.records = std::move(batch.records);
+                pool.batches.pop_back();
+            }
+        }
+        if (!cache.records.empty()) {
+            ++pool.stats.hits;
+            BamPtr record(cache.records.back());
+            cache.records.pop_back();
+            return record;
+        }
+    }
+    ++pool.stats.misses;
+    BamPtr record(bam_init1());
+    if (!record) {
+        throw std::bad_alloc();
+    }
+    return record;
+}
+
+BamPtr duplicate_bam(const bam1_t* record) {
+    auto copy = acquire_bam();
+    if (!bam_copy1(copy.get(), record)) {
+        throw std::bad_alloc();
+    }
+    return copy;
+}
+
+void release_bam(bam1_t* record) {
+    if (!record) {
+        return;
+    }
+    // Records whose memory isn't owned by htslib, or which hold a lot of it, aren't kept.
+    if (t_cache_destroyed || record->mempolicy != 0 || record->m_data > MAX_RETAINED_DATA) {
+        bam_destroy1(record);
+        ++shared_pool().stats.freed;
+        return;
+    }
+
+    // Empty the record, keeping its data buffer.
+    record->core = {};
+    record->l_data = 0;
+    record->id = 0;
+
+    auto& cache = local_cache();
+    cache.records.push_back(record);
+    ++shared_pool().stats.recycled;
+    if (cache.records.size() >= 2 * BATCH_SIZE) {
+        // Share the least recently used records, keeping the ones most likely to be in cache.
+        const auto batch_end = cache.records.begin() + BATCH_SIZE;
+        std::vector<bam1_t*> batch(cache.records.begin(), batch_end);
+        cache.records.erase(cache.records.begin(), batch_end);
+        share_batch(std::move(batch));
+    }
+}
+
+stats::ReportedStats bam_pool_stats_report() {
+    const auto& pool_stats = shared_pool().stats;
+    stats::NamedStats named_stats;
+    named_stats["hits"] = static_cast<double>(pool_stats.hits.load());
+    named_stats["misses"] = static_cast<double>(pool_stats.misses.load());
+    named_stats["recycled"] = static_cast<double>(pool_stats.recycled.load());
+    named_stats["freed"] = static_cast<double>(pool_stats.freed.load());
+    return {"bam_pool", named_stats};
+}
+
+}  // namespace dorado::utils
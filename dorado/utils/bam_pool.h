@@ -0,0 +1,27 @@
+#pragma once
+
+#include "stats.h"
+#include "types.h"
+
+namespace dorado::utils {
+
+// A process-wide pool of bam1_t records which keep their data buffers when recycled.
+// BamDestructor returns records here rather than freeing them, so records made by one
+// node and written by another make a round trip, and a recycled record only allocates
+// if it needs more room than its buffer already has.
+// Each thread keeps a small cache, exchanging batches of records with a shared pool.
+// The memory the pool may hold on to is bounded, see the limits in bam_pool.cpp.
+
+// Returns an empty record, recycled from the pool if one is available.
+BamPtr acquire_bam();
+
+// Returns a copy of the record, recycled from the pool if one is available.
+BamPtr duplicate_bam(const bam1_t* record);
+
+// Recycles the record, or frees it if its buffer is too large to keep or the pool is full.
+void release_bam(bam1_t* record);
+
+// Hit, miss and recycling counts of the pool.
+stats::ReportedStats bam_pool_stats_report();
+
+}  // namespace dorado::utils
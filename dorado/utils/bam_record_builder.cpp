@@ -0,0 +1,76 @@
+#include "bam_record_builder.h"
+
+#include "bam_pool.h"
+
+#include <htslib/sam.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace dorado::utils {
+
+uint8_t* BamRecordBuilder::append_tag(const char* tag, char type, size_t value_size) {
+    const size_t offset = m_aux.size();
+    m_aux.resize(offset + 3 + value_size);
+    uint8_t* const dest = m_aux.data() + offset;
+    dest[0] = uint8_t(tag[0]);
+    dest[1] = uint8_t(tag[1]);
+    dest[2] = uint8_t(type);
+    return dest + 3;
+}
+
+// Note: as with bam_aux_append, values are stored in host byte order.
+void BamRecordBuilder::append_float(const char* tag, float value) {
+    std::memcpy(append_tag(tag, 'f', sizeof(value)), &value, sizeof(value));
+}
+
+void BamRecordBuilder::append_int(const char* tag, int32_t value) {
+    std::memcpy(append_tag(tag, 'i', sizeof(value)), &value, sizeof(value));
+}
+
+void BamRecordBuilder::append_string(const char* tag, std::string_view value) {
+    uint8_t* const dest = append_tag(tag, 'Z', value.size() + 1);
+    std::memcpy(dest, value.data(), value.size());
+    dest[value.size()] = 0;
+}
+
+uint8_t* BamRecordBuilder::append_byte_array(const char* tag, char subtype, size_t num_values) {
+    const auto count = uint32_t(num_values);
+    uint8_t* const dest = append_tag(tag, 'B', 1 + sizeof(count) + num_values);
+    dest[0] = uint8_t(subtype);
+    std::memcpy(dest + 1, &count, sizeof(count));
+    return dest + 1 + sizeof(count);
+}
+
+BamPtr BamRecordBuilder::build_unmapped(std::string_view qname,
+                                        uint16_t flag,
+                                        std::string_view seq,
+                                        std::string_view qstring) const {
+    if (seq.size() != qstring.size()) {
+        throw std::runtime_error("Sequence and qscore do not match size for read id " +
+                                 std::string(qname));
+    }
+
+    auto record = acquire_bam();
+    // bam_set1 allocates the data block with room for l_aux bytes of tags after the
+    // sequence and qualities, so copying the tags in below doesn't reallocate.
+    // Qualities are filled in directly to avoid a temporary Phred vector.
+    if (bam_set1(record.get(), qname.size(), qname.data(), flag, -1, -1, 0, 0, nullptr, -1, -1,
+                 0, seq.size(), seq.data(), nullptr, m_aux.size()) < 0) {
+        throw std::runtime_error("Failed to create BAM record for read id " + std::string(qname));
+    }
+
+    uint8_t* const qual = bam_get_qual(record.get());
+    for (size_t i = 0; i < qstring.size(); ++i) {
+        qual[i] = uint8_t(qstring[i] - 33);
+    }
+
+    if (!m_aux.empty()) {
+        std::memcpy(record->data + record->l_data, m_aux.data(), m_aux.size());
+        record->l_data += int(m_aux.size());
+    }
+    return record;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dorado::utils {
+
+// Builds unmapped BAM records with a single allocation of the record data.
+// Aux tags are serialised into a buffer owned by the builder, rather than being appended
+// one at a time with bam_aux_append (which can reallocate the record data for each tag),
+// and are copied into the record in one go by build_unmapped.
+// The buffer keeps its capacity across reset(), so a reused builder doesn't allocate
+// once it has grown to fit the largest record.
+class BamRecordBuilder {
+public:
+    // Discards the tags added so far.
+    void reset() { m_aux.clear(); }
+
+    // Size in bytes of the tags added so far.
+    size_t aux_size() const { return m_aux.size(); }
+
+    void append_float(const char* tag, float value);
+    void append_int(const char* tag, int32_t value);
+    void append_string(const char* tag, std::string_view value);
+
+    // Appends a 'B' array tag of num_values 1-byte values with the given subtype ('c' or 'C'),
+    // returning a pointer to the values for the caller to fill in.
+    // The pointer is invalidated by the next append.
+    uint8_t* append_byte_array(const char* tag, char subtype, size_t num_values);
+
+    // Creates an unmapped record from the name, flag, sequence and Phred+33 quality string,
+    // carrying the tags added so far.  seq and qstring must be the same length.
+    BamPtr build_unmapped(std::string_view qname,
+                          uint16_t flag,
+                          std::string_view seq,
+                          std::string_view qstring) const;
+
+private:
+    uint8_t* append_tag(const char* tag, char type, size_t value_size);
+
+    std::vector<uint8_t> m_aux;
+};
+
+}  // namespace dorado::utils
@@ -1,12 +1,14 @@
 #include "bam_utils.h"
 
 #include "SampleSheet.h"
+#include "bam_pool.h"
 #include "barcode_kits.h"
 #include "sequence_utils.h"
 
 #include <htslib/sam.h>
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <iostream>
 #include <map>
@@ -493,7 +495,7 @@ BamPtr new_unmapped_record(bam1_t* input_record, std::string seq, std::vector<ui
         }
     }
 
-    bam1_t* out_record = bam_init1();
+    bam1_t* out_record = acquire_bam().release();
     bam_set1(out_record, input_record->core.l_qname - input_record->core.l_extranul - 1,
              bam_get_qname(input_record), 4 /*flag*/, -1 /*tid*/, -1 /*pos*/, 0 /*mapq*/,
              0 /*n_cigar*/, nullptr /*cigar*/, -1 /*mtid*/, -1 /*mpos*/, 0 /*isize*/, seq.size(),
@@ -504,18 +506,21 @@ BamPtr new_unmapped_record(bam1_t* input_record, std::string seq, std::vector<ui
     return BamPtr(out_record);
 }
 
+bool is_alignment_tag(const char* tag) {
+    static constexpr std::array<std::string_view, 16> alignment_tags = {
+            "SA", "NM", "ms", "AS", "nn", "de", "dv", "tp",
+            "cm", "s1", "s2", "MD", "zd", "rl", "bh", "cs"};
+    const std::string_view tag_view(tag, 2);
+    return std::find(alignment_tags.begin(), alignment_tags.end(), tag_view) !=
+           alignment_tags.end();
+}
+
 void remove_alignment_tags_from_record(bam1_t* record) {
     // Iterate through all tags and check against known set
     // of tags to remove.
-    static const std::set<std::string> tags_to_remove = {"SA", "NM", "ms", "AS", "nn", "de",
-                                                         "dv", "tp", "cm", "s1", "s2", "MD",
-                                                         "zd", "rl", "bh", "cs"};
-
     uint8_t* aux_ptr = bam_aux_first(record);
     while (aux_ptr != NULL) {
-        auto tag_ptr = bam_aux_tag(aux_ptr);
-        std::string tag = std::string(tag_ptr, tag_ptr + 2);
-        if (tags_to_remove.find(tag) != tags_to_remove.end()) {
+        if (is_alignment_tag(bam_aux_tag(aux_ptr))) {
             aux_ptr = bam_aux_remove(record, aux_ptr);
         } else {
             aux_ptr = bam_aux_next(record, aux_ptr);
@@ -220,4 +220,12 @@ BamPtr new_unmapped_record(bam1_t* record, std::string seq, std::vector<uint8_t>
  */
 void remove_alignment_tags_from_record(bam1_t* record);
 
+/*
+ * Check whether a tag is one of the alignment related tags removed by
+ * remove_alignment_tags_from_record.
+ *
+ * @param tag The 2 character tag name.
+ */
+bool is_alignment_tag(const char* tag);
+
 }  // namespace dorado::utils
@@ -6,12 +6,15 @@
 #include <htslib/bgzf.h>
 #include <htslib/hts.h>
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 #include <spdlog/spdlog.h>
 
+#include <array>
 #include <cassert>
+#include <cstring>
 #include <filesystem>
-#include <map>
 #include <stdexcept>
+#include <utility>
 
 namespace {
 
@@ -20,10 +23,96 @@ constexpr size_t DEFAULT_BUFFER_SIZE{
         20000000};  // Arbitrary 20 MB. Can be overridden by application code.
 constexpr size_t MAX_FILES_FOR_MERGE{512};  // Maximum number of files to merge at once.
 
+// Temporary files are only read back once by the merge, so favour speed over size.
+constexpr const char* TEMP_FILE_MODE{"wb1"};
+
 bool compare_headers(const dorado::SamHdrPtr& header1, const dorado::SamHdrPtr& header2) {
     return (strcmp(sam_hdr_str(header1.get()), sam_hdr_str(header2.get())) == 0);
 }
 
+// BAI indexes can't address positions beyond 2^29, so a CSI index is used if any reference
+// is longer than that.  Returns the min_shift to pass to sam_idx_init, and the index filename.
+std::pair<int, std::string> get_index_settings(const sam_hdr_t* header,
+                                               const std::string& filename) {
+    constexpr hts_pos_t MAX_BAI_REF_LENGTH = hts_pos_t(1) << 29;
+    constexpr int CSI_MIN_SHIFT = 14;
+    for (int tid = 0; tid < sam_hdr_nref(header); ++tid) {
+        if (sam_hdr_tid2len(header, tid) >= MAX_BAI_REF_LENGTH) {
+            return {CSI_MIN_SHIFT, filename + ".csi"};
+        }
+    }
+    return {0, filename + ".bai"};
+}
+
+// Tournament tree for a k-way merge, which finds the input with the smallest key in log2(k)
+// comparisons rather than the k of a linear scan.  Each internal node holds the loser of the
+// match played there, and the overall winner is held separately.  Ties go to the lower input
+// index, so records with equal keys keep the order of the inputs.
+class LoserTree {
+public:
+    explicit LoserTree(std::vector<uint64_t> keys)
+            : m_keys(std::move(keys)),
+              m_exhausted(m_keys.size(), false),
+              m_losers(m_keys.size()) {
+        // Leaf i is node num_inputs + i, and the children of node n are 2n and 2n + 1.
+        const size_t num_inputs = m_keys.size();
+        std::vector<size_t> winners(2 * num_inputs);
+        for (size_t i = 0; i < num_inputs; ++i) {
+            winners[num_inputs + i] = i;
+        }
+        for (size_t node = num_inputs - 1; node > 0; --node) {
+            auto a = winners[2 * node];
+            auto b = winners[2 * node + 1];
+            if (!beats(a, b)) {
+                std::swap(a, b);
+            }
+            winners[node] = a;
+            m_losers[node] = b;
+        }
+        m_winner = num_inputs > 1 ? winners[1] : 0;
+    }
+
+    // Input holding the smallest key.
+    size_t winner() const { return m_winner; }
+
+    // True once every input has been exhausted.
+    bool done() const { return m_exhausted[m_winner]; }
+
+    // Updates the key of the winning input, and replays its matches.
+    void update_winner(uint64_t key) {
+        m_keys[m_winner] = key;
+        replay();
+    }
+
+    // Marks the winning input as exhausted, and replays its matches.
+    void remove_winner() {
+        m_exhausted[m_winner] = true;
+        replay();
+    }
+
+private:
+    bool beats(size_t a, size_t b) const {
+        if (m_exhausted[a] || m_exhausted[b]) {
+            return m_exhausted[a] == m_exhausted[b] ? a < b : m_exhausted[b];
+        }
+        return m_keys[a] < m_keys[b] || (m_keys[a] == m_keys[b] && a < b);
+    }
+
+    void replay() {
+        const size_t num_inputs = m_keys.size();
+        for (size_t node = (num_inputs + m_winner) / 2; node > 0; node /= 2) {
+            if (beats(m_losers[node], m_winner)) {
+                std::swap(m_losers[node], m_winner);
+            }
+        }
+    }
+
+    std::vector<uint64_t> m_keys;
+    std::vector<bool> m_exhausted;
+    std::vector<size_t> m_losers;
+    size_t m_winner{0};
+};
+
 }  // namespace
 
 namespace dorado::utils {
@@ -51,6 +140,105 @@ struct HtsFile::ProgressUpdater {
     }
 };
 
+// Records cached for sorted output.  Each record is stored as a bam1_t followed by its data,
+// with the bam1_t data pointer fixed up to point at the copy.
+struct HtsFile::SortBuffer {
+    struct Entry {
+        uint64_t key;
+        size_t offset;
+    };
+
+    std::vector<std::byte> records;
+    size_t used{0};
+    std::vector<Entry> entries;
+    // Reused by sort() to avoid allocating for each spill.
+    std::vector<Entry> scratch;
+
+    explicit SortBuffer(size_t size) : records(size) {}
+
+    static size_t bytes_required(const bam1_t* record) {
+        return sizeof(bam1_t) + size_t(record->l_data);
+    }
+
+    // Returns false if the record doesn't fit in the remaining space.
+    bool add(const bam1_t* record) {
+        if (used + bytes_required(record) > records.size()) {
+            return false;
+        }
+        entries.push_back({calculate_sorting_key(record), used});
+
+        // Copy the contents of the bam1_t struct into the memory buffer.
+        auto record_buff = records.data() + used;
+        memcpy(record_buff, record, sizeof(bam1_t));
+        used += sizeof(bam1_t);
+
+        // The data pointed to by the bam1_t::data field is then copied immediately after the struct contents.
+        memcpy(records.data() + used, record->data, record->l_data);
+
+        // We have to tell our buffered object where its copy of the data is.
+        bam1_t* buffer_entry = std::launder(reinterpret_cast<bam1_t*>(record_buff));
+        buffer_entry->data = std::launder(reinterpret_cast<uint8_t*>(records.data() + used));
+
+        // When we write the cached records, we will use a pointer cast to treat the cached record as a bam1_t
+        // object, so we need to round up our buffer offset so that the next entry will be properly aligned.
+        used += size_t(record->l_data);
+        constexpr auto alignment = alignof(bam1_t);
+        used = ((used + alignment - 1) / alignment) * alignment;
+        return true;
+    }
+
+    const bam1_t* get_record(const Entry& entry) const {
+        if (entry.offset + sizeof(bam1_t) > records.size()) {
+            throw std::out_of_range("Index out of bounds in BAM record buffer.");
+        }
+        auto record = std::launder(reinterpret_cast<const bam1_t*>(records.data() + entry.offset));
+        if (entry.offset + bytes_required(record) > records.size()) {
+            throw std::out_of_range("Index out of bounds in BAM record buffer.");
+        }
+        return record;
+    }
+
+    bool empty() const { return entries.empty(); }
+
+    void clear() {
+        entries.clear();
+        used = 0;
+    }
+
+    // Stable LSD radix sort of the entries by key, a byte per pass.  Passes where every key has
+    // the same byte are skipped, so typically only the bytes covering the reference position and
+    // the low byte of the reference index are sorted on.
+    void sort() {
+        if (entries.size() < 2) {
+            return;
+        }
+        constexpr int NUM_PASSES = sizeof(uint64_t);
+        std::array<std::array<size_t, 256>, NUM_PASSES> counts{};
+        for (const auto& entry : entries) {
+            for (int pass = 0; pass < NUM_PASSES; ++pass) {
+                ++counts[pass][(entry.key >> (8 * pass)) & 0xff];
+            }
+        }
+
+        scratch.resize(entries.size());
+        for (int pass = 0; pass < NUM_PASSES; ++pass) {
+            const int shift = 8 * pass;
+            auto& pass_counts = counts[pass];
+            if (pass_counts[(entries.front().key >> shift) & 0xff] == entries.size()) {
+                continue;
+            }
+            size_t bucket_start = 0;
+            for (auto& count : pass_counts) {
+                bucket_start += std::exchange(count, bucket_start);
+            }
+            for (const auto& entry : entries) {
+                scratch[pass_counts[(entry.key >> shift) & 0xff]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+};
+
 HtsFile::HtsFile(const std::string& filename, OutputMode mode, int threads, bool sort_bam)
         : m_filename(filename),
           m_threads(int(threads)),
@@ -105,16 +293,27 @@ void HtsFile::initialise_threads() {
         throw std::runtime_error("Could not open file: " + m_filename);
     }
 
-    if (m_file->format.compression == bgzf) {
-        auto res = bgzf_mt(m_file->fp.bgzf, m_threads, 128);
-        if (res < 0) {
-            throw std::runtime_error("Could not enable multi threading for BAM generation.");
-        }
+    enable_threads(m_file.get());
+}
+
+void HtsFile::enable_threads(htsFile* file) const {
+    if (file->format.compression != bgzf) {
+        return;
+    }
+    int res = 0;
+    if (m_thread_pool) {
+        htsThreadPool pool{m_thread_pool, 0};
+        res = hts_set_thread_pool(file, &pool);
+    } else {
+        res = bgzf_mt(file->fp.bgzf, m_threads, 128);
+    }
+    if (res < 0) {
+        throw std::runtime_error("Could not enable multi threading for BAM generation.");
     }
 }
 
 void HtsFile::set_num_threads(std::size_t threads) {
-    if (m_threads > 0) {
+    if (m_threads > 0 || m_thread_pool) {
         throw std::runtime_error("HtsFile num threads cannot be changed if already initialised");
     }
 
@@ -126,10 +325,27 @@ void HtsFile::set_num_threads(std::size_t threads) {
     initialise_threads();
 }
 
+void HtsFile::set_thread_pool(hts_tpool* thread_pool) {
+    if (m_threads > 0 || m_thread_pool) {
+        throw std::runtime_error(
+                "HtsFile thread pool cannot be set if threads are already initialised");
+    }
+    if (!thread_pool) {
+        throw std::runtime_error("HtsFile thread pool must not be null");
+    }
+
+    m_thread_pool = thread_pool;
+    initialise_threads();
+}
+
 HtsFile::~HtsFile() {
     if (!m_finalised) {
         spdlog::error("finalise() not called on a HtsFile.");
     }
+    // Don't destroy the buffer or header out from under a background spill.
+    if (m_pending_spill.valid()) {
+        m_pending_spill.wait();
+    }
 }
 
 uint64_t HtsFile::calculate_sorting_key(const bam1_t* record) {
@@ -142,63 +358,95 @@ void HtsFile::set_buffer_size(size_t buff_size) {
                                  std::to_string(MINIMUM_BUFFER_SIZE) + " (" +
                                  std::to_string(MINIMUM_BUFFER_SIZE / 1000) + " KB).");
     }
-    m_bam_buffer.resize(buff_size);
+    // Any records already cached are spilled so that they aren't lost.
+    flush_temp_file();
+    wait_for_spill();
+    // The size covers both the buffer taking records and the one being spilled, so that
+    // double buffering doesn't raise the peak memory used.
+    m_buffer_size = buff_size / 2;
+    m_sort_buffer = std::make_unique<SortBuffer>(m_buffer_size);
+    // The second buffer is only allocated once the first one fills.
+    m_spill_buffer.reset();
 }
 
-void HtsFile::flush_temp_file(const bam1_t* last_record) {
-    if (m_current_buffer_offset == 0 && !last_record) {
+std::string HtsFile::next_temp_filename() {
+    auto file_index = m_temp_files.size();
+    m_temp_files.push_back(m_filename + "." + std::to_string(file_index) + ".tmp");
+    return m_temp_files.back();
+}
+
+void HtsFile::flush_temp_file() {
+    if (!m_sort_buffer || m_sort_buffer->empty()) {
         // This handles the case that the last read passed in before calling finalise() has already triggered
         // a flush, or that finalise() was called without ever passing any reads.
         return;
     }
-    if (last_record) {
-        // We add last_record to our buffer map with offset -1, so that we know where it should be sorted into
-        // the output.
-        auto sorting_key = calculate_sorting_key(last_record);
-        m_buffer_map.insert({sorting_key, -1});
+
+    // Only one spill runs at a time, so once the previous one is done its buffer is free
+    // to take new records.
+    wait_for_spill();
+    if (m_spill_buffer) {
+        m_spill_buffer->clear();
+    } else {
+        m_spill_buffer = std::make_unique<SortBuffer>(m_buffer_size);
+    }
+    std::swap(m_sort_buffer, m_spill_buffer);
+
+    // If this is the only temporary file, finalise will rename it to be the output file, so
+    // it needs the usual compression level, and if it's mapped it's indexed as it's written.
+    const bool is_output_file = m_finalised && m_temp_files.empty();
+    const char* mode = is_output_file ? "wb" : TEMP_FILE_MODE;
+    const bool build_index = is_output_file && sam_hdr_nref(m_header.get()) > 0;
+    m_temp_file_is_output = is_output_file;
+    m_pending_spill = std::async(std::launch::async, [this, buffer = m_spill_buffer.get(),
+                                                      filename = next_temp_filename(), mode,
+                                                      build_index] {
+        write_temp_file(*buffer, filename, mode, build_index);
+    });
+}
+
+void HtsFile::wait_for_spill() {
+    if (m_pending_spill.valid()) {
+        // Rethrows any error from writing the temporary file.
+        m_pending_spill.get();
     }
+}
+
+void HtsFile::write_temp_file(SortBuffer& buffer,
+                              const std::string& filename,
+                              const char* mode,
+                              bool build_index) const {
+    buffer.sort();
 
     // Open the file for writing, and write the header. Note that all temp files will have the same header.
-    auto file_index = m_temp_files.size();
-    auto tempfilename = m_filename + "." + std::to_string(file_index) + ".tmp";
-    m_temp_files.push_back(tempfilename);
-    m_file.reset(hts_open(tempfilename.c_str(), "wb"));
-    if (m_file->format.compression == bgzf) {
-        auto res = bgzf_mt(m_file->fp.bgzf, m_threads, 128);
-        if (res < 0) {
-            throw std::runtime_error("Could not enable multi threading for BAM generation.");
-        }
-    }
-    if (m_mode != OutputMode::FASTQ && m_mode != OutputMode::FASTA) {
-        if (sam_hdr_write(m_file.get(), m_header.get()) != 0) {
-            throw std::runtime_error("Could not write header to temp file.");
+    HtsFilePtr file(hts_open(filename.c_str(), mode));
+    if (!file) {
+        throw std::runtime_error("Could not open temporary file " + filename);
+    }
+    enable_threads(file.get());
+    if (sam_hdr_write(file.get(), m_header.get()) != 0) {
+        throw std::runtime_error("Could not write header to temp file.");
+    }
+    if (build_index) {
+        // The index is named for the output file this will be renamed to.
+        const auto [min_shift, idx_fname] = get_index_settings(m_header.get(), m_filename);
+        if (sam_idx_init(file.get(), m_header.get(), min_shift, idx_fname.c_str()) < 0) {
+            throw std::runtime_error("Could not initialize output file for indexing.");
         }
     }
 
-    for (const auto& item : m_buffer_map) {
-        // This will give us the offsets into the buffer in sorted order.
-        int64_t offset = item.second;
-        const bam1_t* record{nullptr};
-        if (offset == -1) {
-            record = last_record;
-        } else {
-            if (size_t(offset) + sizeof(bam1_t) > m_bam_buffer.size()) {
-                throw std::out_of_range("Index out of bounds in BAM record buffer.");
-            }
-            record = std::launder(reinterpret_cast<bam1_t*>(m_bam_buffer.data() + offset));
-            if (size_t(offset) + sizeof(bam1_t) + size_t(record->l_data) > m_bam_buffer.size()) {
-                throw std::out_of_range("Index out of bounds in BAM record buffer.");
-            }
-        }
-        auto res = write_to_file(record);
+    // The entries now give the offsets into the buffer in sorted order.
+    for (const auto& entry : buffer.entries) {
+        auto res = sam_write1(file.get(), m_header.get(), buffer.get_record(entry));
         if (res < 0) {
             throw std::runtime_error("Error writing to BAM temporary file, error code " +
                                      std::to_string(res));
         }
     }
-    m_file.reset();
-    m_current_buffer_offset = 0;
-    m_buffer_map.clear();
+
+    if (build_index && sam_idx_save(file.get()) < 0) {
+        throw std::runtime_error("Could not write index file for " + m_filename);
+    }
 }
 
 // If we are doing sorted BAM output, then when we are done we will have sorted temporary files
@@ -224,9 +472,9 @@ void HtsFile::finalise(const ProgressCallback& progress_callback) {
     }
 
     // If any reads are cached for writing, write out the final temporary file.
-    flush_temp_file(nullptr);
+    flush_temp_file();
+    wait_for_spill();
 
-    bool file_is_mapped = (sam_hdr_nref(m_header.get()) > 0);
     m_header.reset();
 
     if (m_temp_files.empty()) {
@@ -234,23 +482,14 @@ void HtsFile::finalise(const ProgressCallback& progress_callback) {
         return;
     }
 
-    size_t num_temp_files = m_temp_files.size();
-    if (num_temp_files == 1) {
-        // We only have 1 temporary file, so just rename it.
+    if (m_temp_file_is_output) {
+        // The only temporary file was written by the final flush, already compressed and
+        // indexed as the output, so just rename it.
         std::filesystem::rename(m_temp_files.back(), m_filename);
         m_temp_files.clear();
-        if (file_is_mapped) {
-            // We still need to index the sorted BAM file.
-            // We can't update the progress while this is ongoing, so it's just going to
-            // say 50% complete until it finishes.
-            constexpr size_t percent_start_indexing = 50;
-            progress_callback(percent_start_indexing);
-            if (sam_index_build3(m_filename.c_str(), nullptr, 0, m_threads) < 0) {
-                spdlog::error("Failed to build index for file {}", m_filename);
-            }
-        }
     } else {
-        // Otherwise merge the temp files.
+        // Otherwise merge the temp files. This is also done for a single temporary file which
+        // was spilled before finalise, which the merge recompresses and indexes in one pass.
         bool merge_complete = merge_temp_files_iteratively(progress_callback);
         if (!merge_complete) {
             spdlog::error("Merging of temporary files failed.");
@@ -293,33 +532,23 @@ int HtsFile::write_to_file(const bam1_t* record) {
 }
 
 void HtsFile::cache_record(const bam1_t* record) {
-    size_t bytes_required = sizeof(bam1_t) + size_t(record->l_data);
-    if (m_current_buffer_offset + bytes_required > m_bam_buffer.size()) {
-        // This record won't fit in the buffer, so flush the current buffer, plus this record, to the file.
-        flush_temp_file(record);
+    if (!m_sort_buffer) {
+        // Only sorted output caches records, otherwise we failed to open the file.
+        throw std::runtime_error("Could not write to file: " + m_filename);
+    }
+    if (m_sort_buffer->add(record)) {
         return;
     }
-    auto sorting_key = calculate_sorting_key(record);
-    m_buffer_map.insert({sorting_key, m_current_buffer_offset});
-
-    // Copy the contents of the bam1_t struct into the memory buffer.
-    auto record_buff = m_bam_buffer.data() + m_current_buffer_offset;
-    memcpy(record_buff, record, sizeof(bam1_t));
-    m_current_buffer_offset += sizeof(bam1_t);
-
-    // The data pointed to by the bam1_t::data field is then copied immediately after the struct contents.
-    memcpy(m_bam_buffer.data() + m_current_buffer_offset, record->data, record->l_data);
-
-    // We have to tell our buffered object where its copy of the data is.
-    bam1_t* buffer_entry = std::launder(reinterpret_cast<bam1_t*>(record_buff));
-    buffer_entry->data =
-            std::launder(reinterpret_cast<uint8_t*>(m_bam_buffer.data() + m_current_buffer_offset));
 
-    // When we write the cached records, we will use a pointer cast to treat the cached record as a bam1_t
-    // object, so we need to round up our buffer offset so that the next entry will be properly aligned.
-    m_current_buffer_offset += size_t(record->l_data);
-    auto alignment = alignof(bam1_t);
-    m_current_buffer_offset = ((m_current_buffer_offset + alignment - 1) / alignment) * alignment;
+    // This record won't fit in the buffer, so spill the current buffer and start on the other.
+    flush_temp_file();
+    if (!m_sort_buffer->add(record)) {
+        // The record is larger than a whole buffer, so it gets a temporary file to itself.
+        SortBuffer oversized_buffer(SortBuffer::bytes_required(record));
+        oversized_buffer.add(record);
+        wait_for_spill();
+        write_temp_file(oversized_buffer, next_temp_filename(), TEMP_FILE_MODE, false);
+    }
 }
 
 bool HtsFile::merge_temp_files_iteratively(const ProgressCallback& progress_callback) const {
@@ -347,13 +576,32 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
     // true if the temp-files were created by this class, but it means that this
     // function is not suitable for generic merging of BAM files.
     const size_t num_temp_files = temp_files.size();
+
+    // A single pool of threads decompresses blocks ahead of the merge for every input, and
+    // compresses the output, rather than each file getting threads of its own. If a pool is
+    // shared with other files that's used, otherwise one is created for this merge.
+    // It's declared first so that it outlives the files using it.
+    HtsTpoolPtr own_thread_pool;
+    if (!m_thread_pool) {
+        own_thread_pool.reset(hts_tpool_init(std::max(m_threads, 1)));
+        if (!own_thread_pool) {
+            spdlog::error("Could not create thread pool for merging.");
+            return false;
+        }
+    }
+    htsThreadPool pool{m_thread_pool ? m_thread_pool : own_thread_pool.get(), 0};
+
     std::vector<HtsFilePtr> in_files(num_temp_files);
     std::vector<BamPtr> top_records(num_temp_files);
     std::vector<uint64_t> top_record_scores(num_temp_files);
     SamHdrPtr header{};
     for (size_t i = 0; i < num_temp_files; ++i) {
         in_files[i].reset(hts_open(temp_files[i].c_str(), "rb"));
-        if (bgzf_mt(in_files[i]->fp.bgzf, m_threads, 128) < 0) {
+        if (!in_files[i]) {
+            spdlog::error("Could not open temporary file {}", temp_files[i]);
+            return false;
+        }
+        if (hts_set_thread_pool(in_files[i].get(), &pool) < 0) {
             spdlog::error("Could not enable multi threading for BAM reading.");
             return false;
         }
@@ -381,7 +629,7 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
 
     // Open the output file, and write the header.
     HtsFilePtr out_file(hts_open(merged_filename.c_str(), "wb"));
-    if (bgzf_mt(out_file->fp.bgzf, m_threads, 128) < 0) {
+    if (!out_file || hts_set_thread_pool(out_file.get(), &pool) < 0) {
         spdlog::error("Could not enable multi threading for BAM generation.");
         return false;
     }
@@ -393,11 +641,11 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
         return false;
     }
 
-    // If this is the final iteration, initialise for indexing.
+    // If this is the final iteration, the index is built as the records are written.
     bool final_iteration = (std::filesystem::path(merged_filename).extension().string() != ".tmp");
-    std::string idx_fname = merged_filename + ".bai";
     if (final_iteration) {
-        auto res = sam_idx_init(out_file.get(), out_header.get(), 0, idx_fname.c_str());
+        const auto [min_shift, idx_fname] = get_index_settings(out_header.get(), merged_filename);
+        auto res = sam_idx_init(out_file.get(), out_header.get(), min_shift, idx_fname.c_str());
         if (res < 0) {
             spdlog::error("Could not initialize output file for indexing, error code {}", res);
             return false;
@@ -405,27 +653,12 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
     }
 
     size_t processed_records = 0;
-    size_t files_done = 0;
-    while (files_done < num_temp_files) {
-        // Find the next file to write a record from.
-        uint64_t best_score = std::numeric_limits<uint64_t>::max();
-        int best_index = -1;
-        for (size_t i = 0; i < num_temp_files; ++i) {
-            if (top_records[i]) {
-                auto score = top_record_scores[i];
-                if (best_index == -1 || score < best_score) {
-                    best_score = score;
-                    best_index = int(i);
-                }
-            }
-        }
-        if (best_index == -1) {
-            spdlog::error("Logic error in merging algorithm.");
-            return false;
-        }
-
-        // Write the record.
-        auto res = sam_write1(out_file.get(), out_header.get(), top_records[best_index].get());
+    LoserTree merge_tree(std::move(top_record_scores));
+    while (!merge_tree.done()) {
+        // Write the record from the file with the smallest key.
+        const auto best_index = merge_tree.winner();
+        auto& best_record = top_records[best_index];
+        auto res = sam_write1(out_file.get(), out_header.get(), best_record.get());
         if (res < 0) {
             spdlog::error("Failed to write to sorted file {}, error code {}", out_file->fn, res);
             return false;
@@ -433,17 +666,16 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
         ++processed_records;
         update_progress(processed_records);
 
-        // Load the next record for the file.
-        top_records[best_index].reset(bam_init1());
-        res = sam_read1(in_files[best_index].get(), header.get(), top_records[best_index].get());
+        // Load the next record for the file, reusing the record's storage.
+        res = sam_read1(in_files[best_index].get(), header.get(), best_record.get());
         if (res >= 0) {
-            top_record_scores[best_index] = calculate_sorting_key(top_records[best_index].get());
+            merge_tree.update_winner(calculate_sorting_key(best_record.get()));
         } else if (res == -1) {
             // EOF reached. Close the file and mark that this file is done.
-            top_records[best_index].reset();
+            best_record.reset();
             in_files[best_index].reset();
-            ++files_done;
-        } else if (res < -1) {
+            merge_tree.remove_winner();
+        } else {
             spdlog::error("Error reading record from file {}, error code {}",
                           in_files[best_index]->fn, res);
             return false;
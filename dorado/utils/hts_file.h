@@ -3,10 +3,14 @@
 #include "types.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <future>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace dorado::utils {
 
@@ -29,6 +33,9 @@ public:
 
     // Support for setting threads after construction
     void set_num_threads(std::size_t threads);
+    // Compress (and, when sorting, merge) using a pool shared with other files rather than
+    // threads of this file's own. The pool must outlive this object. Construct with 0 threads.
+    void set_thread_pool(hts_tpool* thread_pool);
 
     void set_buffer_size(size_t buff_size);
     int set_header(const sam_hdr_t* header);
@@ -46,19 +53,34 @@ private:
     SamHdrPtr m_header;
     size_t m_num_records{0};
     int m_threads{0};
+    hts_tpool* m_thread_pool{nullptr};
     bool m_finalised{false};
     bool m_finalise_is_noop;
     bool m_sort_bam;
     const OutputMode m_mode;
 
-    std::vector<std::byte> m_bam_buffer;
-    std::multimap<uint64_t, int64_t> m_buffer_map;
+    // For sorted BAM output, records are cached in m_sort_buffer.  When it fills it is
+    // swapped with m_spill_buffer, which is sorted and written to a temporary file by a
+    // background task while further records are cached.  Each buffer is half of the size
+    // passed to set_buffer_size.
+    struct SortBuffer;
+    size_t m_buffer_size{0};
+    std::unique_ptr<SortBuffer> m_sort_buffer;
+    std::unique_ptr<SortBuffer> m_spill_buffer;
     std::vector<std::string> m_temp_files;
-    int64_t m_current_buffer_offset{0};
+    // Set if the final flush wrote the only temporary file, ready to be renamed as the output.
+    bool m_temp_file_is_output{false};
+    std::future<void> m_pending_spill;
 
     struct ProgressUpdater;
 
-    void flush_temp_file(const bam1_t* last_record);
+    void flush_temp_file();
+    void wait_for_spill();
+    void write_temp_file(SortBuffer& buffer,
+                         const std::string& filename,
+                         const char* mode,
+                         bool build_index) const;
+    std::string next_temp_filename();
     int write_to_file(const bam1_t* record);
     void cache_record(const bam1_t* record);
     bool merge_temp_files_iteratively(const ProgressCallback& progress_callback) const;
@@ -66,6 +88,7 @@ private:
                           const std::vector<std::string>& temp_files,
                           const std::string& merged_filename) const;
     void initialise_threads();
+    void enable_threads(htsFile* file) const;
 };
 
 class FileMergeBatcher {
@@ -0,0 +1,133 @@
+#include "read_id_set.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+constexpr size_t MIN_SLOTS = 1024;
+constexpr size_t UUID_STRING_LENGTH = 36;
+
+// Only lowercase hex is accepted, so that read IDs only match if their strings are equal.
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+bool is_nil(const dorado::utils::ReadIdSet::Uuid& read_id) {
+    return std::all_of(read_id.begin(), read_id.end(), [](uint8_t b) { return b == 0; });
+}
+
+size_t hash_uuid(const dorado::utils::ReadIdSet::Uuid& read_id) {
+    // Version 4 UUIDs are mostly random, but other versions start with a timestamp, so mix
+    // both halves rather than using the bytes directly.
+    uint64_t high = 0;
+    uint64_t low = 0;
+    std::memcpy(&high, read_id.data(), sizeof(high));
+    std::memcpy(&low, read_id.data() + sizeof(high), sizeof(low));
+    uint64_t hash = (high ^ (low * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 32;
+    return static_cast<size_t>(hash);
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+std::optional<ReadIdSet::Uuid> ReadIdSet::parse_uuid(std::string_view read_id) {
+    if (read_id.size() != UUID_STRING_LENGTH) {
+        return std::nullopt;
+    }
+    Uuid uuid{};
+    size_t byte = 0;
+    for (size_t i = 0; i < UUID_STRING_LENGTH;) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (read_id[i] != '-') {
+                return std::nullopt;
+            }
+            ++i;
+            continue;
+        }
+        const int high = hex_value(read_id[i]);
+        const int low = hex_value(read_id[i + 1]);
+        if (high < 0 || low < 0) {
+            return std::nullopt;
+        }
+        uuid[byte++] = static_cast<uint8_t>((high << 4) | low);
+        i += 2;
+    }
+    return uuid;
+}
+
+bool ReadIdSet::insert(std::string_view read_id) {
+    if (auto uuid = parse_uuid(read_id)) {
+        return insert(*uuid);
+    }
+    return m_other_ids.emplace(read_id).second;
+}
+
+bool ReadIdSet::insert(const Uuid& read_id) {
+    if (is_nil(read_id)) {
+        return !std::exchange(m_has_nil_uuid, true);
+    }
+    // Keep the load factor below 0.75 so probe sequences stay short.
+    if ((m_num_uuids + 1) * 4 > m_slots.size() * 3) {
+        grow();
+    }
+    auto& slot = m_slots[find_slot(read_id)];
+    if (!is_nil(slot)) {
+        return false;
+    }
+    slot = read_id;
+    ++m_num_uuids;
+    return true;
+}
+
+bool ReadIdSet::contains(std::string_view read_id) const {
+    if (auto uuid = parse_uuid(read_id)) {
+        return contains(*uuid);
+    }
+    return m_other_ids.find(std::string(read_id)) != m_other_ids.end();
+}
+
+bool ReadIdSet::contains(const Uuid& read_id) const {
+    if (is_nil(read_id)) {
+        return m_has_nil_uuid;
+    }
+    return !m_slots.empty() && !is_nil(m_slots[find_slot(read_id)]);
+}
+
+bool ReadIdSet::contains(const uint8_t* read_id) const {
+    Uuid uuid;
+    std::memcpy(uuid.data(), read_id, uuid.size());
+    return contains(uuid);
+}
+
+size_t ReadIdSet::find_slot(const Uuid& read_id) const {
+    // The table size is a power of two, and is never full, so this ends at a matching or empty
+    // slot.
+    const size_t mask = m_slots.size() - 1;
+    size_t index = hash_uuid(read_id) & mask;
+    while (!is_nil(m_slots[index]) && m_slots[index] != read_id) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+void ReadIdSet::grow() {
+    std::vector<Uuid> old_slots(std::max(MIN_SLOTS, m_slots.size() * 2));
+    std::swap(old_slots, m_slots);
+    for (const auto& read_id : old_slots) {
+        if (!is_nil(read_id)) {
+            m_slots[find_slot(read_id)] = read_id;
+        }
+    }
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace dorado::utils {
+
+// A set of read IDs, which keeps UUID read IDs as 16 binary bytes in an open addressing table
+// rather than as strings. This takes a fraction of the memory of a set of strings when there
+// are tens of millions of reads, and lets pod5 read IDs be looked up without formatting them.
+// Read IDs which aren't lowercase UUIDs, the form pod5 read IDs are formatted in, are kept as
+// strings, so read IDs only match if they are identical strings, as with a set of strings.
+class ReadIdSet {
+public:
+    using Uuid = std::array<uint8_t, 16>;
+
+    ReadIdSet() = default;
+
+    // Returns true if the read ID wasn't already in the set.
+    bool insert(std::string_view read_id);
+    bool insert(const Uuid& read_id);
+
+    bool contains(std::string_view read_id) const;
+    bool contains(const Uuid& read_id) const;
+    bool contains(const uint8_t* read_id) const;
+    // Like std::unordered_set::count, for code that treats this as a set of strings.
+    size_t count(std::string_view read_id) const { return contains(read_id) ? 1 : 0; }
+
+    size_t size() const { return m_num_uuids + (m_has_nil_uuid ? 1 : 0) + m_other_ids.size(); }
+    bool empty() const { return size() == 0; }
+
+    // Parses a read ID in the 36 character lowercase UUID form.
+    static std::optional<Uuid> parse_uuid(std::string_view read_id);
+
+private:
+    // Empty slots hold the nil UUID, so whether the nil UUID itself is in the set is kept apart.
+    std::vector<Uuid> m_slots;
+    size_t m_num_uuids{0};
+    bool m_has_nil_uuid{false};
+    std::unordered_set<std::string> m_other_ids;
+
+    size_t find_slot(const Uuid& read_id) const;
+    void grow();
+};
+
+}  // namespace dorado::utils
@@ -13,7 +13,6 @@
 #include <cmath>
 #include <cstdint>
 #include <cstring>
-#include <iterator>
 #include <numeric>
 #include <optional>
 #include <vector>
@@ -128,6 +127,98 @@ __attribute__((target("avx2"))) std::string reverse_complement_impl(const std::s
 }
 #endif
 
+// Number of partial sums used when summing error probabilities. Each implementation adds base i
+// into partial sum i % kQScoreLanes and then adds the partial sums in order, so results are the
+// same whichever implementation is taken.
+constexpr size_t kQScoreLanes = 8;
+
+const std::array<float, 256>& error_probability_table() {
+    // Lookup table avoids repeated invocation of std::pow, which
+    // otherwise dominates run time of this function.
+    // Unfortunately std::pow is not constexpr, so this can't be.
+    static const auto kCharToScoreTable = [] {
+        std::array<float, 256> a{};
+        for (int q = 33; q <= 127; ++q) {
+            auto shifted = static_cast<float>(q - 33);
+            a[q] = std::pow(10.0f, -shifted / 10.0f);
+        }
+        return a;
+    }();
+    return kCharToScoreTable;
+}
+
+float add_partial_sums(const float* partial_sums) {
+    float total = 0.0f;
+    for (size_t lane = 0; lane < kQScoreLanes; ++lane) {
+        total += partial_sums[lane];
+    }
+    return total;
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+float sum_error_probabilities(std::string_view qstring) {
+    const auto& table = error_probability_table();
+    std::array<float, kQScoreLanes> partial_sums{};
+    for (size_t i = 0; i < qstring.size(); ++i) {
+        partial_sums[i % kQScoreLanes] += table[static_cast<uint8_t>(qstring[i])];
+    }
+    return add_partial_sums(partial_sums.data());
+}
+
+#if ENABLE_AVX2_IMPL
+// Gathers the error probabilities of 8 bases at a time into a vector of partial sums.
+__attribute__((target("avx2"))) float sum_error_probabilities(std::string_view qstring) {
+    static_assert(kQScoreLanes == 8);
+    const auto& table = error_probability_table();
+    const size_t len = qstring.size();
+    __m256 sums = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + kQScoreLanes <= len; i += kQScoreLanes) {
+        const __m128i chars = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&qstring[i]));
+        const __m256i indices = _mm256_cvtepu8_epi32(chars);
+        sums = _mm256_add_ps(sums, _mm256_i32gather_ps(table.data(), indices, sizeof(float)));
+    }
+    alignas(32) std::array<float, kQScoreLanes> partial_sums;
+    _mm256_store_ps(partial_sums.data(), sums);
+    for (; i < len; ++i) {
+        partial_sums[i % kQScoreLanes] += table[static_cast<uint8_t>(qstring[i])];
+    }
+    return add_partial_sums(partial_sums.data());
+}
+#endif
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void sequence_to_ints_impl(const char* sequence, size_t len, int* sequence_ints) {
+    for (size_t i = 0; i < len; ++i) {
+        sequence_ints[i] = dorado::utils::base_to_int(sequence[i]);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+// Converts 8 bases at a time, with the same arithmetic as base_to_int on sign extended chars.
+__attribute__((target("avx2"))) void sequence_to_ints_impl(const char* sequence,
+                                                           size_t len,
+                                                           int* sequence_ints) {
+    const __m256i kCodeMask = _mm256_set1_epi32(0b11);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const __m128i chars = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(sequence + i));
+        const __m256i bases = _mm256_cvtepi8_epi32(chars);
+        const __m256i codes = _mm256_and_si256(
+                _mm256_xor_si256(_mm256_srai_epi32(bases, 2), _mm256_srai_epi32(bases, 1)),
+                kCodeMask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sequence_ints + i), codes);
+    }
+    for (; i < len; ++i) {
+        sequence_ints[i] = dorado::utils::base_to_int(sequence[i]);
+    }
+}
+#endif
+
 }  // namespace
 
 namespace dorado::utils {
@@ -164,20 +255,7 @@ float mean_qscore_from_qstring(std::string_view qstring) {
         return 0.0f;
     }
 
-    // Lookup table avoids repeated invocation of std::pow, which
-    // otherwise dominates run time of this function.
-    // Unfortunately std::pow is not constexpr, so this can't be.
-    static const auto kCharToScoreTable = [] {
-        std::array<float, 256> a{};
-        for (int q = 33; q <= 127; ++q) {
-            auto shifted = static_cast<float>(q - 33);
-            a[q] = std::pow(10.0f, -shifted / 10.0f);
-        }
-        return a;
-    }();
-    float total_error =
-            std::accumulate(qstring.cbegin(), qstring.cend(), 0.0f,
-                            [](float sum, char qchar) { return sum + kCharToScoreTable[qchar]; });
+    float total_error = sum_error_probabilities(qstring);
     float mean_error = total_error / static_cast<float>(qstring.size());
     float mean_qscore = -10.0f * std::log10(mean_error);
     return std::clamp(mean_qscore, 1.0f, 50.0f);
@@ -185,13 +263,30 @@ float mean_qscore_from_qstring(std::string_view qstring) {
 
 std::vector<int> sequence_to_ints(const std::string& sequence) {
     NVTX3_FUNC_RANGE();
-    std::vector<int> sequence_ints;
-    sequence_ints.reserve(sequence.size());
-    std::transform(std::begin(sequence), std::end(sequence),
-                   std::back_insert_iterator<std::vector<int>>(sequence_ints), &base_to_int);
+    std::vector<int> sequence_ints(sequence.size());
+    sequence_to_ints_impl(sequence.data(), sequence.size(), sequence_ints.data());
     return sequence_ints;
 }
 
+std::vector<uint64_t> kmer_indices(const std::vector<int>& sequence_ints, size_t kmer_len) {
+    assert(kmer_len > 0 && kmer_len <= 32);
+    if (sequence_ints.size() < kmer_len) {
+        return {};
+    }
+    const uint64_t mask = kmer_len == 32 ? ~uint64_t{0} : (uint64_t{1} << (2 * kmer_len)) - 1;
+    std::vector<uint64_t> indices(sequence_ints.size() - kmer_len + 1);
+    // Roll the index along the sequence, shifting in one base at a time.
+    uint64_t index = 0;
+    for (size_t i = 0; i + 1 < kmer_len; ++i) {
+        index = (index << 2) | static_cast<uint64_t>(sequence_ints[i]);
+    }
+    for (size_t i = kmer_len - 1; i < sequence_ints.size(); ++i) {
+        index = ((index << 2) | static_cast<uint64_t>(sequence_ints[i])) & mask;
+        indices[i + 1 - kmer_len] = index;
+    }
+    return indices;
+}
+
 int64_t sequence_to_move_table_index(const std::vector<uint8_t>& move_vals,
                                      int64_t sequence_index,
                                      int64_t sequence_size) {
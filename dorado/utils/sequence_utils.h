@@ -27,6 +27,11 @@ inline int base_to_int(char c) { return 0b11 & ((c >> 2) ^ (c >> 1)); }
 // No checking is performed on the input
 std::vector<int> sequence_to_ints(const std::string& sequence);
 
+// Compute the index of each kmer in a sequence in integer representation, with the first base of
+// the kmer in the highest bits, as used to look up per-kmer tables. There is an index for each of
+// the sequence_ints.size() - kmer_len + 1 kmers. kmer_len must be at most 32.
+std::vector<uint64_t> kmer_indices(const std::vector<int>& sequence_ints, size_t kmer_len);
+
 // Find the move table index for a given sequence index
 int64_t sequence_to_move_table_index(const std::vector<uint8_t>& move_vals,
                                      int64_t sequence_index,
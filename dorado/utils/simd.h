@@ -8,6 +8,20 @@
 #define ENABLE_AVX2_IMPL 0
 #endif
 
+#if ENABLE_AVX2_IMPL
+namespace dorado::utils {
+
+// Whether the CPU has AVX2, and SSE4.2 which comes with it, for code which picks its
+// implementation at runtime without target("default") multiversioning.
+inline bool cpu_supports_avx2() {
+    static const bool supported =
+            __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+
+}  // namespace dorado::utils
+#endif
+
 #if defined(__APPLE__) && defined(__arm64__)
 #define ENABLE_NEON_IMPL 1
 #include "arm_neon.h"
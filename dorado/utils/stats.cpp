@@ -2,6 +2,7 @@
 
 #include "thread_naming.h"
 
+#include <algorithm>
 #include <ostream>
 #include <set>
 
@@ -108,4 +109,25 @@ void StatsSampler::sampling_thread_fn() {
     }
 }
 
-}  // namespace dorado::stats
\ No newline at end of file
+void LatencyHistogram::add(std::chrono::steady_clock::duration latency) {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+    size_t bucket = 0;
+    while (bucket < NUM_BUCKETS - 1 && ms > (int64_t(1) << bucket)) {
+        ++bucket;
+    }
+    m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::report(NamedStats& stats, const std::string& name) const {
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+        const auto count = m_counts[bucket].load(std::memory_order_relaxed);
+        total += count;
+        const auto bound = std::to_string(int64_t(1) << std::min(bucket, NUM_BUCKETS - 2));
+        const bool is_last = bucket == NUM_BUCKETS - 1;
+        stats[name + (is_last ? "_gt_" : "_le_") + bound + "ms"] = static_cast<double>(count);
+    }
+    stats[name + "_count"] = static_cast<double>(total);
+}
+
+}  // namespace dorado::stats
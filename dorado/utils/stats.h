@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <functional>
@@ -92,5 +93,19 @@ private:
     std::chrono::time_point<std::chrono::system_clock> m_start_time;
 };
 
+// Counts of durations in power of two millisecond buckets, which any thread can add to.
+// Reported as "<name>_le_<N>ms" for each bucket, with the last bucket as "<name>_gt_<N>ms",
+// plus "<name>_count".
+class LatencyHistogram {
+public:
+    void add(std::chrono::steady_clock::duration latency);
+    void report(NamedStats& stats, const std::string& name) const;
+
+private:
+    // The second to last bucket holds durations of up to 2^18 ms, about 4.4 minutes.
+    static constexpr size_t NUM_BUCKETS = 20;
+    std::array<std::atomic<size_t>, NUM_BUCKETS> m_counts{};
+};
+
 }  // namespace stats
 }  // namespace dorado
@@ -1,12 +1,15 @@
 #include "types.h"
 
+#include "bam_pool.h"
+
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 #include <minimap.h>
 #include <spdlog/spdlog.h>
 
 namespace dorado {
 
-void BamDestructor::operator()(bam1_t* bam) { bam_destroy1(bam); }
+void BamDestructor::operator()(bam1_t* bam) { utils::release_bam(bam); }
 
 // Here mm_tbuf_t is used instead of mm_tbuf_s since minimap.h
 // provides a typedef for mm_tbuf_s to mm_tbuf_t.
@@ -20,6 +23,12 @@ void HtsFileDestructor::operator()(htsFile* hts_file) {
     }
 }
 
+void HtsTpoolDestructor::operator()(hts_tpool* pool) {
+    if (pool) {
+        hts_tpool_destroy(pool);
+    }
+}
+
 KString::KString() : m_data(std::make_unique<kstring_t>()) { *m_data = {0, 0, nullptr}; }
 
 KString::KString(size_t n) : m_data(std::make_unique<kstring_t>()) {
@@ -9,6 +9,7 @@
 #include <vector>
 
 struct bam1_t;
+struct hts_tpool;
 struct htsFile;
 struct mm_tbuf_s;
 struct sam_hdr_t;
@@ -151,6 +152,11 @@ struct HtsFileDestructor {
 };
 using HtsFilePtr = std::unique_ptr<htsFile, HtsFileDestructor>;
 
+struct HtsTpoolDestructor {
+    void operator()(hts_tpool *);
+};
+using HtsTpoolPtr = std::unique_ptr<hts_tpool, HtsTpoolDestructor>;
+
 /// Wrapper for htslib kstring_t struct.
 class KString {
 public:
@@ -2,6 +2,7 @@
 
 #include "MessageSinkUtils.h"
 #include "TestUtils.h"
+#include "demux/MultiQueryMatcher.h"
 #include "demux/Trimmer.h"
 #include "demux/adapter_info.h"
 #include "read_pipeline/AdapterDetectorNode.h"
@@ -13,10 +14,12 @@
 
 #include <ATen/Functions.h>
 #include <catch2/catch.hpp>
+#include <edlib.h>
 #include <htslib/sam.h>
 
 #include <cstdint>
 #include <filesystem>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -26,6 +29,54 @@ namespace fs = std::filesystem;
 
 using namespace dorado;
 
+TEST_CASE("AdapterDetector: MultiQueryMatcher matches edlib edit distances", TEST_GROUP) {
+    std::mt19937 rng(42);
+    auto random_sequence = [&rng](size_t length) {
+        // Mostly ACGT, with the odd N.
+        const std::string bases = "ACGTACGTACGTACGTN";
+        std::string seq(length, 'A');
+        for (auto& base : seq) {
+            base = bases[rng() % bases.size()];
+        }
+        return seq;
+    };
+
+    EdlibAlignConfig config = edlibDefaultAlignConfig();
+    config.mode = EDLIB_MODE_HW;
+    config.task = EDLIB_TASK_DISTANCE;
+    static const EdlibEqualityPair additional_equalities[4] = {
+            {'N', 'A'}, {'N', 'T'}, {'N', 'C'}, {'N', 'G'}};
+    config.additionalEqualities = additional_equalities;
+    config.additionalEqualitiesLength = 4;
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        // Queries of up to 3 words, including some on the word boundaries.
+        std::vector<std::string> queries;
+        for (const size_t length : {size_t(1), size_t(64), size_t(65), size_t(128)}) {
+            queries.push_back(random_sequence(length));
+        }
+        for (int i = 0; i < 4; ++i) {
+            queries.push_back(random_sequence(1 + rng() % 150));
+        }
+        auto seq = random_sequence(rng() % 200);
+        // Put part of one query in the sequence so there's a close match.
+        const auto& planted = queries[rng() % queries.size()];
+        seq.insert(rng() % (seq.size() + 1), planted.substr(0, 1 + rng() % planted.size()));
+
+        demux::MultiQueryMatcher matcher(queries);
+        std::vector<int> distances;
+        matcher.edit_distances(seq, distances);
+        REQUIRE(distances.size() == queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            CAPTURE(iteration, i, queries[i], seq);
+            auto result = edlibAlign(queries[i].data(), int(queries[i].length()), seq.data(),
+                                     int(seq.length()), config);
+            CHECK(distances[i] == result.editDistance);
+            edlibFreeAlignResult(result);
+        }
+    }
+}
+
 TEST_CASE("AdapterDetector: test adapter detection", TEST_GROUP) {
     fs::path data_dir = fs::path(get_data_dir("barcode_demux/single_end"));
 
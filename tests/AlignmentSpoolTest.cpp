@@ -0,0 +1,92 @@
+#include "correct/alignment_spool.h"
+
+#include "TestUtils.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[correct][AlignmentSpool]"
+
+using namespace dorado;
+
+namespace {
+
+struct Alignment {
+    std::string qname;
+    utils::Overlap overlap;
+    std::vector<CigarOp> cigar;
+};
+
+Alignment make_alignment(int i) {
+    Alignment alignment;
+    alignment.qname = "query_" + std::to_string(i);
+    alignment.overlap = {i, 2 * i + 1, 3 * i + 2, i * 1000, i * 1000 + 700, 1 << 30, i % 2 == 0};
+    alignment.cigar = {{CigarOpType::EQ, uint32_t(i + 1)},
+                       {CigarOpType::X, 1},
+                       {CigarOpType::D, 0xffffffffu},
+                       {CigarOpType::I, 128}};
+    return alignment;
+}
+
+void check_alignments(correction::AlignmentSpool& spool,
+                      size_t target,
+                      const std::vector<Alignment>& expected) {
+    std::vector<std::string> qnames;
+    std::vector<std::vector<CigarOp>> cigars;
+    std::vector<utils::Overlap> overlaps;
+    CHECK(spool.num_alignments(target) == expected.size());
+    spool.take(target, qnames, cigars, overlaps);
+    REQUIRE(qnames.size() == expected.size());
+    REQUIRE(cigars.size() == expected.size());
+    REQUIRE(overlaps.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        CHECK(qnames[i] == expected[i].qname);
+        CHECK(overlaps[i].qstart == expected[i].overlap.qstart);
+        CHECK(overlaps[i].qend == expected[i].overlap.qend);
+        CHECK(overlaps[i].qlen == expected[i].overlap.qlen);
+        CHECK(overlaps[i].tstart == expected[i].overlap.tstart);
+        CHECK(overlaps[i].tend == expected[i].overlap.tend);
+        CHECK(overlaps[i].tlen == expected[i].overlap.tlen);
+        CHECK(overlaps[i].fwd == expected[i].overlap.fwd);
+        REQUIRE(cigars[i].size() == expected[i].cigar.size());
+        for (size_t j = 0; j < cigars[i].size(); ++j) {
+            CHECK(cigars[i][j].op == expected[i].cigar[j].op);
+            CHECK(cigars[i][j].len == expected[i].cigar[j].len);
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Alignments are read back per target in the order they were added", TEST_GROUP) {
+    // A budget of 0 spills on every alignment, so the records of each target are split over
+    // many runs in the spill file, followed by whatever is left in memory.
+    const size_t memory_budget = GENERATE(size_t{0}, size_t{1000}, size_t{1} << 30);
+    CAPTURE(memory_budget);
+
+    auto temp_dir = tests::make_temp_dir("alignment_spool_test");
+    correction::AlignmentSpool spool({"target_0", "target_1", "target_2"}, memory_budget,
+                                     temp_dir.m_path);
+    std::vector<std::vector<Alignment>> expected(spool.num_targets());
+    for (int i = 0; i < 100; ++i) {
+        // Nothing is added to the last target.
+        const size_t target = i % 3 == 0 ? 0 : 1;
+        expected[target].push_back(make_alignment(i));
+        const auto& alignment = expected[target].back();
+        spool.add(target, alignment.qname, alignment.overlap, alignment.cigar);
+    }
+    if (memory_budget == 0) {
+        CHECK(spool.spilled_size() > 0);
+    }
+
+    CHECK(spool.target_name(1) == "target_1");
+    for (size_t target = 0; target < spool.num_targets(); ++target) {
+        CAPTURE(target);
+        check_alignments(spool, target, expected[target]);
+        // Taking the alignments releases them.
+        CHECK(spool.num_alignments(target) == 0);
+    }
+    CHECK(spool.memory_size() == 0);
+}
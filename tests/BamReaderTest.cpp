@@ -7,7 +7,10 @@
 #include <htslib/sam.h>
 
 #include <filesystem>
+#include <string>
 #include <unordered_set>
+#include <variant>
+#include <vector>
 
 #define TEST_GROUP "[bam_utils][hts_reader]"
 
@@ -66,6 +69,43 @@ TEST_CASE("HtsReaderTest: Read SAM to sink", TEST_GROUP) {
     REQUIRE(bam_records.size() == 11);  // SAM file has 11 reads.
 }
 
+TEST_CASE("HtsReaderTest: Read SAM to sink with read list and max reads", TEST_GROUP) {
+    fs::path aligner_test_dir = fs::path(get_data_dir("bam_reader"));
+    auto sam = aligner_test_dir / "small.sam";
+    const std::unordered_set<std::string> read_ids = {"d7500028-dfcc-4404-b636-13edae804c55",
+                                                      "60588a89-f191-414e-b444-ad0815b7d9c9"};
+
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> bam_records;
+    pipeline_desc.add_node<MessageSinkToVector>({}, 100, bam_records);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    SECTION("Read list is applied") {
+        dorado::HtsReader reader(sam.string(), read_ids);
+        reader.set_num_threads(2);
+        CHECK(reader.read(*pipeline, 0) == 2);
+        pipeline.reset();
+        REQUIRE(bam_records.size() == 2);
+        for (auto& message : bam_records) {
+            const auto& bam_message = std::get<dorado::BamMessage>(message);
+            CHECK(read_ids.count(bam_get_qname(bam_message.bam_ptr.get())) == 1);
+        }
+    }
+
+    SECTION("No records are lost beyond max reads") {
+        dorado::HtsReader reader(sam.string(), std::nullopt);
+        reader.set_num_threads(2);
+        CHECK(reader.read(*pipeline, 5) == 5);
+        uint32_t read_count = 0;
+        while (reader.read()) {
+            read_count++;
+        }
+        CHECK(read_count == 6);  // SAM file has 11 reads.
+        pipeline.reset();
+        CHECK(bam_records.size() == 5);
+    }
+}
+
 TEST_CASE("HtsReaderTest: Read SAM line by line", TEST_GROUP) {
     fs::path aligner_test_dir = fs::path(get_data_dir("bam_reader"));
     auto sam = aligner_test_dir / "small.sam";
@@ -1,11 +1,15 @@
 #include "TestUtils.h"
 #include "read_pipeline/HtsReader.h"
+#include "utils/bam_pool.h"
+#include "utils/bam_record_builder.h"
 #include "utils/bam_utils.h"
 #include "utils/barcode_kits.h"
 
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <numeric>
 #include <optional>
@@ -290,3 +294,82 @@ TEST_CASE("BamUtilsTest: Remove all alignment tags", TEST_GROUP) {
 
     CHECK(bam_aux_first(record) == nullptr);
 }
+
+TEST_CASE("BamUtilsTest: BamRecordBuilder matches bam_aux_append", TEST_GROUP) {
+    const std::string qname = "read_0";
+    const std::string seq = "ACGTTGCAN";
+    const std::string qstring = "!+5?IIII!";
+    const std::vector<uint8_t> moves{1, 0, 1, 1};
+    const std::vector<uint8_t> probs{3, 250};
+
+    // Reference record built with the htslib aux API, one tag at a time.
+    std::vector<uint8_t> phred(qstring.size());
+    std::transform(qstring.begin(), qstring.end(), phred.begin(),
+                   [](char c) { return uint8_t(c - 33); });
+    BamPtr expected(bam_init1());
+    bam_set1(expected.get(), qname.size(), qname.c_str(), BAM_FUNMAP, -1, -1, 0, 0, nullptr, -1,
+             -1, 0, seq.size(), seq.c_str(), reinterpret_cast<const char *>(phred.data()), 0);
+    float qs = 12.5f;
+    bam_aux_append(expected.get(), "qs", 'f', sizeof(qs), reinterpret_cast<uint8_t *>(&qs));
+    int32_t rn = -1;
+    bam_aux_append(expected.get(), "rn", 'i', sizeof(rn), reinterpret_cast<uint8_t *>(&rn));
+    const std::string rg = "run_model";
+    bam_aux_append(expected.get(), "RG", 'Z', int(rg.size() + 1),
+                   reinterpret_cast<const uint8_t *>(rg.c_str()));
+    bam_aux_update_array(expected.get(), "mv", 'c', int(moves.size()),
+                         const_cast<uint8_t *>(moves.data()));
+    bam_aux_update_array(expected.get(), "ML", 'C', int(probs.size()),
+                         const_cast<uint8_t *>(probs.data()));
+
+    utils::BamRecordBuilder builder;
+    builder.append_string("XX", "discarded by reset");
+    builder.reset();
+    builder.append_float("qs", qs);
+    builder.append_int("rn", rn);
+    builder.append_string("RG", rg);
+    std::copy(moves.begin(), moves.end(), builder.append_byte_array("mv", 'c', moves.size()));
+    std::copy(probs.begin(), probs.end(), builder.append_byte_array("ML", 'C', probs.size()));
+    auto record = builder.build_unmapped(qname, BAM_FUNMAP, seq, qstring);
+
+    CHECK(record->core.flag == BAM_FUNMAP);
+    CHECK(record->core.tid == -1);
+    CHECK(record->core.pos == -1);
+    CHECK(record->core.mpos == -1);
+    CHECK(record->core.l_qseq == int32_t(seq.size()));
+    CHECK(bam_get_l_aux(record.get()) == int(builder.aux_size()));
+    REQUIRE(record->l_data == expected->l_data);
+    CHECK(std::memcmp(record->data, expected->data, record->l_data) == 0);
+
+    CHECK_THROWS(builder.build_unmapped(qname, BAM_FUNMAP, seq, "!!"));
+}
+
+TEST_CASE("BamUtilsTest: recycled records keep their data buffer", TEST_GROUP) {
+    const std::string qname = "read_1";
+    const std::string seq = "ACGTACGTACGT";
+    const auto get_hits = [] {
+        auto [name, stats] = utils::bam_pool_stats_report();
+        CHECK(name == "bam_pool");
+        return stats.at("hits");
+    };
+
+    auto record = utils::acquire_bam();
+    REQUIRE(bam_set1(record.get(), qname.size(), qname.data(), BAM_FUNMAP, -1, -1, 0, 0, nullptr,
+                     -1, -1, 0, seq.size(), seq.data(), nullptr, 0) >= 0);
+    const auto* const record_ptr = record.get();
+    const auto* const data_ptr = record->data;
+    const auto capacity = record->m_data;
+    record.reset();
+
+    // Released records go to this thread's cache, so the next acquire gets it back.
+    const auto hits = get_hits();
+    auto recycled = utils::acquire_bam();
+    CHECK(get_hits() == hits + 1);
+    REQUIRE(recycled.get() == record_ptr);
+    CHECK(recycled->data == data_ptr);
+    CHECK(recycled->m_data == capacity);
+    CHECK(recycled->l_data == 0);
+    CHECK(recycled->core.l_qseq == 0);
+
+    auto copy = utils::duplicate_bam(recycled.get());
+    CHECK(copy->l_data == 0);
+}
@@ -1,4 +1,5 @@
 #include "TestUtils.h"
+#include "read_pipeline/DefaultClientInfo.h"
 #include "read_pipeline/HtsReader.h"
 #include "read_pipeline/HtsWriter.h"
 #include "utils/bam_utils.h"
@@ -9,6 +10,9 @@
 #include <htslib/sam.h>
 
 #include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
 
 #define TEST_GROUP "[bam_utils][hts_writer]"
 
@@ -81,6 +85,47 @@ TEST_CASE_METHOD(HtsWriterTestsFixture, "HtsWriter: Count reads written", TEST_G
     CHECK(stats.at("split_reads_written") == 2);
 }
 
+TEST_CASE("HtsWriterTest: Write each client's records to its own output", TEST_GROUP) {
+    const auto in_sam = fs::path(get_data_dir("bam_reader")) / "small.sam";
+    auto tmp_dir = make_temp_dir("writer_test");
+
+    PipelineDescriptor pipeline_desc;
+    pipeline_desc.add_node<HtsWriter>({}, "");
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    const std::vector<std::string> filenames = {(tmp_dir.m_path / "first.sam").string(),
+                                                (tmp_dir.m_path / "second.sam").string()};
+    std::vector<std::unique_ptr<HtsFile>> files;
+    std::vector<std::shared_ptr<HtsWriterOutput>> outputs;
+    for (const auto& filename : filenames) {
+        HtsReader reader(in_sam.string(), std::nullopt);
+        files.push_back(std::make_unique<HtsFile>(filename, HtsFile::OutputMode::SAM, 0, false));
+        files.back()->set_header(reader.header());
+        outputs.push_back(std::make_shared<HtsWriterOutput>(*files.back()));
+        auto client_info = std::make_shared<DefaultClientInfo>();
+        client_info->contexts().register_context<HtsWriterOutput>(outputs.back());
+        reader.set_client_info(client_info);
+        auto& output = *outputs.back();
+        reader.set_record_mutator([&output](BamPtr&) { output.add_pending(1); });
+        reader.read(*pipeline, 0);
+    }
+
+    // Each output can be finalised once its records are written, while the pipeline runs.
+    for (size_t i = 0; i < files.size(); ++i) {
+        outputs[i]->wait_until_written();
+        CHECK(outputs[i]->total == 11);  // SAM file has 11 reads.
+        files[i]->finalise([](size_t) { /* noop */ });
+
+        HtsReader reader(filenames[i], std::nullopt);
+        size_t read_count = 0;
+        while (reader.read()) {
+            read_count++;
+        }
+        CHECK(read_count == 11);
+    }
+    pipeline->terminate(DefaultFlushOptions());
+}
+
 TEST_CASE("HtsWriterTest: Read and write FASTQ with tag", TEST_GROUP) {
     fs::path bam_test_dir = fs::path(get_data_dir("bam_reader"));
     std::string input_fastq_name = GENERATE("fastq_with_tags.fq", "fastq_with_us_and_tags.fq");
@@ -12,6 +12,7 @@
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <filesystem>
 #include <string>
@@ -70,7 +71,13 @@ TEST_CASE("BarcodeDemuxerNode: check correct output files are created", TEST_GRO
 
         pipeline->terminate(DefaultFlushOptions());
 
-        demux_writer_ref.finalise_hts_files([](size_t) { /* noop */ });
+        std::vector<size_t> progress_updates;
+        demux_writer_ref.finalise_hts_files(
+                [&progress_updates](size_t progress) { progress_updates.push_back(progress); });
+        // The files are finalised concurrently, but progress is still reported in order.
+        REQUIRE(!progress_updates.empty());
+        CHECK(std::is_sorted(progress_updates.begin(), progress_updates.end()));
+        CHECK(progress_updates.back() == 100);
 
         const std::unordered_set<std::string> expected_files = {
                 "unknown_run_id_bc01.bam", "unknown_run_id_bc01.bam.bai",
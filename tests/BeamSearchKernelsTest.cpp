@@ -0,0 +1,114 @@
+#include "basecall/decode/beam_search_kernels.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#define CUT_TAG "[beam_search_kernels]"
+
+namespace dorado::basecall::decode::beam_search_kernels {
+
+namespace {
+
+struct Element {
+    uint32_t hash;
+    uint16_t state;
+    uint8_t prev_element_index;
+    bool stay;
+
+    bool operator==(const Element& other) const {
+        return hash == other.hash && state == other.state &&
+               prev_element_index == other.prev_element_index && stay == other.stay;
+    }
+};
+
+// Scores with plenty of ties, and the extreme values that the beam search uses.
+std::vector<float> random_scores(std::mt19937& gen, size_t num_scores) {
+    std::uniform_int_distribution<int> dist(0, 40);
+    std::vector<float> scores(num_scores);
+    for (auto& score : scores) {
+        const int value = dist(gen);
+        if (value == 0) {
+            score = std::numeric_limits<float>::lowest();
+        } else if (value == 1) {
+            score = std::numeric_limits<float>::quiet_NaN();
+        } else {
+            score = static_cast<float>(value) / 4.0f;
+        }
+    }
+    return scores;
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": crc32c of a base", CUT_TAG) {
+    // Adding 2 bits twice is the same as adding 4 bits.
+    const uint32_t crc = 0x12345678u;
+    CHECK(DefaultKernels::hash_base(DefaultKernels::hash_base(crc, 3), 1) ==
+          crc32c<4>(crc, 0b0111));
+    CHECK(DefaultKernels::hash_state(crc, 0) == crc32c<32>(crc, 0));
+}
+
+#if ENABLE_AVX2_IMPL
+TEST_CASE(CUT_TAG ": AVX2 kernels match the default kernels", CUT_TAG) {
+    if (!utils::cpu_supports_avx2()) {
+        WARN("AVX2 is not supported on this CPU");
+        return;
+    }
+
+    std::mt19937 gen{42};
+
+    SECTION("hashes") {
+        std::uniform_int_distribution<uint32_t> dist;
+        for (int i = 0; i < 10000; ++i) {
+            const uint32_t crc = dist(gen);
+            const uint32_t state = dist(gen);
+            CAPTURE(crc, state);
+            CHECK(Avx2Kernels::hash_state(crc, state) == DefaultKernels::hash_state(crc, state));
+            for (uint32_t base = 0; base < 4; ++base) {
+                CHECK(Avx2Kernels::hash_base(crc, base) == DefaultKernels::hash_base(crc, base));
+            }
+        }
+    }
+
+    SECTION("beam cut") {
+        for (size_t num_scores : {0, 1, 7, 8, 9, 160, 161, 1280}) {
+            const auto scores = random_scores(gen, num_scores);
+            std::vector<Element> elements(num_scores);
+            for (size_t i = 0; i < num_scores; ++i) {
+                elements[i] = {static_cast<uint32_t>(gen()), static_cast<uint16_t>(i),
+                               static_cast<uint8_t>(i), (i % 3) == 0};
+            }
+
+            for (float cutoff : {std::numeric_limits<float>::lowest(), 0.0f, 2.5f, 5.0f, 9.0f}) {
+                CAPTURE(num_scores, cutoff);
+                const size_t count =
+                        DefaultKernels::count_at_least(scores.data(), num_scores, cutoff);
+                CHECK(Avx2Kernels::count_at_least(scores.data(), num_scores, cutoff) == count);
+
+                for (size_t max_selected : {size_t{1}, size_t{32}, count / 2, count, num_scores}) {
+                    CAPTURE(max_selected);
+                    std::vector<Element> expected(num_scores), selected(num_scores);
+                    std::vector<float> expected_scores(num_scores), selected_scores(num_scores);
+                    const auto num_expected = DefaultKernels::select_at_least(
+                            elements.data(), scores.data(), num_scores, cutoff, max_selected,
+                            expected.data(), expected_scores.data());
+                    const auto num_selected = Avx2Kernels::select_at_least(
+                            elements.data(), scores.data(), num_scores, cutoff, max_selected,
+                            selected.data(), selected_scores.data());
+                    CHECK(num_expected == std::min(count, max_selected));
+                    REQUIRE(num_selected == num_expected);
+                    CHECK(selected == expected);
+                    CHECK(selected_scores == expected_scores);
+                }
+            }
+        }
+    }
+}
+#endif
+
+}  // namespace dorado::basecall::decode::beam_search_kernels
@@ -0,0 +1,120 @@
+#include "basecall/decode/Decoder.h"
+#include "basecall/decode/beam_search.h"
+#include "utils/simd.h"
+
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#define CUT_TAG "[beam_search]"
+
+namespace dorado::basecall::decode {
+
+namespace {
+
+// 3-mer states, so the beam is narrower than the number of states and the initial beam is cut.
+constexpr int64_t NUM_STATES = 64;
+constexpr int64_t NUM_BLOCKS = 200;
+constexpr size_t BEAM_WIDTH = 16;
+// Scores are multiples of this, so they're exact as floats, halves and scaled int8s.
+constexpr float BYTE_SCORE_SCALE = 0.125f;
+
+DecodedChunk decode(const at::Tensor& scores,
+                    const at::Tensor& back_guides,
+                    const at::Tensor& posts,
+                    float byte_score_scale,
+                    bool use_simd_kernels = true) {
+    auto workspace = create_beam_search_workspace(use_simd_kernels);
+    DecodedChunk result;
+    beam_search_decode(scores, back_guides, posts, BEAM_WIDTH, 100.0f, 2.0f, 0.0f, 1.0f,
+                       byte_score_scale, *workspace, result);
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": int8 and half scores decode as the same float scores", CUT_TAG) {
+    torch::manual_seed(42);
+    const auto int8_scores = torch::randint(-60, 61, {NUM_BLOCKS, NUM_STATES * 4}, torch::kChar);
+    const auto float_scores = int8_scores.to(torch::kFloat) * BYTE_SCORE_SCALE;
+    const auto half_scores = float_scores.to(torch::kHalf);
+    // The back guides are always floats, and pick the initial beam.
+    const auto back_guides = torch::randn({NUM_BLOCKS + 1, NUM_STATES}) * 3.0f;
+
+    // int8 scores come with int16 posts, so the float posts are made from those.
+    const auto int16_posts =
+            (torch::softmax(torch::randn({NUM_BLOCKS + 1, NUM_STATES}), -1) * 32767.0f)
+                    .round()
+                    .to(torch::kShort);
+    const auto float_posts = int16_posts.to(torch::kFloat) * static_cast<float>(1.0 / 32767.0);
+
+    const auto expected = decode(float_scores, back_guides, float_posts, 1.0f);
+    REQUIRE(!expected.sequence.empty());
+
+    SECTION("int8") {
+        const auto result = decode(int8_scores, back_guides, int16_posts, BYTE_SCORE_SCALE);
+        CHECK(result.sequence == expected.sequence);
+        CHECK(result.qstring == expected.qstring);
+        CHECK(result.moves == expected.moves);
+    }
+
+    SECTION("half") {
+        const auto result = decode(half_scores, back_guides, float_posts, 1.0f);
+        CHECK(result.sequence == expected.sequence);
+        CHECK(result.qstring == expected.qstring);
+        CHECK(result.moves == expected.moves);
+    }
+}
+
+TEST_CASE(CUT_TAG ": a workspace can be reused for chunks of different sizes", CUT_TAG) {
+    torch::manual_seed(42);
+    auto workspace = create_beam_search_workspace();
+    for (int64_t num_blocks : {NUM_BLOCKS, NUM_BLOCKS / 4, NUM_BLOCKS * 2}) {
+        CAPTURE(num_blocks);
+        const auto scores = torch::randn({num_blocks, NUM_STATES * 4});
+        const auto back_guides = torch::randn({num_blocks + 1, NUM_STATES});
+        const auto posts = torch::softmax(torch::randn({num_blocks + 1, NUM_STATES}), -1);
+
+        DecodedChunk result;
+        beam_search_decode(scores, back_guides, posts, BEAM_WIDTH, 100.0f, 2.0f, 0.0f, 1.0f, 1.0f,
+                           *workspace, result);
+        const auto expected = decode(scores, back_guides, posts, 1.0f);
+        CHECK(result.sequence == expected.sequence);
+        CHECK(result.qstring == expected.qstring);
+        CHECK(result.moves == expected.moves);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+TEST_CASE(CUT_TAG ": AVX2 kernels decode as the default kernels", CUT_TAG) {
+    if (!utils::cpu_supports_avx2()) {
+        WARN("AVX2 is not supported on this CPU");
+        return;
+    }
+
+    torch::manual_seed(42);
+    const auto float_scores = torch::randn({NUM_BLOCKS, NUM_STATES * 4}) * 2.0f;
+    const auto back_guides = torch::randn({NUM_BLOCKS + 1, NUM_STATES}) * 3.0f;
+    const auto float_posts = torch::softmax(torch::randn({NUM_BLOCKS + 1, NUM_STATES}), -1);
+
+    at::Tensor scores = float_scores, posts = float_posts;
+    float byte_score_scale = 1.0f;
+    SECTION("float") {}
+    SECTION("int8") {
+        scores = torch::randint(-60, 61, {NUM_BLOCKS, NUM_STATES * 4}, torch::kChar);
+        posts = (float_posts * 32767.0f).round().to(torch::kShort);
+        byte_score_scale = BYTE_SCORE_SCALE;
+    }
+    SECTION("half") { scores = float_scores.to(torch::kHalf); }
+
+    CAPTURE(scores.dtype().name());
+    const auto expected = decode(scores, back_guides, posts, byte_score_scale, false);
+    const auto result = decode(scores, back_guides, posts, byte_score_scale);
+    REQUIRE(!expected.sequence.empty());
+    CHECK(result.sequence == expected.sequence);
+    CHECK(result.qstring == expected.qstring);
+    CHECK(result.moves == expected.moves);
+}
+#endif
+
+}  // namespace dorado::basecall::decode
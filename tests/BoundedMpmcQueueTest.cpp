@@ -0,0 +1,248 @@
+#include "utils/AsyncQueue.h"
+#include "utils/BoundedMpmcQueue.h"
+
+#include <catch2/catch.hpp>
+
+#define TEST_GROUP "BoundedMpmcQueue "
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using dorado::utils::AsyncQueue;
+using dorado::utils::AsyncQueueStatus;
+using dorado::utils::BoundedMpmcQueue;
+
+TEST_CASE(TEST_GROUP ": InputsMatchOutputs") {
+    const int n = 10;
+    BoundedMpmcQueue<int> queue(n);
+
+    for (int i = 0; i < n; ++i) {
+        int ii = i;
+        const auto status = queue.try_push(std::move(ii));
+        REQUIRE(status == AsyncQueueStatus::Success);
+    }
+    CHECK(queue.size() == n);
+    for (int i = 0; i < n; ++i) {
+        int val = -1;
+        const auto status = queue.try_pop(val);
+        REQUIRE(status == AsyncQueueStatus::Success);
+        CHECK(val == i);
+    }
+    CHECK(queue.size() == 0);
+}
+
+TEST_CASE(TEST_GROUP ": PushFailsIfTerminating") {
+    BoundedMpmcQueue<int> queue(1);
+    queue.terminate();
+    const auto status = queue.try_push(42);
+    CHECK(status == AsyncQueueStatus::Terminate);
+}
+
+TEST_CASE(TEST_GROUP ": PopFailsIfTerminating") {
+    BoundedMpmcQueue<int> queue(1);
+    queue.terminate();
+    int val;
+    const auto status = queue.try_pop(val);
+    CHECK(status == AsyncQueueStatus::Terminate);
+}
+
+TEST_CASE(TEST_GROUP ": PopSucceedsIfTerminatingWithItems") {
+    BoundedMpmcQueue<int> queue(1);
+    REQUIRE(queue.try_push(42) == AsyncQueueStatus::Success);
+    queue.terminate();
+    int val = -1;
+    CHECK(queue.try_pop(val) == AsyncQueueStatus::Success);
+    CHECK(val == 42);
+    CHECK(queue.try_pop(val) == AsyncQueueStatus::Terminate);
+}
+
+TEST_CASE(TEST_GROUP ": PushPopSucceedAfterRestarting") {
+    BoundedMpmcQueue<int> queue(1);
+    queue.terminate();
+    queue.restart();
+    const auto push_status = queue.try_push(42);
+    CHECK(push_status == AsyncQueueStatus::Success);
+    int val;
+    const auto pop_status = queue.try_pop(val);
+    CHECK(pop_status == AsyncQueueStatus::Success);
+}
+
+TEST_CASE(TEST_GROUP ": PopTimesOut") {
+    BoundedMpmcQueue<int> queue(1);
+    int val = -1;
+    const auto status = queue.try_pop_until(
+            val, std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+    CHECK(status == AsyncQueueStatus::Timeout);
+}
+
+// Spawned thread sits waiting for an item.
+// Main thread supplies that item.
+TEST_CASE(TEST_GROUP ": PopFromOtherThread") {
+    BoundedMpmcQueue<int> queue(1);
+    std::atomic_bool thread_started{false};
+    AsyncQueueStatus pop_status;
+
+    auto popping_thread = std::thread([&]() {
+        thread_started.store(true);
+        int val = -1;
+        // catch2 isn't thread safe so we have to check this on the main thread
+        pop_status = queue.try_pop(val);
+    });
+
+    // Wait for thread to start
+    while (!thread_started.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    // Feed data to the thread
+    const auto push_status = queue.try_push(42);
+    CHECK(push_status == AsyncQueueStatus::Success);
+
+    popping_thread.join();
+    CHECK(pop_status == AsyncQueueStatus::Success);
+}
+
+// Spawned thread sits waiting for space.
+// Main thread terminates wait.
+TEST_CASE(TEST_GROUP ": TerminateFullQueueFromOtherThread") {
+    BoundedMpmcQueue<int> queue(1);
+    REQUIRE(queue.try_push(1) == AsyncQueueStatus::Success);
+    std::atomic_bool thread_started{false};
+    AsyncQueueStatus push_status;
+
+    auto pushing_thread = std::thread([&]() {
+        thread_started.store(true);
+        // catch2 isn't thread safe so we have to check this on the main thread
+        push_status = queue.try_push(2);
+    });
+
+    // Wait for thread to start
+    while (!thread_started.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    // Stop it
+    queue.terminate();
+    pushing_thread.join();
+
+    // This will fail, since the wait is terminated.
+    CHECK(push_status == AsyncQueueStatus::Terminate);
+}
+
+TEST_CASE(TEST_GROUP ": try_push_n and process_and_pop_n") {
+    const int n = 10;
+    BoundedMpmcQueue<int> queue(n);
+    std::vector<int> items(n);
+    std::iota(items.begin(), items.end(), 0);
+    REQUIRE(queue.try_push_n(std::move(items)) == AsyncQueueStatus::Success);
+    CHECK(queue.size() == n);
+
+    std::vector<int> popped_items;
+    auto pop_item = [&popped_items](int popped) { popped_items.push_back(popped); };
+
+    // Pop 5 of the items.
+    auto status = queue.process_and_pop_n(pop_item, 5);
+    REQUIRE(status == AsyncQueueStatus::Success);
+    CHECK(popped_items.size() == 5);
+    CHECK(queue.size() == 5);
+
+    // Pop the other 5 items.
+    status = queue.process_and_pop_n(pop_item, 5);
+    REQUIRE(status == AsyncQueueStatus::Success);
+
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    CHECK(popped_items == expected);
+    CHECK(queue.size() == 0);
+}
+
+namespace {
+
+// Moves num_items unique_ptrs from num_threads producers to num_threads consumers through
+// the queue, pushing and popping in batches of batch_size.  Returns the sum of the values
+// received.
+template <class Queue>
+int64_t run_producers_consumers(Queue& queue, int num_threads, int num_items, int batch_size) {
+    queue.restart();
+    std::atomic<int64_t> total{0};
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < num_threads; ++t) {
+        consumers.emplace_back([&] {
+            int64_t sum = 0;
+            auto add_item = [&sum](std::unique_ptr<int> item) { sum += *item; };
+            while (queue.process_and_pop_n(add_item, batch_size) == AsyncQueueStatus::Success) {
+            }
+            total += sum;
+        });
+    }
+    std::vector<std::thread> producers;
+    for (int t = 0; t < num_threads; ++t) {
+        producers.emplace_back([&, t] {
+            std::vector<std::unique_ptr<int>> batch;
+            for (int i = t; i < num_items; i += num_threads) {
+                batch.push_back(std::make_unique<int>(i));
+                if (int(batch.size()) == batch_size) {
+                    queue.try_push_n(std::move(batch));
+                }
+            }
+            if (!batch.empty()) {
+                queue.try_push_n(std::move(batch));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    queue.terminate();
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    return total;
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP ": MultipleProducersConsumers") {
+    const int num_items = 10000;
+    const int64_t expected = int64_t(num_items) * (num_items - 1) / 2;
+    // Capacity 1 takes the path where pushes check the pop position rather than the slot.
+    for (size_t capacity : {1, 16}) {
+        for (int num_threads : {1, 2, 8}) {
+            for (int batch_size : {1, 7}) {
+                CAPTURE(capacity, num_threads, batch_size);
+                BoundedMpmcQueue<std::unique_ptr<int>> queue(capacity);
+                const auto total =
+                        run_producers_consumers(queue, num_threads, num_items, batch_size);
+                CHECK(total == expected);
+                CHECK(queue.size() == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE(TEST_GROUP ": contention benchmark", "[.][benchmark]") {
+    const int num_items = 100000;
+    const size_t capacity = 1000;
+    for (int num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+        for (int batch_size : {1, 16}) {
+            // num_threads producers and num_threads consumers.
+            const auto suffix = std::to_string(num_threads) + "+" + std::to_string(num_threads) +
+                                " threads, batch " + std::to_string(batch_size);
+            BENCHMARK("AsyncQueue " + suffix) {
+                AsyncQueue<std::unique_ptr<int>> queue(capacity);
+                return run_producers_consumers(queue, num_threads, num_items, batch_size);
+            };
+            BENCHMARK("BoundedMpmcQueue " + suffix) {
+                BoundedMpmcQueue<std::unique_ptr<int>> queue(capacity);
+                return run_producers_consumers(queue, num_threads, num_items, batch_size);
+            };
+        }
+    }
+}
@@ -90,6 +90,7 @@ struct Tester {
             ++index;
             record.reset(bam_init1());
         }
+        CHECK(index == records.size());
         file_in.reset();
         header_in.reset();
     }
@@ -129,10 +130,12 @@ TEST_CASE("HtsFileTest: Write to single sorted file", TEST_GROUP) {
     tester.read_input_records();
 
     // A 5 MB buffer should make sure only a single temp file is written.
+    // It's indexed as it's written, so there's no separate indexing step to report progress for.
     int callback_calls = tester.write_output_records(5000000);
-    REQUIRE(callback_calls == 3);
+    REQUIRE(callback_calls == 2);
 
     tester.check_output(true);
+    CHECK(fs::exists(tester.file_out_path.string() + ".bai"));
 }
 
 TEST_CASE("HtsFileTest: Write to multiple sorted files, and merge", TEST_GROUP) {
@@ -143,6 +146,26 @@ TEST_CASE("HtsFileTest: Write to multiple sorted files, and merge", TEST_GROUP)
     int callback_calls = tester.write_output_records(200000);
     REQUIRE(callback_calls > 4);
 
+    tester.check_output(true);
+    CHECK(fs::exists(tester.file_out_path.string() + ".bai"));
+}
+
+TEST_CASE("HtsFileTest: Write record larger than the sort buffer", TEST_GROUP) {
+    Tester tester;
+    tester.read_input_records();
+
+    // A placed unmapped record whose data alone is bigger than the minimum 100 KB buffer.
+    const std::string qname = "oversized_read";
+    const std::string seq(100000, 'A');
+    BamPtr oversized(bam_init1());
+    REQUIRE(bam_set1(oversized.get(), qname.size(), qname.c_str(), BAM_FUNMAP, 0, 100, 0, 0,
+                     nullptr, -1, -1, 0, seq.size(), seq.c_str(), nullptr, 0) >= 0);
+    tester.records.push_back(std::move(oversized));
+    tester.indices.push_back(tester.records.size() - 1);
+    std::swap(tester.indices.front(), tester.indices.back());
+
+    tester.write_output_records(100000);
+
     tester.check_output(true);
 }
 
@@ -55,7 +55,7 @@ inline size_t CountSinkReads(const std::filesystem::path& data_path,
                              size_t num_worker_threads,
                              size_t max_reads,
                              std::optional<std::unordered_set<std::string>> read_list,
-                             std::unordered_set<std::string> read_ignore_list) {
+                             dorado::utils::ReadIdSet read_ignore_list) {
     dorado::PipelineDescriptor pipeline_desc;
     std::vector<dorado::Message> messages;
     pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
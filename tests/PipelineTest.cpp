@@ -187,4 +187,57 @@ TEST_CASE("TerminateRestart", TEST_GROUP) {
     pipeline->push_message(std::make_unique<dorado::SimplexRead>());
     pipeline.reset();
     CHECK(messages.size() == 2);
-}
\ No newline at end of file
+}
+
+// Test groups of messages are routed in order, and counted individually in queue stats.
+TEST_CASE("BatchedMessageFlow", TEST_GROUP) {
+    // Node that forwards its input in groups of up to 4 messages.
+    class GroupForwarderNode : public MessageSink {
+    public:
+        GroupForwarderNode() : MessageSink(3, 1) {}
+        ~GroupForwarderNode() { stop_input_processing(); }
+        std::string get_name() const override { return "GroupForwarderNode"; }
+        dorado::stats::NamedStats sample_stats() const override {
+            return dorado::stats::from_obj(m_work_queue);
+        }
+        void terminate(const dorado::FlushOptions&) override { stop_input_processing(); }
+        void restart() override {
+            start_input_processing([this] { input_thread_fn(); }, "group_forwarder");
+        }
+
+    private:
+        void input_thread_fn() {
+            std::vector<dorado::Message> messages;
+            while (get_input_messages(messages, 4)) {
+                send_messages_to_sink(std::move(messages));
+            }
+        }
+    };
+
+    const size_t kNumReads = 50;
+    PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> messages;
+    auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 5, messages);
+    pipeline_desc.add_node<GroupForwarderNode>({sink});
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+    REQUIRE(pipeline != nullptr);
+
+    std::vector<dorado::Message> reads;
+    for (size_t i = 0; i < kNumReads; ++i) {
+        auto read = std::make_unique<dorado::SimplexRead>();
+        read->read_common.read_id = std::to_string(i);
+        reads.emplace_back(std::move(read));
+    }
+    pipeline->push_messages(std::move(reads));
+    CHECK(reads.empty());
+    const auto final_stats = pipeline->terminate(dorado::DefaultFlushOptions());
+    pipeline.reset();
+
+    REQUIRE(messages.size() == kNumReads);
+    for (size_t i = 0; i < kNumReads; ++i) {
+        const auto& read = std::get<dorado::SimplexReadPtr>(messages[i]);
+        CHECK(read->read_common.read_id == std::to_string(i));
+    }
+    CHECK(final_stats.at("GroupForwarderNode.queue.pushes") == double(kNumReads));
+    CHECK(final_stats.at("GroupForwarderNode.queue.pops") == double(kNumReads));
+}
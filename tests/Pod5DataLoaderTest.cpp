@@ -106,7 +106,7 @@ TEST_CASE(TEST_GROUP "Test loading POD5 file with read ignore list") {
     auto data_path = get_data_dir("multi_read_pod5");
 
     SECTION("read ignore list with 1 read") {
-        auto read_ignore_list = std::unordered_set<std::string>();
+        auto read_ignore_list = dorado::utils::ReadIdSet();
         read_ignore_list.insert("0007f755-bc82-432c-82be-76220b107ec5");  // read present in POD5
 
         CHECK(dorado::DataLoader::get_num_reads(data_path, std::nullopt, read_ignore_list, false) ==
@@ -117,7 +117,7 @@ TEST_CASE(TEST_GROUP "Test loading POD5 file with read ignore list") {
     SECTION("same read in read_ids and ignore list") {
         auto read_list = std::unordered_set<std::string>();
         read_list.insert("0007f755-bc82-432c-82be-76220b107ec5");  // read present in POD5
-        auto read_ignore_list = std::unordered_set<std::string>();
+        auto read_ignore_list = dorado::utils::ReadIdSet();
         read_ignore_list.insert("0007f755-bc82-432c-82be-76220b107ec5");  // read present in POD5
 
         CHECK(dorado::DataLoader::get_num_reads(data_path, read_list, read_ignore_list, false) ==
@@ -0,0 +1,80 @@
+#include "utils/read_id_set.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#define CUT_TAG "[dorado::utils::ReadIdSet]"
+
+namespace dorado::utils::read_id_set {
+
+TEST_CASE(CUT_TAG " parse_uuid", CUT_TAG) {
+    const auto uuid = ReadIdSet::parse_uuid("002bd127-db82-436f-b828-28567c3d505d");
+    REQUIRE(uuid.has_value());
+    CHECK((*uuid)[0] == 0x00);
+    CHECK((*uuid)[1] == 0x2b);
+    CHECK((*uuid)[15] == 0x5d);
+    CHECK_FALSE(ReadIdSet::parse_uuid("002BD127-DB82-436F-B828-28567C3D505D").has_value());
+
+    CHECK_FALSE(ReadIdSet::parse_uuid("read_1").has_value());
+    CHECK_FALSE(ReadIdSet::parse_uuid("002bd127db82-436f-b828-28567c3d505d0").has_value());
+    CHECK_FALSE(ReadIdSet::parse_uuid("002bd127-db82-436f-b828-28567c3d505g").has_value());
+}
+
+TEST_CASE(CUT_TAG " insert and lookup", CUT_TAG) {
+    ReadIdSet read_ids;
+    CHECK(read_ids.empty());
+
+    CHECK(read_ids.insert("002bd127-db82-436f-b828-28567c3d505d"));
+    CHECK(read_ids.insert("read_1"));
+    CHECK_FALSE(read_ids.insert("read_1"));
+    CHECK(read_ids.insert("00000000-0000-0000-0000-000000000000"));
+    CHECK(read_ids.size() == 3);
+
+    CHECK(read_ids.count("002bd127-db82-436f-b828-28567c3d505d") == 1);
+    CHECK(read_ids.contains(*ReadIdSet::parse_uuid("002bd127-db82-436f-b828-28567c3d505d")));
+    CHECK(read_ids.contains("read_1"));
+    CHECK(read_ids.contains("00000000-0000-0000-0000-000000000000"));
+    CHECK_FALSE(read_ids.contains("ccccdddd-db82-436f-b828-28567c3d505d"));
+    CHECK_FALSE(read_ids.contains("read_2"));
+}
+
+TEST_CASE(CUT_TAG " matches read IDs exactly, like a set of strings", CUT_TAG) {
+    ReadIdSet read_ids;
+    CHECK(read_ids.insert("002bd127-db82-436f-b828-28567c3d505d"));
+    CHECK(read_ids.insert("002BD127-DB82-436F-B828-28567C3D505D"));
+    CHECK(read_ids.size() == 2);
+    CHECK_FALSE(read_ids.contains("002bd127-DB82-436f-b828-28567c3d505d"));
+
+    ReadIdSet upper_case_ids;
+    CHECK(upper_case_ids.insert("7DE2B1B4-6C04-4E9B-8F3A-9D3C1E2F4A5B"));
+    CHECK(upper_case_ids.contains("7DE2B1B4-6C04-4E9B-8F3A-9D3C1E2F4A5B"));
+    CHECK_FALSE(upper_case_ids.contains("7de2b1b4-6c04-4e9b-8f3a-9d3c1e2f4a5b"));
+    CHECK_FALSE(
+            upper_case_ids.contains(*ReadIdSet::parse_uuid("7de2b1b4-6c04-4e9b-8f3a-9d3c1e2f4a5b")));
+}
+
+TEST_CASE(CUT_TAG " grows past its initial size", CUT_TAG) {
+    ReadIdSet read_ids;
+    const size_t num_reads = 10000;
+    for (size_t i = 0; i < num_reads; ++i) {
+        ReadIdSet::Uuid uuid{};
+        // Vary the leading bytes only, like time ordered UUIDs.
+        uuid[0] = static_cast<uint8_t>(i >> 8);
+        uuid[1] = static_cast<uint8_t>(i);
+        uuid[15] = 1;
+        CHECK(read_ids.insert(uuid));
+    }
+    CHECK(read_ids.size() == num_reads);
+    for (size_t i = 0; i < num_reads; ++i) {
+        ReadIdSet::Uuid uuid{};
+        uuid[0] = static_cast<uint8_t>(i >> 8);
+        uuid[1] = static_cast<uint8_t>(i);
+        uuid[15] = 1;
+        CHECK(read_ids.contains(uuid));
+        uuid[15] = 2;
+        CHECK_FALSE(read_ids.contains(uuid));
+    }
+}
+
+}  // namespace dorado::utils::read_id_set
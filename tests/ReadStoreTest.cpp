@@ -0,0 +1,46 @@
+#include "correct/read_store.h"
+
+#include "TestUtils.h"
+
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[correct][ReadStore]"
+
+using namespace dorado;
+
+TEST_CASE("Reads can be found in the read store", TEST_GROUP) {
+    auto temp_dir = tests::make_temp_dir("read_store_test");
+    auto input_file = temp_dir.m_path / "input.fq";
+
+    // The second read has a base which can't be packed into 2 bits.
+    const std::vector<std::string> read_ids = {"read1", "read2", "read3"};
+    const std::vector<std::string> seqs = {"ACTGATCG", "ACNGTA", "TTTTGGGGCCCCAAAAC"};
+    {
+        std::ofstream out(input_file);
+        for (size_t i = 0; i < read_ids.size(); ++i) {
+            out << '@' << read_ids[i] << " desc\n"
+                << seqs[i] << "\n+\n"
+                << std::string(seqs[i].size(), '5') << '\n';
+        }
+    }
+
+    correction::ReadStore store(input_file.string(), 1, temp_dir.m_path);
+    CHECK(store.num_reads() == read_ids.size());
+    for (size_t i = 0; i < read_ids.size(); ++i) {
+        CAPTURE(read_ids[i]);
+        auto read = store.find(read_ids[i]);
+        REQUIRE(read.has_value());
+        CHECK(read->length() == int(seqs[i].size()));
+        CHECK(read->bases(0, read->length()) == seqs[i]);
+        CHECK(read->bases(2, 3) == seqs[i].substr(2, 3));
+        CHECK(read->base(read->length() - 1) == seqs[i].back());
+        const std::vector<uint8_t> quals(read->quals(), read->quals() + read->length());
+        CHECK(quals == std::vector<uint8_t>(seqs[i].size(), '5' - 33));
+    }
+    CHECK_FALSE(store.find("read4").has_value());
+    CHECK_FALSE(store.find("read").has_value());
+}
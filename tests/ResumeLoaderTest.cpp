@@ -22,7 +22,7 @@ TEST_CASE(TEST_GROUP) {
     loader.copy_completed_reads();
     sink.terminate(dorado::DefaultFlushOptions());
     CHECK(messages.size() == 2);
-    auto read_ids = loader.get_processed_read_ids();
+    const auto& read_ids = loader.get_processed_read_ids();
     CHECK(read_ids.count("002bd127-db82-436f-b828-28567c3d505d") == 1);
     CHECK(read_ids.count("ccccdddd-db82-436f-b828-28567c3d505d") == 1);
 }
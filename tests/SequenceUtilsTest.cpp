@@ -2,9 +2,13 @@
 
 #include <catch2/catch.hpp>
 
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <optional>
+#include <random>
+#include <string>
+#include <vector>
 
 #define TEST_GROUP "[seq_utils]"
 
@@ -252,3 +256,82 @@ TEST_CASE("Test sequence to move table index", TEST_GROUP) {
         CHECK(res < 0);
     }
 }
+
+namespace {
+
+std::string random_sequence(std::mt19937& gen, size_t len) {
+    std::uniform_int_distribution<int> base_dist(0, 3);
+    std::string seq(len, ' ');
+    for (auto& base : seq) {
+        base = "ACGT"[base_dist(gen)];
+    }
+    return seq;
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP ": sequence_to_ints matches base_to_int", TEST_GROUP) {
+    std::mt19937 gen{42};
+    for (size_t len : {1, 7, 8, 9, 33, 1000}) {
+        CAPTURE(len);
+        const auto seq = random_sequence(gen, len);
+        const auto ints = sequence_to_ints(seq);
+        REQUIRE(ints.size() == len);
+        for (size_t i = 0; i < len; ++i) {
+            CHECK(ints[i] == base_to_int(seq[i]));
+        }
+    }
+}
+
+TEST_CASE(TEST_GROUP ": kmer_indices", TEST_GROUP) {
+    CHECK(kmer_indices({0, 1}, 3).empty());
+    CHECK(kmer_indices({0, 1, 2, 3}, 3) == std::vector<uint64_t>{0b00'01'10, 0b01'10'11});
+
+    std::mt19937 gen{42};
+    const auto seq_ints = sequence_to_ints(random_sequence(gen, 200));
+    for (size_t kmer_len : {1, 9, 32}) {
+        CAPTURE(kmer_len);
+        const auto indices = kmer_indices(seq_ints, kmer_len);
+        REQUIRE(indices.size() == seq_ints.size() - kmer_len + 1);
+        for (size_t pos = 0; pos < indices.size(); ++pos) {
+            uint64_t expected = 0;
+            for (size_t k = 0; k < kmer_len; ++k) {
+                expected = (expected << 2) | static_cast<uint64_t>(seq_ints[pos + k]);
+            }
+            CHECK(indices[pos] == expected);
+        }
+    }
+}
+
+TEST_CASE(TEST_GROUP ": mean_q_score of long strings", TEST_GROUP) {
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> q_dist(2, 40);
+    for (size_t len : {7, 8, 9, 1000, 100001}) {
+        CAPTURE(len);
+        std::string q_string(len, ' ');
+        double total_error = 0;
+        for (auto& q : q_string) {
+            const int qscore = q_dist(gen);
+            q = static_cast<char>('!' + qscore);
+            total_error += std::pow(10.0, -qscore / 10.0);
+        }
+        const auto expected = -10.0 * std::log10(total_error / static_cast<double>(len));
+        CHECK(mean_qscore_from_qstring(q_string) == Approx(expected).epsilon(1e-4));
+    }
+}
+
+TEST_CASE(TEST_GROUP ": sequence kernels benchmark", "[.][benchmark]") {
+    std::mt19937 gen{42};
+    const auto seq = random_sequence(gen, 100000);
+    const auto seq_ints = sequence_to_ints(seq);
+    std::string q_string(seq.size(), ' ');
+    std::uniform_int_distribution<int> q_dist('#', 'K');
+    for (auto& q : q_string) {
+        q = static_cast<char>(q_dist(gen));
+    }
+
+    BENCHMARK("reverse_complement") { return reverse_complement(seq); };
+    BENCHMARK("sequence_to_ints") { return sequence_to_ints(seq); };
+    BENCHMARK("kmer_indices") { return kmer_indices(seq_ints, 9); };
+    BENCHMARK("mean_qscore_from_qstring") { return mean_qscore_from_qstring(q_string); };
+}
@@ -0,0 +1,122 @@
+#include "read_pipeline/SequencingSummaryNode.h"
+
+#include "MessageSinkUtils.h"
+#include "TestUtils.h"
+#include "read_pipeline/DefaultClientInfo.h"
+#include "summary/summary_columns.h"
+#include "utils/types.h"
+
+#include <ATen/Functions.h>
+#include <catch2/catch.hpp>
+#include <htslib/sam.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[sequencing_summary_node]"
+
+using namespace dorado;
+
+namespace {
+SimplexReadPtr make_read(const std::string& read_id) {
+    auto read = std::make_unique<SimplexRead>();
+    read->read_common.raw_data = at::empty(100);
+    read->read_common.sample_rate = 4000;
+    read->read_common.read_id = read_id;
+    read->read_common.run_id = "run1";
+    read->read_common.model_name = "model";
+    read->read_common.seq = "ACGTACGT";
+    read->read_common.qstring = "////////";
+    read->read_common.num_trimmed_samples = 132;
+    read->read_common.attributes.mux = 2;
+    read->read_common.attributes.channel_number = 5;
+    read->read_common.attributes.start_time = "2017-04-29T09:10:04Z";
+    read->read_common.attributes.fast5_filename = "batch_0.pod5";
+    return read;
+}
+}  // namespace
+
+TEST_CASE("SequencingSummaryNode: rows from reads match rows from their BAM records",
+          TEST_GROUP) {
+    auto tmp_dir = tests::make_temp_dir("sequencing_summary_node");
+    const auto summary_path = (tmp_dir.m_path / "sequencing_summary.txt").string();
+    const auto columns_path = (tmp_dir.m_path / "sequencing_summary.dsc").string();
+
+    std::vector<Message> messages;
+    {
+        PipelineDescriptor pipeline_desc;
+        auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+        auto summary_node = pipeline_desc.add_node<SequencingSummaryNode>({sink}, summary_path,
+                                                                          columns_path, 2);
+        auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+
+        SamHdrPtr hdr(sam_hdr_init());
+        sam_hdr_add_line(hdr.get(), "RG", "ID", "run1_model", "DT", "2017-04-29T09:00:00Z",
+                         NULL);
+        auto& summary_node_ref =
+                dynamic_cast<SequencingSummaryNode&>(pipeline->get_node_ref(summary_node));
+        summary_node_ref.set_header(hdr.get());
+
+        auto read = make_read("read_1");
+        auto records = read->read_common.extract_sam_lines(false, 0, false);
+        pipeline->push_message(std::move(read));
+        auto client_info = std::make_shared<DefaultClientInfo>();
+        for (auto& record : records) {
+            pipeline->push_message(BamMessage{std::move(record), client_info});
+        }
+        pipeline->terminate(DefaultFlushOptions());
+    }
+    CHECK(messages.size() == 2);
+
+    std::ifstream summary_file(summary_path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(summary_file, line);) {
+        lines.push_back(line);
+    }
+    REQUIRE(lines.size() == 3);
+    CHECK(lines[0].rfind("filename\tread_id\trun_id\tchannel\tmux\tstart_time", 0) == 0);
+    CHECK(lines[1].rfind("batch_0.pod5\tread_1\trun1\t5\t2\t604\t", 0) == 0);
+    CHECK(lines[1] == lines[2]);
+
+    SummaryColumnsReader columns_reader(columns_path);
+    CHECK(columns_reader.read_chunk() == 2);
+    CHECK(columns_reader.read_chunk() == 0);
+}
+
+#ifdef __linux__
+TEST_CASE("SequencingSummaryNode: write failures are reported after terminate", TEST_GROUP) {
+    // Every write to /dev/full fails, but opening it succeeds.
+    std::vector<Message> messages;
+    PipelineDescriptor pipeline_desc;
+    auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+    auto summary_node = pipeline_desc.add_node<SequencingSummaryNode>({sink}, "/dev/full", "", 1);
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    SamHdrPtr hdr(sam_hdr_init());
+    auto& summary_node_ref =
+            dynamic_cast<SequencingSummaryNode&>(pipeline->get_node_ref(summary_node));
+    summary_node_ref.set_header(hdr.get());
+    pipeline->push_message(make_read("read_1"));
+    CHECK_NOTHROW(pipeline->terminate(DefaultFlushOptions()));
+    CHECK(summary_node_ref.write_failed());
+    // The nodes after the summary are still terminated.
+    CHECK(messages.size() == 1);
+}
+#endif
+
+TEST_CASE("SequencingSummaryNode: reads are passed on if the header isn't set", TEST_GROUP) {
+    std::vector<Message> messages;
+    PipelineDescriptor pipeline_desc;
+    auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+    auto summary_node = pipeline_desc.add_node<SequencingSummaryNode>({sink}, "", "", 1);
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    auto& summary_node_ref =
+            dynamic_cast<SequencingSummaryNode&>(pipeline->get_node_ref(summary_node));
+    pipeline->push_message(make_read("read_1"));
+    pipeline->terminate(DefaultFlushOptions());
+    CHECK(summary_node_ref.write_failed());
+    CHECK(messages.size() == 1);
+}
@@ -0,0 +1,190 @@
+#include "TestUtils.h"
+#include "summary/summary.h"
+#include "summary/summary_columns.h"
+
+#include <catch2/catch.hpp>
+#include <htslib/bgzf.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[summary_columns]"
+
+using namespace dorado;
+
+TEST_CASE("Summary columns round trip across chunks", TEST_GROUP) {
+    auto temp_dir = tests::make_temp_dir("summary_columns");
+    const auto path = (temp_dir.m_path / "summary.dsc").string();
+    const auto fields = SummaryData::GENERAL_FIELDS | SummaryData::BARCODING_FIELDS |
+                        SummaryData::ALIGNMENT_FIELDS;
+    const size_t num_rows = SummaryColumnsWriter::ROWS_PER_CHUNK + 10;
+
+    {
+        SummaryColumnsWriter writer(path, fields, 2);
+        for (size_t i = 0; i < num_rows; ++i) {
+            const auto read_id = "read_" + std::to_string(i);
+            SummaryRow row;
+            row.filename = "reads.pod5";
+            row.read_id = read_id;
+            row.channel = int64_t(i);
+            row.start_time = 0.5 * double(i);
+            row.mean_qscore = 12.5f;
+            row.barcode = (i % 2) ? "barcode01" : "unclassified";
+            row.alignment_genome_start = int32_t(i) - 1;
+            writer.add_row(row);
+        }
+        writer.close();
+        CHECK(writer.num_rows_written() == num_rows);
+    }
+
+    SummaryColumnsReader reader(path);
+    CHECK(reader.num_chunks() == 2);
+    const auto& columns = reader.columns();
+    const auto field_names = SummaryData::get_field_names(fields);
+    REQUIRE(columns.size() == field_names.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        CHECK(columns[i].name == field_names[i]);
+    }
+    auto column = [&columns](const std::string& name) -> const SummaryColumnsReader::Column& {
+        for (const auto& c : columns) {
+            if (c.name == name) {
+                return c;
+            }
+        }
+        throw std::runtime_error("Missing column " + name);
+    };
+
+    // The values of every chunk are gathered, then compared with the expected values at once.
+    std::vector<std::string> filenames, read_ids, barcodes, alignment_genomes;
+    std::vector<int64_t> channels, alignment_genome_starts;
+    std::vector<double> start_times, mean_qscores;
+    std::vector<size_t> chunk_sizes;
+    while (size_t chunk_rows = reader.read_chunk()) {
+        chunk_sizes.push_back(chunk_rows);
+        auto append = [](auto& values, const auto& chunk_values) {
+            values.insert(values.end(), chunk_values.begin(), chunk_values.end());
+        };
+        append(filenames, column("filename").strings);
+        append(read_ids, column("read_id").strings);
+        append(barcodes, column("barcode").strings);
+        append(alignment_genomes, column("alignment_genome").strings);
+        append(channels, column("channel").ints);
+        append(alignment_genome_starts, column("alignment_genome_start").ints);
+        append(start_times, column("start_time").reals);
+        append(mean_qscores, column("mean_qscore_template").reals);
+    }
+    CHECK(chunk_sizes == std::vector<size_t>{SummaryColumnsWriter::ROWS_PER_CHUNK, 10});
+
+    std::vector<std::string> expected_read_ids(num_rows), expected_barcodes(num_rows);
+    std::vector<int64_t> expected_channels(num_rows), expected_genome_starts(num_rows);
+    std::vector<double> expected_start_times(num_rows);
+    for (size_t i = 0; i < num_rows; ++i) {
+        expected_read_ids[i] = "read_" + std::to_string(i);
+        expected_barcodes[i] = (i % 2) ? "barcode01" : "unclassified";
+        expected_channels[i] = int64_t(i);
+        expected_genome_starts[i] = int64_t(i) - 1;
+        expected_start_times[i] = 0.5 * double(i);
+    }
+    CHECK(filenames == std::vector<std::string>(num_rows, "reads.pod5"));
+    CHECK(read_ids == expected_read_ids);
+    CHECK(barcodes == expected_barcodes);
+    CHECK(alignment_genomes == std::vector<std::string>(num_rows, "*"));
+    CHECK(channels == expected_channels);
+    CHECK(alignment_genome_starts == expected_genome_starts);
+    CHECK(start_times == expected_start_times);
+    CHECK(mean_qscores == std::vector<double>(num_rows, 12.5));
+
+    SECTION("Only the selected columns are read") {
+        SummaryColumnsReader selected_reader(path);
+        selected_reader.select_columns({"read_id", "start_time"});
+        CHECK_THROWS_AS(selected_reader.select_columns({"no_such_column"}), std::runtime_error);
+        std::vector<std::string> selected_read_ids;
+        std::vector<double> selected_start_times;
+        while (selected_reader.read_chunk()) {
+            for (const auto& c : selected_reader.columns()) {
+                if (c.name == "read_id") {
+                    selected_read_ids.insert(selected_read_ids.end(), c.strings.begin(),
+                                             c.strings.end());
+                } else if (c.name == "start_time") {
+                    selected_start_times.insert(selected_start_times.end(), c.reals.begin(),
+                                                c.reals.end());
+                } else {
+                    CHECK(c.ints.empty());
+                    CHECK(c.reals.empty());
+                    CHECK(c.strings.empty());
+                }
+            }
+        }
+        CHECK(selected_read_ids == expected_read_ids);
+        CHECK(selected_start_times == expected_start_times);
+    }
+}
+
+TEST_CASE("Summary columns reader rejects corrupt sizes", TEST_GROUP) {
+    auto temp_dir = tests::make_temp_dir("summary_columns");
+    const auto path = (temp_dir.m_path / "corrupt.dsc").string();
+
+    // A single int32 column named "x", with the counts written out little-endian by hand.
+    std::string header = "DSUMCOL2";
+    header += std::string("\x01\x00\x00\x00", 4);
+    header += 'i';
+    header += std::string("\x01\x00", 2);
+    header += 'x';
+    auto write = [](BGZF* file, const std::string& data) {
+        CHECK(bgzf_write(file, data.data(), data.size()) == int64_t(data.size()));
+    };
+    auto offset_bytes = [](uint64_t offset) {
+        std::string bytes;
+        for (int i = 0; i < 8; ++i) {
+            bytes += static_cast<char>(offset >> (8 * i));
+        }
+        return bytes;
+    };
+    // Writes a single chunk of the "x" column, with the row count given in the footer.
+    auto write_file = [&](const std::string& file_header, const std::string& num_rows,
+                          const std::string& values) {
+        BGZF* file = bgzf_open(path.c_str(), "w");
+        REQUIRE(file != nullptr);
+        write(file, file_header);
+        REQUIRE(bgzf_flush(file) == 0);
+        const auto column_offset = static_cast<uint64_t>(bgzf_tell(file));
+        write(file, values);
+        REQUIRE(bgzf_flush(file) == 0);
+        const auto footer_offset = static_cast<uint64_t>(bgzf_tell(file));
+        write(file, std::string("\x01\x00\x00\x00", 4) + num_rows + offset_bytes(column_offset));
+        REQUIRE(bgzf_flush(file) == 0);
+        write(file, offset_bytes(footer_offset) + "DSUMEND2");
+        CHECK(bgzf_close(file) == 0);
+    };
+
+    SECTION("A chunk of 2 rows is read") {
+        write_file(header, std::string("\x02\x00\x00\x00", 4),
+                   std::string("\x05\x00\x00\x00\xff\xff\xff\xff", 8));
+        SummaryColumnsReader reader(path);
+        REQUIRE(reader.columns().size() == 1);
+        CHECK(reader.columns()[0].name == "x");
+        REQUIRE(reader.num_chunks() == 1);
+        REQUIRE(reader.read_chunk() == 2);
+        CHECK(reader.columns()[0].ints == std::vector<int64_t>{5, -1});
+        CHECK(reader.read_chunk() == 0);
+    }
+
+    SECTION("A chunk with more rows than the maximum is rejected") {
+        write_file(header, std::string("\x01\x00\x01\x00", 4), "");
+        CHECK_THROWS_AS(SummaryColumnsReader(path), std::runtime_error);
+    }
+
+    SECTION("Too many columns are rejected") {
+        write_file(std::string("DSUMCOL2\xff\xff\xff\xff", 12), "", "");
+        CHECK_THROWS_AS(SummaryColumnsReader(path), std::runtime_error);
+    }
+
+    SECTION("A file without a trailer is rejected") {
+        BGZF* file = bgzf_open(path.c_str(), "w");
+        REQUIRE(file != nullptr);
+        write(file, header);
+        CHECK(bgzf_close(file) == 0);
+        CHECK_THROWS_AS(SummaryColumnsReader(path), std::runtime_error);
+    }
+}
@@ -109,3 +109,82 @@ TEST_CASE(CUT_TAG ": copy_tensor_elems", CUT_TAG) {
         }
     }
 }
+
+namespace {
+
+// Reference implementation of chunk staging using tensor ops.
+at::Tensor stage_chunk_with_tensor_ops(const at::Tensor& signal,
+                                       size_t offset,
+                                       size_t chunk_size) {
+    using torch::indexing::Ellipsis;
+    using torch::indexing::Slice;
+    auto chunk = signal.index({Ellipsis, Slice(offset, offset + chunk_size)});
+    if (chunk.dim() == 1) {
+        chunk = chunk.unsqueeze(0);
+    }
+    const auto slice_size = chunk.size(1);
+    if (slice_size != int64_t(chunk_size)) {
+        auto [n, overhang] = std::div(int(chunk_size), int(slice_size));
+        chunk = torch::concat({chunk.repeat({1, n}), chunk.index({Ellipsis, Slice(0, overhang)})},
+                              1);
+    }
+    return chunk;
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": copy_chunk_to_batch_row", CUT_TAG) {
+    torch::manual_seed(42);
+    srand(42);
+
+    const int batch_size = 4;
+    const int chunk_size = 100;
+    for (auto src_dtype : {torch::kFloat16, torch::kFloat32}) {
+        for (auto dest_dtype : {torch::kFloat16, torch::kFloat32}) {
+            for (int num_channels : {1, 3}) {
+                for (int i = 0; i < 10; ++i) {
+                    CAPTURE(src_dtype, dest_dtype, num_channels, i);
+                    const int signal_len = 1 + rand() % (2 * chunk_size);
+                    const auto signal = num_channels == 1
+                                                ? torch::rand({signal_len}, src_dtype)
+                                                : torch::rand({num_channels, signal_len}, src_dtype);
+                    const size_t offset = rand() % signal_len;
+                    const size_t row = rand() % batch_size;
+
+                    auto expected = torch::rand({batch_size, num_channels, chunk_size}, dest_dtype);
+                    auto result = expected.clone();
+                    expected.index_put_({int64_t(row), torch::indexing::Ellipsis},
+                                        stage_chunk_with_tensor_ops(signal, offset, chunk_size));
+                    dorado::utils::copy_chunk_to_batch_row(result, row, signal, offset);
+                    CHECK(torch::equal(expected, result));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(CUT_TAG ": copy_chunk_to_batch_row benchmark", "[.][benchmark]" CUT_TAG) {
+    const int batch_size = 128;
+    const int signal_len = 4000;
+    const auto signal = torch::rand({signal_len}, torch::kFloat16);
+
+    for (int chunk_size : {1000, 5000}) {
+        auto batch = torch::zeros({batch_size, 1, chunk_size}, torch::kFloat32);
+        // Each iteration stages a full batch, so chunks/s = batch_size / mean time.
+        BENCHMARK("tensor ops: " + std::to_string(batch_size) + " chunks of " +
+                  std::to_string(chunk_size)) {
+            for (int row = 0; row < batch_size; ++row) {
+                batch.index_put_({row, torch::indexing::Ellipsis},
+                                 stage_chunk_with_tensor_ops(signal, row, chunk_size));
+            }
+            return batch.data_ptr();
+        };
+        BENCHMARK("direct copy: " + std::to_string(batch_size) + " chunks of " +
+                  std::to_string(chunk_size)) {
+            for (int row = 0; row < batch_size; ++row) {
+                dorado::utils::copy_chunk_to_batch_row(batch, row, signal, row);
+            }
+            return batch.data_ptr();
+        };
+    }
+}
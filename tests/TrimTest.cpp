@@ -4,14 +4,20 @@
 #include "demux/Trimmer.h"
 #include "read_pipeline/HtsReader.h"
 #include "read_pipeline/read_utils.h"
+#include "utils/bam_utils.h"
+#include "utils/sequence_utils.h"
 
 #include <ATen/TensorIndexing.h>
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <map>
 #include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
 using Catch::Matchers::Equals;
@@ -141,6 +147,13 @@ TEST_CASE("Test trim move table", TEST_GROUP) {
         CHECK(ts == 0);
         CHECK(trimmed_table.size() == 0);
     }
+
+    SECTION("Find the moves to keep in place") {
+        auto trimmed = utils::find_trimmed_moves(move.data(), move.size(), {3, 5});
+        CHECK(trimmed.positions_trimmed == 6);
+        CHECK(trimmed.first == 6);
+        CHECK(trimmed.size == 4);
+    }
 }
 
 TEST_CASE("Test trim mod base info", TEST_GROUP) {
@@ -214,6 +227,201 @@ TEST_CASE("Test trim removes all alignment information", TEST_GROUP) {
     CHECK(trimmed_record->core.mpos == -1);
 }
 
+namespace {
+
+// Trims a record the way Trimmer::trim_sequence used to, by decoding the sequence to text,
+// re-encoding it with htslib, and then updating each tag in turn.
+BamPtr trim_by_reencoding(bam1_t *input_record, std::pair<int, int> trim_interval) {
+    const bool is_seq_reversed = input_record->core.flag & BAM_FREVERSE;
+    std::string seq = utils::extract_sequence(input_record);
+    std::vector<uint8_t> qual = utils::extract_quality(input_record);
+    auto [stride, move_vals] = utils::extract_move_table(input_record);
+    int ts = bam_aux_get(input_record, "ts") ? int(bam_aux2i(bam_aux_get(input_record, "ts"))) : -1;
+    int ns = bam_aux_get(input_record, "ns") ? int(bam_aux2i(bam_aux_get(input_record, "ns"))) : -1;
+    auto [modbase_str, modbase_probs] = utils::extract_modbase_info(input_record);
+    if (is_seq_reversed) {
+        seq = utils::reverse_complement(seq);
+        std::reverse(std::begin(qual), std::end(qual));
+    }
+
+    auto trimmed_seq = utils::trim_sequence(seq, trim_interval);
+    auto trimmed_qual = utils::trim_quality(qual, trim_interval);
+    auto [positions_trimmed, trimmed_moves] = utils::trim_move_table(move_vals, trim_interval);
+    if (move_vals.empty()) {
+        ns = -1;
+        ts = -1;
+    } else {
+        if (ts >= 0) {
+            ts += positions_trimmed * stride;
+        }
+        if (ns >= 0) {
+            ns = int(trimmed_moves.size() * stride) + std::max(0, ts);
+        }
+    }
+    const int seqlen = int(seq.length());
+    auto [trimmed_modbase_str, trimmed_modbase_probs] = utils::trim_modbase_info(
+            seq, modbase_str, modbase_probs,
+            is_seq_reversed
+                    ? std::make_pair(seqlen - trim_interval.second, seqlen - trim_interval.first)
+                    : trim_interval);
+
+    BamPtr output(utils::new_unmapped_record(input_record, trimmed_seq, trimmed_qual));
+    bam1_t *out_record = output.get();
+    if (!trimmed_moves.empty()) {
+        bam_aux_del(out_record, bam_aux_get(out_record, "mv"));
+        trimmed_moves.insert(trimmed_moves.begin(), uint8_t(stride));
+        bam_aux_update_array(out_record, "mv", 'c', int(trimmed_moves.size()),
+                             trimmed_moves.data());
+    }
+    if (!trimmed_modbase_str.empty()) {
+        bam_aux_del(out_record, bam_aux_get(out_record, "MM"));
+        bam_aux_append(out_record, "MM", 'Z', int(trimmed_modbase_str.length() + 1),
+                       reinterpret_cast<const uint8_t *>(trimmed_modbase_str.c_str()));
+        bam_aux_del(out_record, bam_aux_get(out_record, "ML"));
+        bam_aux_update_array(out_record, "ML", 'C', int(trimmed_modbase_probs.size()),
+                             trimmed_modbase_probs.data());
+        bam_aux_update_int(out_record, "MN", trimmed_seq.length());
+    }
+    if (ts >= 0) {
+        bam_aux_update_int(out_record, "ts", ts);
+    } else if (bam_aux_get(out_record, "ts")) {
+        bam_aux_del(out_record, bam_aux_get(out_record, "ts"));
+    }
+    if (ns >= 0) {
+        bam_aux_update_int(out_record, "ns", ns);
+    } else if (bam_aux_get(out_record, "ns")) {
+        bam_aux_del(out_record, bam_aux_get(out_record, "ns"));
+    }
+    return output;
+}
+
+// A mapped record with signal and modbase tags, and a couple of alignment tags.
+BamPtr make_record_to_trim(std::mt19937 &gen, int seqlen, bool reversed, bool has_moves) {
+    std::string seq;
+    std::vector<uint8_t> qual;
+    for (int i = 0; i < seqlen; ++i) {
+        seq += "ACGTN"[gen() % 5];
+        qual.push_back(uint8_t(gen() % 50));
+    }
+    BamPtr record(bam_init1());
+    bam_set1(record.get(), 6, "read_0", reversed ? BAM_FREVERSE : 0, 0, 100, 60, 0, nullptr, -1,
+             -1, 0, seq.length(), seq.c_str(), reinterpret_cast<const char *>(qual.data()), 0);
+
+    const std::string read_group = "run_model";
+    bam_aux_append(record.get(), "RG", 'Z', int(read_group.length() + 1),
+                   reinterpret_cast<const uint8_t *>(read_group.c_str()));
+    bam_aux_update_int(record.get(), "NM", 3);
+    if (has_moves) {
+        // The moves are in the basecalled orientation, with a 1 for each base.
+        std::vector<uint8_t> moves = {5};
+        for (int i = 0; i < seqlen; ++i) {
+            moves.push_back(1);
+            moves.resize(moves.size() + gen() % 3, 0);
+        }
+        bam_aux_update_array(record.get(), "mv", 'c', int(moves.size()), moves.data());
+        bam_aux_update_int(record.get(), "ts", 10);
+        bam_aux_update_int(record.get(), "ns", 70000);
+    }
+
+    // Modified A and C bases, which are also in the basecalled orientation.
+    const std::string basecalled_seq = reversed ? utils::reverse_complement(seq) : seq;
+    std::string modbase_str;
+    std::vector<uint8_t> modbase_probs;
+    for (char base : {'A', 'C'}) {
+        modbase_str += base + std::string(base == 'A' ? "+a?" : "+m?");
+        int skipped = 0;
+        for (char called_base : basecalled_seq) {
+            if (called_base != base) {
+                continue;
+            }
+            if (gen() % 2) {
+                modbase_str += "," + std::to_string(skipped);
+                modbase_probs.push_back(uint8_t(gen()));
+                skipped = 0;
+            } else {
+                ++skipped;
+            }
+        }
+        modbase_str += ";";
+    }
+    bam_aux_append(record.get(), "MM", 'Z', int(modbase_str.length() + 1),
+                   reinterpret_cast<const uint8_t *>(modbase_str.c_str()));
+    bam_aux_update_array(record.get(), "ML", 'C', int(modbase_probs.size()), modbase_probs.data());
+    bam_aux_update_int(record.get(), "MN", seqlen);
+    bam_aux_update_int(record.get(), "AS", 12);
+    const std::string barcode = "barcode01";
+    bam_aux_append(record.get(), "BC", 'Z', int(barcode.length() + 1),
+                   reinterpret_cast<const uint8_t *>(barcode.c_str()));
+    return record;
+}
+
+// The tags of a record by name, as their type and value bytes. Integers are compared by value,
+// as their type depends on how they were written.
+std::map<std::string, std::vector<uint8_t>> get_tags(bam1_t *record) {
+    std::map<std::string, std::vector<uint8_t>> tags;
+    const uint8_t *aux_end = bam_get_aux(record) + bam_get_l_aux(record);
+    for (const uint8_t *tag_data = bam_aux_first(record); tag_data;) {
+        const uint8_t *next = bam_aux_next(record, tag_data);
+        auto &value = tags[std::string(bam_aux_tag(tag_data), 2)];
+        if (std::strchr("cCsSiI", tag_data[0])) {
+            const int64_t int_value = bam_aux2i(tag_data);
+            const auto *bytes = reinterpret_cast<const uint8_t *>(&int_value);
+            value.push_back('i');
+            value.insert(value.end(), bytes, bytes + sizeof(int_value));
+        } else {
+            value.assign(tag_data, next ? next - 2 : aux_end);
+        }
+        tag_data = next;
+    }
+    return tags;
+}
+
+}  // namespace
+
+TEST_CASE("Test trim of BAM record matches trimming by re-encoding", TEST_GROUP) {
+    const bool reversed = GENERATE(false, true);
+    const bool has_moves = GENERATE(true, false);
+    // Odd and even lengths, so that the ends of the read are at odd and even offsets too.
+    const int seqlen = GENERATE(20, 21);
+    CAPTURE(reversed, has_moves, seqlen);
+    std::mt19937 gen(seqlen);
+    auto record = make_record_to_trim(gen, seqlen, reversed, has_moves);
+
+    SECTION("Trimmed reads") {
+        for (const auto &trim_interval : std::vector<std::pair<int, int>>{{0, seqlen},
+                                                                          {1, seqlen},
+                                                                          {2, seqlen},
+                                                                          {0, seqlen - 1},
+                                                                          {0, seqlen - 2},
+                                                                          {3, seqlen - 4},
+                                                                          {4, seqlen - 3},
+                                                                          {5, 6}}) {
+            CAPTURE(trim_interval);
+            auto expected = trim_by_reencoding(record.get(), trim_interval);
+            auto trimmed = Trimmer::trim_sequence(record.get(), trim_interval);
+            CHECK(std::string(bam_get_qname(trimmed.get())) == "read_0");
+            CHECK(trimmed->core.flag == expected->core.flag);
+            CHECK(trimmed->core.tid == -1);
+            CHECK(trimmed->core.pos == -1);
+            CHECK(utils::extract_sequence(trimmed.get()) ==
+                  utils::extract_sequence(expected.get()));
+            CHECK(utils::extract_quality(trimmed.get()) == utils::extract_quality(expected.get()));
+            CHECK(get_tags(trimmed.get()) == get_tags(expected.get()));
+        }
+    }
+
+    SECTION("Reads trimmed to 0 bases") {
+        for (int start : {0, 5, 6}) {
+            CAPTURE(start);
+            auto expected = trim_by_reencoding(record.get(), {start, start});
+            auto trimmed = Trimmer::trim_sequence(record.get(), {start, start});
+            // Re-encoding an empty sequence kept the whole read, so only the tags are compared.
+            CHECK(trimmed->core.l_qseq == 0);
+            CHECK(get_tags(trimmed.get()) == get_tags(expected.get()));
+        }
+    }
+}
+
 std::string to_qstr(std::vector<int8_t> qscore) {
     std::string qstr;
     for (size_t i = 0; i < qscore.size(); ++i) {